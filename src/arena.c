@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+/**
+ * Rozmiar pierwszego fragmentu alokatora. Kolejne fragmenty są dwa razy
+ * większe, aż do ARENA_MAX_CHUNK_SIZE, więc mała baza zajmuje mało pamięci.
+ */
+#define ARENA_INITIAL_CHUNK_SIZE 4096
+
+/**
+ * Maksymalny rozmiar zwykłego fragmentu.
+ */
+#define ARENA_MAX_CHUNK_SIZE (1 << 20)
+
+/**
+ * Rozmiar nagłówka fragmentu, zaokrąglony tak, by dane były wyrównane.
+ */
+#define CHUNK_HEADER_SIZE \
+    ((sizeof(ArenaChunk) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+/**
+ * Wyznacza klasę rozmiaru bloku.
+ * @param size Żądany rozmiar bloku
+ * @param rounded Rozmiar bloku zaokrąglony do rozmiaru klasy
+ * @return Indeks klasy lub ARENA_SIZE_CLASSES, gdy rozmiar jest zbyt duży.
+ */
+static size_t sizeClass(size_t size, size_t *rounded) {
+    if (size == 0)
+        size = 1;
+
+    if (size <= ARENA_SMALL_LIMIT) {
+        size_t idx = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT;
+        *rounded = idx * ARENA_ALIGNMENT;
+        return idx - 1;
+    }
+
+    size_t idx = ARENA_SMALL_LIMIT / ARENA_ALIGNMENT;
+    size_t class_size = ARENA_SMALL_LIMIT * 2;
+    while (class_size < size && class_size < SIZE_MAX / 2) {
+        class_size <<= 1;
+        idx++;
+    }
+
+    *rounded = class_size;
+    return class_size < size ? ARENA_SIZE_CLASSES : idx;
+}
+
+/**
+ * Alokuje nowy fragment i dołącza go do listy fragmentów alokatora.
+ * @param a Alokator
+ * @param size Rozmiar obszaru danych fragmentu
+ * @return Wskaźnik na obszar danych fragmentu lub NULL.
+ */
+static char *newChunk(Arena *a, size_t size) {
+    ArenaChunk *chunk = malloc(CHUNK_HEADER_SIZE + size);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->next = a->chunks;
+    chunk->size = size;
+    a->chunks = chunk;
+
+    return (char *) chunk + CHUNK_HEADER_SIZE;
+}
+
+void arenaIni(Arena *a) {
+    a->chunks = NULL;
+    a->next = NULL;
+    a->end = NULL;
+    a->chunk_size = ARENA_INITIAL_CHUNK_SIZE;
+
+    for (size_t i = 0; i < ARENA_SIZE_CLASSES; i++)
+        a->free_lists[i] = NULL;
+}
+
+void *arenaAlloc(Arena *a, size_t size) {
+    size_t rounded;
+    size_t idx = sizeClass(size, &rounded);
+
+    if (idx >= ARENA_SIZE_CLASSES)
+        return NULL;
+
+    // Najpierw używam ponownie zwolnionego bloku tej samej klasy
+    if (a->free_lists[idx] != NULL) {
+        void *block = a->free_lists[idx];
+        a->free_lists[idx] = *(void **) block;
+        return block;
+    }
+
+    if ((size_t) (a->end - a->next) >= rounded) {
+        void *block = a->next;
+        a->next += rounded;
+        return block;
+    }
+
+    // Duże bloki dostają własny fragment, bieżący fragment pozostaje w użyciu
+    if (rounded > a->chunk_size / 4)
+        return newChunk(a, rounded);
+
+    char *data = newChunk(a, a->chunk_size);
+    if (data == NULL)
+        return NULL;
+
+    a->next = data + rounded;
+    a->end = data + a->chunk_size;
+    if (a->chunk_size < ARENA_MAX_CHUNK_SIZE)
+        a->chunk_size *= 2;
+
+    return data;
+}
+
+void arenaFree(Arena *a, void *block, size_t size) {
+    if (block == NULL)
+        return;
+
+    size_t rounded;
+    size_t idx = sizeClass(size, &rounded);
+
+    *(void **) block = a->free_lists[idx];
+    a->free_lists[idx] = block;
+}
+
+size_t arenaReserved(Arena const *a) {
+    size_t size = 0;
+    for (ArenaChunk const *chunk = a->chunks; chunk != NULL; chunk = chunk->next)
+        size += CHUNK_HEADER_SIZE + chunk->size;
+
+    return size;
+}
+
+void arenaRelease(Arena *a) {
+    ArenaChunk *chunk = a->chunks;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free((void *) chunk);
+        chunk = next;
+    }
+
+    arenaIni(a);
+}
@@ -0,0 +1,88 @@
+/** @file
+ * Interfejs alokatora przydzielającego bloki pamięci z dużych fragmentów
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_ARENA_H
+#define TELEFONY_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Wyrównanie, do którego zaokrąglane są rozmiary przydzielanych bloków.
+ */
+#define ARENA_ALIGNMENT 8
+
+/**
+ * Największy rozmiar bloku, dla którego klasy rozmiarów rosną liniowo.
+ */
+#define ARENA_SMALL_LIMIT 256
+
+/**
+ * Liczba klas rozmiarów bloków. Bloki do ARENA_SMALL_LIMIT bajtów mają klasy
+ * co ARENA_ALIGNMENT bajtów, większe - kolejne potęgi dwójki.
+ */
+#define ARENA_SIZE_CLASSES 96
+
+/**
+ * Fragment pamięci, z którego alokator wycina kolejne bloki.
+ */
+typedef struct arena_chunk {
+    struct arena_chunk *next;   ///< Wskaźnik na poprzednio zaalokowany fragment
+    size_t size;                ///< Rozmiar obszaru danych fragmentu
+} ArenaChunk;
+
+/**
+ * Alokator przydzielający bloki przez przesunięcie wskaźnika w bieżącym
+ * fragmencie. Zwolnione bloki trafiają na listy według klas rozmiarów
+ * i są używane ponownie; cała pamięć zwalniana jest naraz przez arenaRelease.
+ */
+typedef struct arena {
+    ArenaChunk *chunks;                     ///< Lista zaalokowanych fragmentów
+    char *next;                             ///< Początek wolnego miejsca w bieżącym fragmencie
+    char *end;                              ///< Koniec bieżącego fragmentu
+    size_t chunk_size;                      ///< Rozmiar następnego alokowanego fragmentu
+    void *free_lists[ARENA_SIZE_CLASSES];   ///< Listy zwolnionych bloków według klas rozmiarów
+} Arena;
+
+/**
+ * Inicjalizuje pusty alokator.
+ * @param a Wskaźnik na inicjalizowany alokator.
+ */
+void arenaIni(Arena *a);
+
+/**
+ * Przydziela blok pamięci wyrównany do ARENA_ALIGNMENT bajtów.
+ * @param a Alokator
+ * @param size Rozmiar bloku w bajtach
+ * @return Wskaźnik na blok lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+void *arenaAlloc(Arena *a, size_t size);
+
+/**
+ * Oddaje blok do ponownego użycia przez alokator.
+ * @param a Alokator, z którego pochodzi blok
+ * @param block Zwalniany blok lub NULL
+ * @param size Rozmiar podany przy przydzielaniu bloku
+ */
+void arenaFree(Arena *a, void *block, size_t size);
+
+/**
+ * Liczy pamięć zajętą przez fragmenty alokatora, łącznie z blokami
+ * zwolnionymi i jeszcze nieprzydzielonymi.
+ * @param a Alokator
+ * @return Łączny rozmiar fragmentów w bajtach.
+ */
+size_t arenaReserved(Arena const *a);
+
+/**
+ * Zwalnia wszystkie fragmenty alokatora. Wszystkie przydzielone z niego bloki
+ * przestają być ważne, a alokator można używać ponownie.
+ * @param a Alokator
+ */
+void arenaRelease(Arena *a);
+
+#endif //TELEFONY_ARENA_H
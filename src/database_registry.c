@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "database_registry.h"
+
+/**
+ * Początkowy rozmiar tablicy.
+ */
+#define INITIAL_REGISTRY_CAPACITY 16
+
+/**
+ * Wyznacza pole, od którego należy szukać bazy o podanym haszu.
+ * @param r Tablica o niezerowym rozmiarze
+ * @param hash Hasz
+ * @return Indeks pola.
+ */
+static inline size_t homeSlot(Registry const *r, size_t hash) {
+    return hash & (r->capacity - 1);
+}
+
+/**
+ * Szuka pola z bazą o podanej nazwie.
+ * @param r Tablica
+ * @param name Nazwa
+ * @param name_length Długość nazwy
+ * @param hash Hasz nazwy
+ * @param slot Indeks znalezionego pola
+ * @return True, jeżeli baza jest w tablicy, false w p.p.
+ */
+static bool findSlot(Registry const *r, char const *name, size_t name_length,
+                     size_t hash, size_t *slot) {
+    if (r->capacity == 0)
+        return false;
+
+    // Tablica nigdy nie jest pełna, więc pętla trafi na puste pole
+    for (size_t i = homeSlot(r, hash);; i = (i + 1) & (r->capacity - 1)) {
+        Database const *db = r->slots[i];
+        if (db == NULL)
+            return false;
+
+        if (db->hash == hash && db->name_length == name_length &&
+            memcmp(db->name, name, name_length) == 0) {
+            *slot = i;
+            return true;
+        }
+    }
+}
+
+/**
+ * Wstawia bazę w pierwsze wolne pole, licząc od jej pola domowego.
+ * @param slots Tablica pól
+ * @param capacity Rozmiar tablicy
+ * @param db Wstawiana baza
+ */
+static void placeDatabase(Database **slots, size_t capacity, Database *db) {
+    size_t i = db->hash & (capacity - 1);
+    while (slots[i] != NULL)
+        i = (i + 1) & (capacity - 1);
+
+    slots[i] = db;
+}
+
+/**
+ * Przenosi bazy do nowej tablicy pól dwa razy większej od obecnej.
+ * @param r Tablica
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool grow(Registry *r) {
+    size_t capacity = r->capacity > 0 ? 2 * r->capacity : INITIAL_REGISTRY_CAPACITY;
+    Database **slots = calloc(capacity, sizeof(Database *));
+    if (slots == NULL)
+        return false;
+
+    // Hasze są zapamiętane, więc nazw nie trzeba haszować ponownie
+    for (size_t i = 0; i < r->capacity; i++) {
+        if (r->slots[i] != NULL)
+            placeDatabase(slots, capacity, r->slots[i]);
+    }
+
+    free((void *) r->slots);
+    r->slots = slots;
+    r->capacity = capacity;
+    return true;
+}
+
+size_t registryHash(char const *name, size_t name_length) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < name_length; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return (size_t) hash;
+}
+
+void registryIni(Registry *r) {
+    r->slots = NULL;
+    r->capacity = 0;
+    r->count = 0;
+}
+
+Database *registryFind(Registry const *r, char const *name, size_t name_length) {
+    size_t slot;
+    if (!findSlot(r, name, name_length, registryHash(name, name_length), &slot))
+        return NULL;
+
+    return r->slots[slot];
+}
+
+bool registryInsert(Registry *r, Database *db) {
+    if (4 * (r->count + 1) > 3 * r->capacity && !grow(r))
+        return false;
+
+    placeDatabase(r->slots, r->capacity, db);
+    r->count++;
+    return true;
+}
+
+Database *registryRemove(Registry *r, char const *name, size_t name_length) {
+    size_t slot;
+    if (!findSlot(r, name, name_length, registryHash(name, name_length), &slot))
+        return NULL;
+
+    Database *removed = r->slots[slot];
+    r->slots[slot] = NULL;
+    r->count--;
+
+    // Przesuwam w zwolnione pole kolejne bazy z ciągu, których pole domowe
+    // nie leży między zwolnionym polem a ich obecnym miejscem
+    size_t mask = r->capacity - 1;
+    for (size_t i = (slot + 1) & mask; r->slots[i] != NULL; i = (i + 1) & mask) {
+        size_t home = homeSlot(r, r->slots[i]->hash);
+        if (((i - home) & mask) >= ((i - slot) & mask)) {
+            r->slots[slot] = r->slots[i];
+            r->slots[i] = NULL;
+            slot = i;
+        }
+    }
+
+    return removed;
+}
+
+void registryFree(Registry *r) {
+    free((void *) r->slots);
+    registryIni(r);
+}
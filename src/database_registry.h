@@ -0,0 +1,83 @@
+/** @file
+ * Interfejs tablicy haszującej przechowującej bazy przekierowań według nazw
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_DATABASE_REGISTRY_H
+#define TELEFONY_DATABASE_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Przechowuje dane bazy przekierowań
+ */
+typedef struct database {
+    struct PhoneForward *db;    ///< Wskaźnik na strukture PhoneForward.
+    char *name;                 ///< Nazwa bazy przekierowań.
+    size_t name_length;         ///< Długość nazwy bazy pzekierowań.
+    size_t hash;                ///< Zapamiętany hasz nazwy.
+} Database;
+
+/**
+ * Tablica haszująca z adresowaniem otwartym i liniowym próbkowaniem.
+ * Rozmiar tablicy jest potęgą dwójki, a tablica jest powiększana,
+ * zanim zapełni się w trzech czwartych.
+ */
+typedef struct registry {
+    Database **slots;   ///< Tablica wskaźników na bazy, NULL oznacza puste pole
+    size_t capacity;    ///< Rozmiar tablicy
+    size_t count;       ///< Liczba baz w tablicy
+} Registry;
+
+/**
+ * Wyznacza hasz nazwy bazy.
+ * @param name Nazwa
+ * @param name_length Długość nazwy
+ * @return Hasz nazwy.
+ */
+size_t registryHash(char const *name, size_t name_length);
+
+/**
+ * Inicjalizuje pustą tablicę.
+ * @param r Inicjalizowana tablica
+ */
+void registryIni(Registry *r);
+
+/**
+ * Szuka bazy o podanej nazwie.
+ * @param r Tablica
+ * @param name Nazwa poszukiwanej bazy
+ * @param name_length Długość nazwy
+ * @return Wskaźnik na znalezioną bazę lub NULL, jeżeli taka nie istnieje.
+ */
+Database *registryFind(Registry const *r, char const *name, size_t name_length);
+
+/**
+ * Dodaje bazę do tablicy. Baza o tej samej nazwie nie może już w niej być,
+ * a pole @p hash bazy musi być wyznaczone przez registryHash.
+ * @param r Tablica
+ * @param db Dodawana baza
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool registryInsert(Registry *r, Database *db);
+
+/**
+ * Usuwa z tablicy bazę o podanej nazwie. Sama baza nie jest zwalniana.
+ * @param r Tablica
+ * @param name Nazwa usuwanej bazy
+ * @param name_length Długość nazwy
+ * @return Wskaźnik na usuniętą bazę lub NULL, jeżeli takiej nie było.
+ */
+Database *registryRemove(Registry *r, char const *name, size_t name_length);
+
+/**
+ * Zwalnia pamięć tablicy, bez baz, na które wskazuje.
+ * @param r Tablica
+ */
+void registryFree(Registry *r);
+
+#endif //TELEFONY_DATABASE_REGISTRY_H
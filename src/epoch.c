@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <sched.h>
+#include <stdlib.h>
+#include "epoch.h"
+
+/**
+ * Licznik, z którego kolejne wątki biorą pierwsze próbowane miejsce czytelnika,
+ * aby nie rywalizowały o to samo.
+ */
+static _Atomic size_t next_slot_hint = 0;
+
+/**
+ * Miejsce czytelnika zajęte ostatnio przez ten wątek, powiększone o 1;
+ * 0 oznacza, że wątek jeszcze nie czytał.
+ */
+static _Thread_local size_t slot_hint = 0;
+
+void epochIni(EpochDomain *d) {
+    atomic_init(&d->global, 1);
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++)
+        atomic_init(&d->slots[i].epoch, 0);
+
+    d->retired = NULL;
+    d->retired_count = 0;
+    d->retired_capacity = 0;
+}
+
+size_t epochEnter(EpochDomain *d) {
+    if (slot_hint == 0)
+        slot_hint = atomic_fetch_add(&next_slot_hint, 1) % EPOCH_READER_SLOTS + 1;
+
+    size_t slot = slot_hint - 1;
+    for (size_t tries = 1;; tries++) {
+        // Zajęcie miejsca jest zarazem zapisem epoki, więc poprzedza każdy odczyt
+        // współdzielonego wskaźnika
+        uint64_t expected = 0;
+        if (atomic_compare_exchange_strong(&d->slots[slot].epoch, &expected,
+                                           atomic_load(&d->global))) {
+            slot_hint = slot + 1;
+            return slot;
+        }
+
+        slot = (slot + 1) % EPOCH_READER_SLOTS;
+        if (tries % EPOCH_READER_SLOTS == 0)
+            sched_yield();
+    }
+}
+
+void epochExit(EpochDomain *d, size_t slot) {
+    atomic_store(&d->slots[slot].epoch, 0);
+}
+
+/**
+ * Wyznacza najstarszą epokę, w której przebywa któryś z czytelników.
+ * @param d Domena
+ * @return Najmniejsza epoka czytelnika lub UINT64_MAX, gdy nie ma czytelników.
+ */
+static uint64_t oldestReader(EpochDomain *d) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++) {
+        uint64_t epoch = atomic_load(&d->slots[i].epoch);
+        if (epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+
+    return oldest;
+}
+
+void epochRetire(EpochDomain *d, void *object, void (*release)(void *)) {
+    if (object == NULL)
+        return;
+
+    // Czytelnicy, którzy wejdą po zmianie epoki, nie mogą już zobaczyć obiektu
+    uint64_t epoch = atomic_fetch_add(&d->global, 1);
+
+    if (d->retired_count == d->retired_capacity) {
+        size_t capacity = d->retired_capacity > 0 ? 2 * d->retired_capacity : 4;
+        EpochRetired *retired = realloc(d->retired, capacity * sizeof(EpochRetired));
+        if (retired == NULL) {
+            while (oldestReader(d) <= epoch)
+                sched_yield();
+
+            release(object);
+            return;
+        }
+
+        d->retired = retired;
+        d->retired_capacity = capacity;
+    }
+
+    d->retired[d->retired_count].object = object;
+    d->retired[d->retired_count].release = release;
+    d->retired[d->retired_count].epoch = epoch;
+    d->retired_count++;
+}
+
+void epochReclaim(EpochDomain *d) {
+    uint64_t oldest = oldestReader(d);
+    size_t kept = 0;
+
+    for (size_t i = 0; i < d->retired_count; i++) {
+        EpochRetired *r = &d->retired[i];
+        if (r->epoch < oldest)
+            r->release(r->object);
+        else
+            d->retired[kept++] = *r;
+    }
+
+    d->retired_count = kept;
+}
+
+void epochFree(EpochDomain *d) {
+    for (size_t i = 0; i < d->retired_count; i++)
+        d->retired[i].release(d->retired[i].object);
+
+    free((void *) d->retired);
+    d->retired = NULL;
+    d->retired_count = 0;
+    d->retired_capacity = 0;
+}
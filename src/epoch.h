@@ -0,0 +1,104 @@
+/** @file
+ * Interfejs odroczonego zwalniania pamięci współdzielonej z czytelnikami
+ * działającymi bez blokad, oparty na epokach
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_EPOCH_H
+#define TELEFONY_EPOCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Liczba czytelników, którzy mogą jednocześnie przebywać w sekcji krytycznej.
+ * Nadmiarowi czytelnicy czekają na zwolnienie miejsca.
+ */
+#define EPOCH_READER_SLOTS 64
+
+/**
+ * Rozmiar linii pamięci podręcznej; każde miejsce czytelnika zajmuje osobną linię.
+ */
+#define EPOCH_CACHE_LINE 64
+
+/**
+ * Miejsce czytelnika. Wartość 0 oznacza wolne miejsce, a w p.p. epokę,
+ * w której czytelnik wszedł do sekcji krytycznej.
+ */
+typedef struct epoch_slot {
+    _Atomic uint64_t epoch;                             ///< Epoka czytelnika lub 0
+    char padding[EPOCH_CACHE_LINE - sizeof(uint64_t)];  ///< Dopełnienie do linii pamięci podręcznej
+} EpochSlot;
+
+/**
+ * Obiekt wycofany z użycia, czekający, aż opuszczą go wszyscy czytelnicy.
+ */
+typedef struct epoch_retired {
+    void *object;               ///< Obiekt
+    void (*release)(void *);    ///< Funkcja zwalniająca obiekt
+    uint64_t epoch;             ///< Epoka, w której obiekt wycofano
+} EpochRetired;
+
+/**
+ * Domena epok: czytelnicy zgłaszają w niej wejście do sekcji krytycznej,
+ * a piszący odkłada zwolnienie wycofanych obiektów, dopóki może ich używać
+ * któryś z czytelników. Funkcje piszącego nie mogą być wywoływane współbieżnie.
+ */
+typedef struct epoch_domain {
+    _Atomic uint64_t global;                ///< Bieżąca epoka, zaczyna się od 1
+    EpochSlot slots[EPOCH_READER_SLOTS];    ///< Miejsca czytelników
+    EpochRetired *retired;                  ///< Obiekty czekające na zwolnienie
+    size_t retired_count;                   ///< Liczba obiektów czekających na zwolnienie
+    size_t retired_capacity;                ///< Rozmiar tablicy @p retired
+} EpochDomain;
+
+/**
+ * Inicjalizuje domenę bez czytelników i wycofanych obiektów.
+ * @param d Domena
+ */
+void epochIni(EpochDomain *d);
+
+/**
+ * Zgłasza wejście czytelnika do sekcji krytycznej. Obiekty odczytane
+ * ze współdzielonych wskaźników pozostają ważne aż do @ref epochExit.
+ * @param d Domena
+ * @return Zajęte miejsce, które należy przekazać do @ref epochExit.
+ */
+size_t epochEnter(EpochDomain *d);
+
+/**
+ * Zgłasza wyjście czytelnika z sekcji krytycznej.
+ * @param d     Domena
+ * @param slot  Miejsce zwrócone przez @ref epochEnter
+ */
+void epochExit(EpochDomain *d, size_t slot);
+
+/**
+ * Wycofuje obiekt, który został już usunięty ze współdzielonych wskaźników.
+ * Obiekt zostanie zwolniony, gdy opuszczą go wszyscy czytelnicy; jeżeli nie
+ * uda się zaalokować pamięci, funkcja czeka na nich i zwalnia go od razu.
+ * @param d         Domena
+ * @param object    Wycofywany obiekt lub NULL
+ * @param release   Funkcja zwalniająca obiekt
+ */
+void epochRetire(EpochDomain *d, void *object, void (*release)(void *));
+
+/**
+ * Zwalnia te wycofane obiekty, których nie może już używać żaden czytelnik.
+ * @param d Domena
+ */
+void epochReclaim(EpochDomain *d);
+
+/**
+ * Zwalnia wszystkie wycofane obiekty i pamięć domeny. W domenie nie może
+ * być już żadnych czytelników.
+ * @param d Domena
+ */
+void epochFree(EpochDomain *d);
+
+#endif //TELEFONY_EPOCH_H
@@ -0,0 +1,671 @@
+/** @file
+ * Wewnętrzna reprezentacja bazy przekierowań: węzły drzewa, napisy z cyfr
+ * i operacje na nich, wspólne dla phone_forward.c i forward_version.c
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_FORWARD_TREE_H
+#define TELEFONY_FORWARD_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "phone_forward.h"
+#include "arena.h"
+#include "get_cache.h"
+#include "number_scan.h"
+
+/**
+ * Maksymalna liczba dzieci węzła przechowywana w postaci rzadkiej, czyli
+ * posortowanej tablicy pierwszych znaków kluczy dzieci. Węzeł, który ma
+ * więcej dzieci, przechodzi na tablicę gęstą indeksowaną cyfrą.
+ */
+#define SPARSE_CHILDREN_CAPACITY 4
+
+/**
+ * Liczba bajtów napisu (klucza lub przekierowania) przechowywanego
+ * bezpośrednio w węźle, bez osobnej alokacji.
+ */
+#define INLINE_STRING_BYTES 16
+
+/**
+ * Maksymalna liczba cyfr napisu przechowywanego bezpośrednio w węźle.
+ * Każda cyfra zajmuje połowę bajtu.
+ */
+#define INLINE_STRING_CAPACITY (2 * INLINE_STRING_BYTES)
+
+/**
+ * Liczba cyfr mieszczących się w jednym słowie 64-bitowym, którymi
+ * porównywane są napisy.
+ */
+#define DIGITS_PER_WORD 16
+
+/**
+ * Rozmiar bufora na stosie, do którego rozpakowywane jest zastępowane
+ * przekierowanie, potrzebne indeksowi odwrotnemu jako znaki.
+ */
+#define UNPACK_BUFFER_SIZE 64
+
+/**
+ * Napis z cyfr przechowywany w węźle drzewa.
+ * Każda cyfra zapisana jest na czterech bitach jako `cyfra - '0'`, pierwsza
+ * w starszej połowie bajtu, tak jak w zrzucie bazy; nieużyte bity są zerami.
+ * Napisy o długości co najwyżej INLINE_STRING_CAPACITY zapisane są
+ * bezpośrednio w strukturze, dłuższe w osobno zaalokowanej pamięci,
+ * zaokrąglonej do pełnych słów 64-bitowych, aby można ją było czytać słowami.
+ * Pusty napis nie wymaga żadnej alokacji.
+ */
+typedef struct ShortString {
+    size_t length;                                      ///< liczba cyfr napisu
+    union {
+        unsigned char inline_digits[INLINE_STRING_BYTES]; ///< krótki napis
+        unsigned char *heap;                            ///< długi napis
+    };
+} ShortString;
+
+/**
+ * @struct node
+ * @details Węzeł drzewa przechowującego przekierowania numerów telefonów,
+ * zaimplementowanego jako drzewo Patricia (Skompresowane drzewo trie).
+ * Dzieci węzła przechowywane są adaptacyjnie: dopóki jest ich co najwyżej
+ * SPARSE_CHILDREN_CAPACITY, tablica @p children jest rzadka i uporządkowana
+ * rosnąco według @p child_keys; przy większej liczbie dzieci tablica ma
+ * NUMBER_OF_DIGITS pól indeksowanych wartością `cyfra - '0'`. W obu
+ * przypadkach kolejne dzieci są uporządkowane leksykograficznie.
+ *
+ * Ten sam typ węzła służy do budowy indeksu odwrotnego. Wartością węzła
+ * drzewa indeksu jest @p sources, a w drzewach numerów źródłowych sama flaga
+ * @p terminal. Węzeł bez wartości ma zawsze pusty napis @p phfwd.
+ */
+typedef struct node {
+    ShortString key;               ///< ciąg znaków zapisanych w danym węźle
+    union {
+        ShortString phfwd;         ///< przekierowanie dla prefixu złożonego z kluczy przechowywanych w ciągu od korzenia do obecnego węzła
+        struct node *sources;      ///< w indeksie odwrotnym: korzeń drzewa numerów przekierowanych na ten prefix
+    };
+
+    struct node **children;                     ///< tablica dzieci obecnego węzła
+    char child_keys[SPARSE_CHILDREN_CAPACITY];  ///< pierwsze znaki kluczy dzieci węzła rzadkiego, rosnąco
+    unsigned char children_count;               ///< liczba dzieci obecnego węzła
+    bool dense;                                 ///< czy tablica dzieci jest gęsta
+    bool terminal;                              ///< czy ścieżka od korzenia do węzła ma przypisaną wartość
+    bool building;                              ///< czy węzeł należy do budowanej wersji bazy, niewidocznej jeszcze dla czytelników
+} Node;
+
+/**
+ * @struct PhoneForward phone_forward.h
+ * @details Baza przekierowań: korzeń drzewa oraz alokatory, z których
+ * pochodzi cała pamięć drzewa. Węzły przydzielane są z osobnego alokatora
+ * bloków stałego rozmiaru, a długie napisy i tablice dzieci z drugiego,
+ * dzięki czemu usunięcie bazy sprowadza się do zwolnienia ich fragmentów.
+ *
+ * Indeks odwrotny to drzewo kluczowane numerami, na które przekierowano.
+ * Każdy jego węzeł z wartością przechowuje drzewo numerów przekierowanych
+ * na ścieżkę tego węzła, dzięki czemu phfwdReverse nie przegląda całej bazy.
+ */
+struct PhoneForward {
+    Node *root;         ///< korzeń drzewa, ma pusty klucz i nie ma przekierowania
+    Node *targets;      ///< korzeń indeksu odwrotnego
+    Arena nodes;        ///< alokator węzłów
+    Arena bytes;        ///< alokator długich napisów i tablic dzieci
+    GetCache *cache;    ///< pamięć podręczna wyników phfwdGet lub NULL, gdy wyłączona
+};
+typedef struct PhoneForward PhoneForward; ///< domyślny typedef
+
+/**
+ * @struct node_frame
+ * @details Element stosu używanego do przeglądania drzewa bez rekurencji.
+ */
+typedef struct node_frame {
+    Node *node;     ///< Węzeł do odwiedzenia
+    size_t depth;   ///< Długość ścieżki od korzenia do rodzica węzła
+} NodeFrame;
+
+/**
+ * @struct node_stack
+ * @details Stos węzłów do odwiedzenia, alokowany na stercie, dzięki czemu
+ * głębokość drzewa nie jest ograniczona rozmiarem stosu wywołań.
+ */
+typedef struct node_stack {
+    NodeFrame *frames;  ///< Tablica elementów stosu
+    size_t size;        ///< Liczba elementów na stosie
+    size_t capacity;    ///< Rozmiar tablicy
+} NodeStack;
+
+/**
+ * Nadaje napisowi wartość będącą złączeniem napisów @p s1 i @p s2.
+ * Napisy źródłowe mogą pokrywać się z pamięcią nadpisywanego napisu.
+ * @param[in] pf        Baza, z której alokatora pochodzi napis
+ * @param[in, out] s    Nadpisywany napis
+ * @param[in] s1        Pierwsza część
+ * @param[in] s1_len    Długość pierwszej części
+ * @param[in] s2        Druga część
+ * @param[in] s2_len    Długość drugiej części
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool stringAssignConcat(PhoneForward *pf, ShortString *s, const char *s1,
+                        size_t s1_len, const char *s2, size_t s2_len);
+
+/**
+ * Nadaje napisowi wartość będącą złączeniem fragmentu napisu @p a
+ * i początku napisu @p b, bez rozpakowywania cyfr.
+ * Napisy źródłowe mogą być nadpisywanym napisem.
+ * @param[in] pf        Baza, z której alokatora pochodzi napis
+ * @param[in, out] s    Nadpisywany napis
+ * @param[in] a         Pierwszy napis
+ * @param[in] a_from    Początek fragmentu pierwszego napisu
+ * @param[in] a_length  Długość fragmentu pierwszego napisu
+ * @param[in] b         Drugi napis lub NULL
+ * @param[in] b_length  Długość początku drugiego napisu
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool stringAssignSlice(PhoneForward *pf, ShortString *s, ShortString const *a,
+                       size_t a_from, size_t a_length, ShortString const *b,
+                       size_t b_length);
+
+/**
+ * Dodaje dziecko do węzła. Węzeł nie może mieć dziecka o kluczu
+ * zaczynającym się tym samym znakiem.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł-rodzic
+ * @param[in]      child    Dodawane dziecko
+ * @return True, jeżeli dodano dziecko, false gdy nie udało się zaalokować pamięci.
+ */
+bool insertChild(PhoneForward *pf, Node *node, Node *child);
+
+/**
+ * Odłącza od węzła dziecko, którego klucz zaczyna się od znaku @p c.
+ * Samo dziecko nie jest zwalniane.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł-rodzic
+ * @param[in]      c        Pierwszy znak klucza dziecka
+ */
+void removeChild(PhoneForward *pf, Node *node, char c);
+
+/**
+ * Odkłada węzeł na stos.
+ * @param[in, out] stack    Stos
+ * @param[in] node          Węzeł
+ * @param[in] depth         Długość ścieżki od korzenia do rodzica węzła
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool stackPush(NodeStack *stack, Node *node, size_t depth);
+
+/**
+ * Odkłada na stos wszystkie dzieci węzła, w odwrotnej kolejności,
+ * aby były zdejmowane w porządku leksykograficznym.
+ * @param[in, out] stack    Stos
+ * @param[in] node          Węzeł-rodzic
+ * @param[in] depth         Długość ścieżki od korzenia do końca klucza węzła
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool stackPushChildren(NodeStack *stack, Node const *node, size_t depth);
+
+/**
+ * Oddaje do alokatora bazy pamięć pojedynczego węzła, bez jego dzieci.
+ * @param[in] pf    Baza, do której należy węzeł
+ * @param[in] node  Usuwany węzeł
+ */
+void nodeFree(PhoneForward *pf, Node *node);
+
+/**
+ * Oddaje do alokatorów bazy pamięć węzła i całego jego poddrzewa,
+ * aby mogła zostać użyta ponownie.
+ * @details Jeżeli nie uda się zaalokować stosu, część poddrzewa nie trafia
+ * do ponownego użycia, ale jego pamięć i tak zwolni phfwdDelete.
+ * @param[in] pf    Baza, do której należy węzeł
+ * @param[in] node  Usuwany węzeł lub NULL
+ */
+void nodeDelete(PhoneForward *pf, Node *node);
+
+/**
+ * Tworzy nowy węzeł drzewa.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in] key           Klucz węzła
+ * @param[in] key_length    Długość klucza
+ * @param[in] phfwd         Przekierowanie lub NULL
+ * @return Wskaźnik na utworzony węzeł lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+Node *nodeNew(PhoneForward *pf, const char *key, size_t key_length,
+              const char *phfwd);
+
+/**
+ * Dzieli węzęł drzewa na dwa.
+ * @details Funkcja pomocnicza dzielaca węzęł drzewa na dwa. W węźle-rodzicu pozostaje
+ * numer o długości k, w węźle-dziecku jako klucz przypisywane zostaje pozostałe key_length - k znaków.
+ * Węzeł-dziecko przejmuje dzieci oraz przekierowanie rodzica.
+ * @param[in]  pf                        Baza, do której należy węzeł
+ * @param[in]  parent                    Wskaźnik na dzielony węzeł
+ * @param[in]  remaining_length          Długość ciągu znaków, który pozostanie w kluczu węzła-rodzica
+ * @return True, jeżeli udało się podzielić węzeł, false gdy nie udało się zaalokować pamięci.
+ */
+bool splitNode(PhoneForward *pf, Node *parent, size_t remaining_length);
+
+/**
+ * Przenosi do węzła klucz, przekierowanie i dzieci jego jedynego dziecka.
+ * Dziecko zostaje odłączone i ma już tylko swój klucz.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł bez wartości z dokładnie jednym dzieckiem
+ * @return Odłączone dziecko lub NULL, gdy nie udało się zaalokować pamięci;
+ *         wtedy węzeł się nie zmienia.
+ */
+Node *absorbChild(PhoneForward *pf, Node *node);
+
+/**
+ * Funkcja pomocnicza znajdująca najgłębszy węzeł, którego pełna ścieżka od
+ * korzenia jest prefiksem napisu num.
+ * @param[in]  t                     Przeszukiwane drzewo.
+ * @param[in]  num                   Numer którego prefiksu poszukujemy.
+ * @param[in]  num_length            Długość poszukiwanego numeru.
+ * @param[out] depth_in_characters   Długość ścieżki od korzenia do znalezionego węzła.
+ * @param[out] parent                Rodzic znalezionego węzła lub NULL dla korzenia;
+ *                                   może być NULL, jeżeli nie jest potrzebny.
+ * @return  Wskaźnik na znaleziony węzęł.
+ */
+Node *
+phfwdFindPrefixMatch(Node *t, const char *num, size_t num_length,
+                     size_t *depth_in_characters, Node **parent);
+
+/**
+ * Długość najdłuższej ścieżki od węzła do liścia jego poddrzewa, wliczając
+ * klucz węzła, oraz długość najdłuższego przekierowania w poddrzewie.
+ * @param[in] node          Węzeł
+ * @param[in, out] stack    Pusty stos, którego można użyć do przeglądania
+ * @param[out] height       Długość ścieżki w znakach
+ * @param[out] longest      Długość najdłuższego przekierowania
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool subtreeHeight(Node *node, NodeStack *stack, size_t *height,
+                   size_t *longest);
+
+/**
+ * Znajduje węzeł usuwany razem z poddrzewem przez usunięcie prefiksu @p num,
+ * czyli węzeł, w którego kluczu kończy się ścieżka @p num.
+ * @param[in] root          Korzeń drzewa przekierowań
+ * @param[in] num           Numer
+ * @param[in] num_length    Długość numeru, dodatnia
+ * @param[out] depth        Długość ścieżki od korzenia do rodzica węzła
+ * @param[out] parent       Rodzic węzła; może być NULL, jeżeli nie jest potrzebny
+ * @return Wskaźnik na węzeł lub NULL, jeżeli nie ma czego usuwać.
+ */
+Node *findSubtree(Node *root, char const *num, size_t num_length, size_t *depth,
+                  Node **parent);
+
+/**
+ * Wyznacza przekierowanie numeru w drzewie o podanym korzeniu, bez pamięci
+ * podręcznej.
+ * @param[in] root  Korzeń drzewa przekierowań lub NULL
+ * @param[in] num   Numer; dla napisu niebędącego numerem wynik jest pusty
+ * @return Wskaźnik na strukturę z numerami lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+struct PhoneNumbers *treeGet(Node *root, char const *num);
+
+/**
+ * Wyznacza przekierowania na numer według indeksu odwrotnego o podanym
+ * korzeniu.
+ * @param[in] targets   Korzeń indeksu odwrotnego lub NULL
+ * @param[in] num       Numer; dla napisu niebędącego numerem wynik jest pusty
+ * @return Wskaźnik na strukturę z numerami lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+struct PhoneNumbers *treeReverse(Node *targets, char const *num);
+
+/**
+ * Sprawdza czy w ciągu znaków num znajdują się tylko znaki uznawane za cyfry.
+ * @param num Sprawdzany ciąg znaków
+ * @return False gdy w ciągu znajduje się znak niebędący cyfrą od 0 do 9. True w pozostałych przypadkach.
+ */
+static inline bool isNumber(const char *num) {
+    //Według definicji, pusty ciąg znaków nie jest numerem
+    if (num == NULL) {
+        return false;
+    }
+
+    // Numerem jest napis, którego cyfry kończą się dopiero na znaku '\0'
+    size_t len = numberSpan(num);
+    return len != 0 && num[len] == '\0';
+}
+
+/**
+ * Rozmiar pamięci na cyfry długiego napisu, zaokrąglony do pełnych słów.
+ * @param[in] length Liczba cyfr
+ * @return Rozmiar w bajtach.
+ */
+static inline size_t packedSize(size_t length) {
+    return (length + DIGITS_PER_WORD - 1) / DIGITS_PER_WORD * sizeof(uint64_t);
+}
+
+/**
+ * Zwraca wskaźnik na spakowane cyfry napisu.
+ * @param[in] s Napis
+ * @return Wskaźnik na cyfry.
+ */
+static inline unsigned char *stringDigits(ShortString const *s) {
+    return s->length > INLINE_STRING_CAPACITY ? s->heap
+                                              : (unsigned char *) s->inline_digits;
+}
+
+/**
+ * Odczytuje cyfrę spakowanego napisu.
+ * @param[in] digits    Spakowane cyfry
+ * @param[in] i         Pozycja cyfry
+ * @return Wartość `cyfra - '0'`.
+ */
+static inline unsigned packedDigit(unsigned char const *digits, size_t i) {
+    return i % 2 == 0 ? digits[i / 2] >> 4 : digits[i / 2] & 0x0F;
+}
+
+/**
+ * Zapisuje cyfrę w spakowanym napisie, którego bity na jej miejscu są zerami.
+ * @param[in, out] digits   Spakowane cyfry
+ * @param[in] i             Pozycja cyfry
+ * @param[in] value         Wartość `cyfra - '0'`
+ */
+static inline void packedSetDigit(unsigned char *digits, size_t i, unsigned value) {
+    digits[i / 2] |= (unsigned char) (i % 2 == 0 ? value << 4 : value);
+}
+
+/**
+ * Odczytuje znak napisu.
+ * @param[in] s Napis
+ * @param[in] i Pozycja znaku, mniejsza od długości napisu
+ * @return Znak.
+ */
+static inline char stringChar(ShortString const *s, size_t i) {
+    return (char) ('0' + packedDigit(stringDigits(s), i));
+}
+
+/**
+ * Rozpakowuje napis do bufora znaków. Wywoływana tylko tam, gdzie powstają
+ * numery zwracane na zewnątrz lub przekazywane dalej jako znaki.
+ * @param[in] s     Napis
+ * @param[out] out  Bufor na co najmniej `s->length` znaków; nie jest
+ *                  dopisywany znak '\0'
+ */
+static inline void stringUnpack(ShortString const *s, char *out) {
+    unsigned char const *digits = stringDigits(s);
+    size_t i = 0;
+    for (; i + 1 < s->length; i += 2) {
+        out[i] = (char) ('0' + (digits[i / 2] >> 4));
+        out[i + 1] = (char) ('0' + (digits[i / 2] & 0x0F));
+    }
+
+    if (i < s->length)
+        out[i] = (char) ('0' + (digits[i / 2] >> 4));
+}
+
+/**
+ * Ustawia napis jako pusty, bez zwalniania pamięci.
+ * @param[out] s Napis
+ */
+static inline void stringIni(ShortString *s) {
+    s->length = 0;
+}
+
+/**
+ * Zwalnia pamięć napisu i ustawia go jako pusty.
+ * @param[in] pf        Baza, z której alokatora pochodzi napis
+ * @param[in, out] s    Napis
+ */
+static inline void stringClear(PhoneForward *pf, ShortString *s) {
+    if (s->length > INLINE_STRING_CAPACITY)
+        arenaFree(&pf->bytes, s->heap, packedSize(s->length));
+
+    stringIni(s);
+}
+
+/**
+ * Nadaje napisowi wartość @p str.
+ * @param[in] pf        Baza, z której alokatora pochodzi napis
+ * @param[in, out] s    Nadpisywany napis
+ * @param[in] str       Nowa wartość
+ * @param[in] length    Długość nowej wartości
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static inline bool stringAssign(PhoneForward *pf, ShortString *s, const char *str,
+                                size_t length) {
+    return stringAssignConcat(pf, s, str, length, "", 0);
+}
+
+/**
+ * Przenosi napis @p from do @p to, zostawiając @p from pustym.
+ * @param[out] to       Napis docelowy, wcześniej wyczyszczony
+ * @param[in, out] from Napis źródłowy
+ */
+static inline void stringMove(ShortString *to, ShortString *from) {
+    *to = *from;
+    stringIni(from);
+}
+
+/**
+ * Wczytuje osiem bajtów jako liczbę, pierwszy bajt jako najstarszy.
+ * @param[in] bytes Bajty
+ * @return Liczba.
+ */
+static inline uint64_t loadBigEndian(unsigned char const *bytes) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++)
+        word = word << 8 | bytes[i];
+
+    return word;
+}
+
+/**
+ * Pakuje osiem znaków numeru w 32 bity, pierwszy znak w najstarszych bitach.
+ * @param[in] chars Znaki
+ * @return Spakowane cyfry.
+ */
+static inline uint64_t packEightChars(char const *chars) {
+    // Każdy bajt ma wartość mniejszą od 16, więc łączę kolejno pary bajtów,
+    // pary połówek i pary ćwiartek słowa
+    uint64_t word = loadBigEndian((unsigned char const *) chars) -
+                    0x3030303030303030ULL;
+    word = (word | word >> 4) & 0x00FF00FF00FF00FFULL;
+    word = (word | word >> 8) & 0x0000FFFF0000FFFFULL;
+    return (word | word >> 16) & 0x00000000FFFFFFFFULL;
+}
+
+/**
+ * Pakuje do DIGITS_PER_WORD znaków numeru w słowo, pierwszy znak
+ * w najstarszych bitach; brakujące cyfry są zerami.
+ * @param[in] chars     Znaki
+ * @param[in] length    Liczba dostępnych znaków
+ * @return Spakowane cyfry.
+ */
+static inline uint64_t packWord(char const *chars, size_t length) {
+    char padded[DIGITS_PER_WORD];
+    if (length < DIGITS_PER_WORD) {
+        memset(padded, '0', sizeof(padded));
+        memcpy(padded, chars, length);
+        chars = padded;
+    }
+
+    return packEightChars(chars) << 32 | packEightChars(chars + 8);
+}
+
+/**
+ * Wyznacza liczbę początkowych zerowych czwórek bitów niezerowego słowa.
+ * @param[in] word Słowo
+ * @return Pozycja pierwszej różniącej się cyfry.
+ */
+static inline size_t leadingZeroDigits(uint64_t word) {
+#if defined(__GNUC__)
+    return (size_t) __builtin_clzll(word) / 4;
+#else
+    size_t digits = 0;
+    while ((word & 0xF000000000000000ULL) == 0) {
+        word <<= 4;
+        digits++;
+    }
+
+    return digits;
+#endif
+}
+
+/**
+ * Szuka długości najdłuższego wspólnego prefiksu spakowanego klucza i numeru.
+ * @details Numer pakowany jest po DIGITS_PER_WORD znaków, a następnie
+ * porównywany z kluczem całymi słowami. Krótkie klucze, zwykle bliżej liści,
+ * porównywane są cyfra po cyfrze.
+ * @param[in] key           Klucz
+ * @param[in] num           Numer
+ * @param[in] num_length    Długość numeru
+ * @return Długość wspólnego prefiksu.
+ */
+static inline size_t keyCommonPrefix(ShortString const *key, char const *num,
+                                     size_t num_length) {
+    size_t limit = key->length < num_length ? key->length : num_length;
+    unsigned char const *digits = stringDigits(key);
+
+    if (limit < DIGITS_PER_WORD / 2) {
+        for (size_t i = 0; i < limit; i++) {
+            if (packedDigit(digits, i) != (unsigned) (num[i] - '0'))
+                return i;
+        }
+
+        return limit;
+    }
+
+    for (size_t i = 0; i < limit; i += DIGITS_PER_WORD) {
+        uint64_t diff = packWord(num + i, num_length - i) ^
+                        loadBigEndian(digits + i / 2);
+        if (limit - i < DIGITS_PER_WORD)
+            diff &= ~(~0ULL >> 4 * (limit - i));
+
+        if (diff != 0)
+            return i + leadingZeroDigits(diff);
+    }
+
+    return limit;
+}
+
+/**
+ * Sprawdza, czy napis jest równy numerowi.
+ * @param[in] s         Napis
+ * @param[in] num       Numer
+ * @param[in] length    Długość numeru
+ * @return True, jeżeli napisy są równe, false w p.p.
+ */
+static inline bool stringEquals(ShortString const *s, char const *num,
+                                size_t length) {
+    return s->length == length && keyCommonPrefix(s, num, length) == length;
+}
+
+/**
+ * Zwraca pierwszy znak klucza węzła.
+ * @param[in] node Węzeł o niepustym kluczu
+ * @return Znak.
+ */
+static inline char nodeFirstChar(Node const *node) {
+    return stringChar(&node->key, 0);
+}
+
+/**
+ * Przenosi wartość węzła @p from do węzła @p to, zostawiając @p from bez wartości.
+ * Działa dla węzłów obu drzew, bo napis @p phfwd obejmuje całą unię wartości.
+ * @param[out] to       Węzeł docelowy bez wartości
+ * @param[in, out] from Węzeł źródłowy
+ */
+static inline void nodeMoveValue(Node *to, Node *from) {
+    stringMove(&to->phfwd, &from->phfwd);
+    to->terminal = from->terminal;
+    from->terminal = false;
+}
+
+/**
+ * Zamienia cyfrę na indeks w gęstej tablicy dzieci.
+ * Na szczęście, w tablicy ascii : oraz ; występują w tej kolejności
+ * zaraz po cyfrach 0 - 9.
+ * @param c Cyfra
+ * @return Indeks z przedziału [0, NUMBER_OF_DIGITS).
+ */
+static inline size_t digitIndex(char c) {
+    return (size_t) (c - '0');
+}
+
+/**
+ * Liczba pól tablicy dzieci, które należy przejrzeć, aby odwiedzić wszystkie dzieci.
+ * @param[in] node Węzeł
+ * @return NUMBER_OF_DIGITS dla węzła gęstego, liczba dzieci w p.p.
+ */
+static inline size_t childSlots(Node const *node) {
+    return node->dense ? NUMBER_OF_DIGITS : node->children_count;
+}
+
+/**
+ * Rozmiar tablicy dzieci węzła w bajtach.
+ * @param[in] dense Czy tablica jest gęsta
+ * @return Rozmiar tablicy.
+ */
+static inline size_t childrenTableSize(bool dense) {
+    return (dense ? NUMBER_OF_DIGITS : SPARSE_CHILDREN_CAPACITY) * sizeof(Node *);
+}
+
+/**
+ * Szuka dziecka, którego klucz zaczyna się od znaku @p c.
+ * @param[in] node Węzeł-rodzic
+ * @param[in] c    Pierwszy znak klucza dziecka
+ * @return Wskaźnik na dziecko lub NULL, jeżeli takie nie istnieje.
+ */
+static inline Node *findChild(Node const *node, char c) {
+    if (node->dense)
+        return node->children[digitIndex(c)];
+
+    // Klucze są posortowane, więc można przerwać po minięciu szukanego znaku
+    for (size_t i = 0; i < node->children_count && node->child_keys[i] <= c; i++) {
+        if (node->child_keys[i] == c)
+            return node->children[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Inicjalizuje pusty stos.
+ * @param[out] stack Stos
+ */
+static inline void stackIni(NodeStack *stack) {
+    stack->frames = NULL;
+    stack->size = 0;
+    stack->capacity = 0;
+}
+
+/**
+ * Zwalnia pamięć stosu.
+ * @param[in, out] stack Stos
+ */
+static inline void stackFree(NodeStack *stack) {
+    free((void *) stack->frames);
+    stackIni(stack);
+}
+
+/**
+ * Zdejmuje element ze szczytu stosu.
+ * @param[in, out] stack Niepusty stos
+ * @return Zdjęty element.
+ */
+static inline NodeFrame stackPop(NodeStack *stack) {
+    return stack->frames[--stack->size];
+}
+
+/**
+ * Zwraca jedyne dziecko węzła.
+ * @param[in] node Węzeł z dokładnie jednym dzieckiem
+ * @return Dziecko.
+ */
+static inline Node *onlyChild(Node const *node) {
+    Node *child = node->children[0];
+    if (node->dense) {
+        for (size_t i = 0; child == NULL; i++)
+            child = node->children[i];
+    }
+
+    return child;
+}
+
+#endif //TELEFONY_FORWARD_TREE_H
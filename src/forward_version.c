@@ -0,0 +1,715 @@
+#include <stdlib.h>
+#include <string.h>
+#include "forward_tree.h"
+#include "forward_version.h"
+#include "get_cache.h"
+
+/**
+ * @struct retired_node
+ * @details Węzeł czekający na zwolnienie.
+ */
+typedef struct retired_node {
+    Node *node;     ///< Węzeł
+    bool target;    ///< Czy węzeł należy do drzewa indeksu odwrotnego kluczowanego numerami, na które przekierowano
+    bool subtree;   ///< Czy zwalniane jest całe poddrzewo węzła
+} RetiredNode;
+
+/**
+ * @struct retired_list
+ * @details Rosnąca tablica węzłów czekających na zwolnienie.
+ */
+typedef struct retired_list {
+    RetiredNode *items; ///< Węzły
+    size_t count;       ///< Liczba węzłów
+    size_t capacity;    ///< Rozmiar tablicy
+} RetiredList;
+
+/**
+ * @struct PhoneForwardVersion forward_version.h
+ * @details Korzenie drzewa przekierowań i indeksu odwrotnego jednej wersji
+ * bazy. Kolejne wersje współdzielą niezmienione węzły; wersja przechowuje
+ * węzły, których nie używa już następna wersja, i zwalnia je razem z sobą.
+ */
+struct PhoneForwardVersion {
+    PhoneForward *pf;       ///< Baza, z której alokatorów pochodzą węzły
+    Node *root;             ///< Korzeń drzewa przekierowań
+    Node *targets;          ///< Korzeń indeksu odwrotnego
+    RetiredList retired;    ///< Węzły tej wersji, których nie używa następna
+};
+typedef struct PhoneForwardVersion PhoneForwardVersion; ///< domyślny typedef
+
+/**
+ * @struct version_builder
+ * @details Stan budowania nowej wersji bazy. Węzły poprzedniej wersji nie są
+ * zmieniane: zmieniane są ich kopie, oznaczone polem @p building, dzięki
+ * czemu każdy węzeł jest kopiowany najwyżej raz.
+ */
+typedef struct version_builder {
+    PhoneForward *pf;       ///< Baza
+    Node *root;             ///< Korzeń drzewa przekierowań nowej wersji
+    Node *targets;          ///< Korzeń indeksu odwrotnego nowej wersji
+    RetiredList retired;    ///< Węzły poprzedniej wersji, których nie używa nowa
+    RetiredList fresh;      ///< Węzły utworzone dla nowej wersji
+    RetiredList dead;       ///< Utworzone węzły, które nie weszły do nowej wersji
+    Node **path;            ///< Ścieżka znaleziona przez ostatnie versionDescend, od korzenia
+    size_t path_length;     ///< Liczba węzłów ścieżki
+    size_t path_capacity;   ///< Rozmiar tablicy ścieżki
+    PhoneForwardVersion *next; ///< Zaalokowana z góry struktura nowej wersji
+} VersionBuilder;
+
+/**
+ * Zapewnia miejsce na kolejne węzły na liście.
+ * @param[in, out] list Lista
+ * @param[in] extra     Liczba dopisywanych węzłów
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool retiredReserve(RetiredList *list, size_t extra) {
+    if (list->count + extra <= list->capacity)
+        return true;
+
+    size_t capacity = 2 * list->capacity > list->count + extra ?
+                      2 * list->capacity : list->count + extra;
+    RetiredNode *items = realloc(list->items, capacity * sizeof(RetiredNode));
+    if (items == NULL)
+        return false;
+
+    list->items = items;
+    list->capacity = capacity;
+    return true;
+}
+
+/**
+ * Dopisuje węzeł do listy.
+ * @param[in, out] list Lista
+ * @param[in] node      Węzeł
+ * @param[in] target    Czy węzeł należy do drzewa numerów, na które przekierowano
+ * @param[in] subtree   Czy zwalniane będzie całe poddrzewo węzła
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool retiredPush(RetiredList *list, Node *node, bool target, bool subtree) {
+    if (!retiredReserve(list, 1))
+        return false;
+
+    list->items[list->count].node = node;
+    list->items[list->count].target = target;
+    list->items[list->count].subtree = subtree;
+    list->count++;
+    return true;
+}
+
+/**
+ * Zwalnia węzły z listy i samą listę.
+ * @param[in] pf        Baza, do której należą węzły
+ * @param[in, out] list Lista
+ */
+static void retiredRelease(PhoneForward *pf, RetiredList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        RetiredNode *r = &list->items[i];
+        if (r->subtree) {
+            nodeDelete(pf, r->node);
+        } else {
+            // Węzeł indeksu z wartością wskazuje drzewo, a nie napis
+            if (r->target && r->node->terminal)
+                stringIni(&r->node->phfwd);
+            nodeFree(pf, r->node);
+        }
+    }
+
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+/**
+ * Dopisuje do budowanej wersji nowy węzeł.
+ * Lista nowych węzłów musi mieć na niego miejsce.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in, out] node Węzeł
+ * @param[in] target    Czy węzeł należy do drzewa numerów, na które przekierowano
+ */
+static inline void builderFresh(VersionBuilder *b, Node *node, bool target) {
+    node->building = true;
+    retiredPush(&b->fresh, node, target, false);
+}
+
+/**
+ * Zwraca węzeł budowanej wersji odpowiadający węzłowi @p node, w razie
+ * potrzeby kopiując go. Kopia ma własny klucz, wartość i tablicę dzieci,
+ * ale wskazuje te same dzieci co oryginał.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in] node      Węzeł
+ * @param[in] target    Czy węzeł należy do drzewa numerów, na które przekierowano
+ * @return Węzeł, który można zmieniać, lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+static Node *builderCopy(VersionBuilder *b, Node *node, bool target) {
+    if (node->building)
+        return node;
+
+    if (!retiredReserve(&b->fresh, 1) || !retiredReserve(&b->retired, 1))
+        return NULL;
+
+    PhoneForward *pf = b->pf;
+    Node *copy = nodeNew(pf, "", 0, NULL);
+    Node **table = NULL;
+    if (copy != NULL && node->children != NULL)
+        table = arenaAlloc(&pf->bytes, childrenTableSize(node->dense));
+
+    // Wartością węzła indeksu odwrotnego jest wskaźnik, a nie napis
+    bool shared_value = target && node->terminal;
+    if (copy == NULL || (node->children != NULL && table == NULL) ||
+        !stringAssignSlice(pf, &copy->key, &node->key, 0, node->key.length,
+                           NULL, 0) ||
+        (!shared_value &&
+         !stringAssignSlice(pf, &copy->phfwd, &node->phfwd, 0,
+                            node->phfwd.length, NULL, 0))) {
+        if (table != NULL)
+            arenaFree(&pf->bytes, table, childrenTableSize(node->dense));
+        if (copy != NULL)
+            nodeFree(pf, copy);
+        return NULL;
+    }
+
+    if (shared_value)
+        copy->sources = node->sources;
+    copy->terminal = node->terminal;
+
+    if (table != NULL)
+        memcpy(table, node->children, childrenTableSize(node->dense));
+    copy->children = table;
+    copy->children_count = node->children_count;
+    copy->dense = node->dense;
+    memcpy(copy->child_keys, node->child_keys, sizeof(node->child_keys));
+
+    builderFresh(b, copy, target);
+    retiredPush(&b->retired, node, target, false);
+    return copy;
+}
+
+/**
+ * Zamienia w tablicy dzieci węzła jedno dziecko na inne o tym samym
+ * pierwszym znaku klucza.
+ * @param[in, out] node Węzeł-rodzic
+ * @param[in] old       Zamieniane dziecko
+ * @param[in] new       Nowe dziecko
+ */
+static void replaceChild(Node *node, Node const *old, Node *new) {
+    if (node->dense) {
+        node->children[digitIndex(nodeFirstChar(new))] = new;
+        return;
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (node->children[i] == old)
+            node->children[i] = new;
+    }
+}
+
+/**
+ * Znajduje w budowanej wersji węzeł, którego ścieżka od korzenia jest równa
+ * @p key, kopiując węzły poprzedniej wersji leżące na tej ścieżce, a w razie
+ * potrzeby tworząc go lub dzieląc istniejący węzeł. Znalezioną ścieżkę
+ * zapisuje w @p b.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in, out] root Wskaźnik na korzeń drzewa
+ * @param[in] target    Czy drzewo jest indeksem odwrotnym
+ * @param[in] key       Ścieżka szukanego węzła
+ * @param[in] key_length Długość ścieżki
+ * @return Wskaźnik na węzeł lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static Node *versionDescend(VersionBuilder *b, Node **root, bool target,
+                            char const *key, size_t key_length) {
+    // Każdy węzeł poza korzeniem ma niepusty klucz
+    if (b->path_capacity < key_length + 2) {
+        Node **path = realloc(b->path, (key_length + 2) * sizeof(Node *));
+        if (path == NULL)
+            return NULL;
+
+        b->path = path;
+        b->path_capacity = key_length + 2;
+    }
+
+    Node *t = builderCopy(b, *root, target);
+    if (t == NULL)
+        return NULL;
+
+    *root = t;
+    b->path_length = 0;
+    b->path[b->path_length++] = t;
+
+    size_t depth = 0;
+    while (depth < key_length) {
+        Node *child = findChild(t, key[depth]);
+        if (child == NULL)
+            break;
+
+        Node *copy = builderCopy(b, child, target);
+        if (copy == NULL)
+            return NULL;
+        replaceChild(t, child, copy);
+
+        // Dziecko pasujące częściowo trzeba podzielić
+        size_t common_prefix_len = keyCommonPrefix(&copy->key, key + depth,
+                                                   key_length - depth);
+        if (common_prefix_len < copy->key.length) {
+            if (!retiredReserve(&b->fresh, 1) ||
+                !splitNode(b->pf, copy, common_prefix_len))
+                return NULL;
+            builderFresh(b, copy->children[0], target);
+        }
+
+        depth += common_prefix_len;
+        t = copy;
+        b->path[b->path_length++] = t;
+    }
+
+    if (depth < key_length) {
+        if (!retiredReserve(&b->fresh, 1))
+            return NULL;
+
+        Node *leaf = nodeNew(b->pf, key + depth, key_length - depth, NULL);
+        if (leaf == NULL)
+            return NULL;
+        if (!insertChild(b->pf, t, leaf)) {
+            nodeFree(b->pf, leaf);
+            return NULL;
+        }
+
+        builderFresh(b, leaf, target);
+        t = leaf;
+        b->path[b->path_length++] = t;
+    }
+
+    return t;
+}
+
+/**
+ * Łączy węzeł budowanej wersji z jego jedynym dzieckiem.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in, out] node Węzeł budowanej wersji bez wartości z jednym dzieckiem
+ * @param[in] target    Czy węzeł należy do drzewa numerów, na które przekierowano
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionMerge(VersionBuilder *b, Node *node, bool target) {
+    Node *child = onlyChild(node);
+    Node *copy = builderCopy(b, child, target);
+    if (copy == NULL || !retiredReserve(&b->dead, 1))
+        return false;
+    replaceChild(node, child, copy);
+
+    Node *detached = absorbChild(b->pf, node);
+    if (detached == NULL)
+        return false;
+
+    retiredPush(&b->dead, detached, target, false);
+    return true;
+}
+
+/**
+ * Usuwa zbędne węzły z końca ścieżki znalezionej przez versionDescend:
+ * węzły bez wartości i dzieci usuwa, a węzeł bez wartości z jednym dzieckiem
+ * łączy z tym dzieckiem. Korzeń drzewa zostaje zawsze.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in] target    Czy drzewo jest indeksem odwrotnym
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionPrune(VersionBuilder *b, bool target) {
+    for (size_t i = b->path_length - 1; i > 0; i--) {
+        Node *node = b->path[i];
+        if (node->terminal)
+            return true;
+
+        if (node->children_count == 1)
+            return versionMerge(b, node, target);
+
+        if (node->children_count > 1)
+            return true;
+
+        if (!retiredReserve(&b->dead, 1))
+            return false;
+        removeChild(b->pf, b->path[i - 1], nodeFirstChar(node));
+        retiredPush(&b->dead, node, target, false);
+    }
+
+    return true;
+}
+
+/**
+ * Zapisuje w indeksie odwrotnym budowanej wersji, że numer @p source jest
+ * przekierowany na @p target.
+ * @param[in, out] b            Stan budowania wersji
+ * @param[in] target            Numer, na który przekierowano
+ * @param[in] target_length     Długość numeru @p target
+ * @param[in] source            Przekierowany numer
+ * @param[in] source_length     Długość numeru @p source
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionReverseAdd(VersionBuilder *b, char const *target,
+                              size_t target_length, char const *source,
+                              size_t source_length) {
+    Node *node = versionDescend(b, &b->targets, true, target, target_length);
+    if (node == NULL)
+        return false;
+
+    if (!node->terminal) {
+        if (!retiredReserve(&b->fresh, 1))
+            return false;
+
+        Node *sources = nodeNew(b->pf, "", 0, NULL);
+        if (sources == NULL)
+            return false;
+
+        builderFresh(b, sources, false);
+        node->sources = sources;
+        node->terminal = true;
+    }
+
+    Node *entry = versionDescend(b, &node->sources, false, source, source_length);
+    if (entry == NULL)
+        return false;
+
+    entry->terminal = true;
+    return true;
+}
+
+/**
+ * Usuwa z indeksu odwrotnego budowanej wersji informację, że numer
+ * @p source jest przekierowany na @p target. Nic nie robi, jeżeli jej tam nie ma.
+ * @param[in, out] b            Stan budowania wersji
+ * @param[in] target            Numer, na który przekierowano
+ * @param[in] target_length     Długość numeru @p target
+ * @param[in] source            Przekierowany numer
+ * @param[in] source_length     Długość numeru @p source
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionReverseRemove(VersionBuilder *b, char const *target,
+                                 size_t target_length, char const *source,
+                                 size_t source_length) {
+    // Najpierw sprawdzam bez kopiowania, czy jest co usuwać
+    size_t depth = 0;
+    Node *node = phfwdFindPrefixMatch(b->targets, target, target_length, &depth,
+                                      NULL);
+    if (depth != target_length || !node->terminal)
+        return true;
+
+    Node *entry = phfwdFindPrefixMatch(node->sources, source, source_length,
+                                       &depth, NULL);
+    if (depth != source_length || !entry->terminal)
+        return true;
+
+    node = versionDescend(b, &b->targets, true, target, target_length);
+    if (node == NULL)
+        return false;
+
+    entry = versionDescend(b, &node->sources, false, source, source_length);
+    if (entry == NULL)
+        return false;
+
+    entry->terminal = false;
+    if (!versionPrune(b, false))
+        return false;
+
+    if (node->sources->children_count > 0)
+        return true;
+
+    if (!retiredReserve(&b->dead, 1))
+        return false;
+    retiredPush(&b->dead, node->sources, false, false);
+    stringIni(&node->phfwd);
+    node->terminal = false;
+
+    // Węzły ścieżki są już kopiami, więc ponowne zejście nic nie alokuje
+    versionDescend(b, &b->targets, true, target, target_length);
+    return versionPrune(b, true);
+}
+
+/**
+ * Przygotowuje budowanie wersji następującej po @p version.
+ * @param[out] b        Stan budowania wersji
+ * @param[in] version   Najnowsza wersja bazy
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool builderIni(VersionBuilder *b, PhoneForwardVersion const *version) {
+    RetiredList empty = {NULL, 0, 0};
+
+    b->pf = version->pf;
+    b->root = version->root;
+    b->targets = version->targets;
+    b->retired = empty;
+    b->fresh = empty;
+    b->dead = empty;
+    b->path = NULL;
+    b->path_length = 0;
+    b->path_capacity = 0;
+
+    // Nową wersję alokuję od razu, aby zakończenie budowania nie mogło zawieść
+    b->next = malloc(sizeof(PhoneForwardVersion));
+    return b->next != NULL;
+}
+
+/**
+ * Kończy budowanie wersji. Po udanej zmianie publikuje nową wersję w bazie,
+ * a węzły, których już nie używa, oddaje poprzedniej wersji. Po nieudanej
+ * zwalnia wszystkie utworzone węzły, więc poprzednia wersja się nie zmienia.
+ * @param[in, out] b        Stan budowania wersji
+ * @param[in, out] version  Poprzednia wersja
+ * @param[in] success       Czy zmiana się udała
+ * @return Nowa wersja lub NULL, jeżeli zmiana się nie udała.
+ */
+static PhoneForwardVersion *builderFinish(VersionBuilder *b,
+                                          PhoneForwardVersion *version,
+                                          bool success) {
+    PhoneForwardVersion *next = b->next;
+    RetiredList empty = {NULL, 0, 0};
+
+    if (success) {
+        for (size_t i = 0; i < b->fresh.count; i++)
+            b->fresh.items[i].node->building = false;
+        free((void *) b->fresh.items);
+        retiredRelease(b->pf, &b->dead);
+
+        version->retired = b->retired;
+        next->pf = b->pf;
+        next->root = b->root;
+        next->targets = b->targets;
+        next->retired = empty;
+
+        b->pf->root = b->root;
+        b->pf->targets = b->targets;
+    } else {
+        // Usunięte węzły zostały też utworzone dla tej wersji
+        retiredRelease(b->pf, &b->fresh);
+        free((void *) b->dead.items);
+        free((void *) b->retired.items);
+        free((void *) next);
+        next = NULL;
+    }
+
+    free((void *) b->path);
+    return next;
+}
+
+PhoneForwardVersion *phfwdVersionNew(struct PhoneForward *pf) {
+    if (pf == NULL)
+        return NULL;
+
+    PhoneForwardVersion *version = malloc(sizeof(PhoneForwardVersion));
+    if (version == NULL)
+        return NULL;
+
+    version->pf = pf;
+    version->root = pf->root;
+    version->targets = pf->targets;
+    version->retired.items = NULL;
+    version->retired.count = 0;
+    version->retired.capacity = 0;
+    return version;
+}
+
+void phfwdVersionDelete(PhoneForwardVersion *version) {
+    if (version == NULL)
+        return;
+
+    retiredRelease(version->pf, &version->retired);
+    free((void *) version);
+}
+
+/**
+ * Ustawia w budowanej wersji przekierowanie numeru @p num1 na @p num2.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in] num1      Przekierowywany numer
+ * @param[in] num1_len  Długość numeru @p num1
+ * @param[in] num2      Przekierowanie
+ * @param[in] num2_len  Długość numeru @p num2
+ * @param[in] local     Bufor o rozmiarze UNPACK_BUFFER_SIZE
+ * @param[out] replaced Nadpisane przekierowanie zakończone '\0', zapisane
+ *                      w @p local lub w pamięci, którą należy zwolnić;
+ *                      bez zmian, jeżeli nic nie nadpisano
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionAddUtil(VersionBuilder *b, char const *num1, size_t num1_len,
+                           char const *num2, size_t num2_len, char *local,
+                           char **replaced) {
+    Node *node = versionDescend(b, &b->root, false, num1, num1_len);
+    if (node == NULL)
+        return false;
+
+    ShortString phfwd;
+    stringIni(&phfwd);
+    if (!stringAssign(b->pf, &phfwd, num2, num2_len))
+        return false;
+
+    if (node->terminal) {
+        size_t length = node->phfwd.length;
+        char *old = length < UNPACK_BUFFER_SIZE ? local : malloc(length + 1);
+        if (old == NULL) {
+            stringClear(b->pf, &phfwd);
+            return false;
+        }
+
+        stringUnpack(&node->phfwd, old);
+        old[length] = '\0';
+        *replaced = old;
+    }
+
+    stringClear(b->pf, &node->phfwd);
+    stringMove(&node->phfwd, &phfwd);
+    node->terminal = true;
+
+    if (!versionReverseAdd(b, num2, num2_len, num1, num1_len))
+        return false;
+
+    return *replaced == NULL ||
+           versionReverseRemove(b, *replaced, strlen(*replaced), num1, num1_len);
+}
+
+bool phfwdVersionAdd(PhoneForwardVersion *version, char const *num1,
+                     char const *num2, PhoneForwardVersion **next) {
+    *next = NULL;
+    if (version == NULL || !isNumber(num1) || !isNumber(num2) ||
+        strcmp(num1, num2) == 0)
+        return false;
+
+    size_t num1_len = strlen(num1);
+    size_t num2_len = strlen(num2);
+
+    // Ponowne dodanie istniejącego przekierowania niczego nie zmienia
+    size_t depth = 0;
+    Node *node = phfwdFindPrefixMatch(version->root, num1, num1_len, &depth, NULL);
+    if (depth == num1_len && node->terminal &&
+        stringEquals(&node->phfwd, num2, num2_len))
+        return true;
+
+    VersionBuilder b;
+    char local[UNPACK_BUFFER_SIZE];
+    char *replaced = NULL;
+    bool success = builderIni(&b, version) &&
+                   versionAddUtil(&b, num1, num1_len, num2, num2_len, local,
+                                  &replaced);
+
+    if (replaced != local)
+        free((void *) replaced);
+
+    *next = builderFinish(&b, version, success);
+    if (success && version->pf->cache != NULL)
+        getCacheInvalidate(version->pf->cache, num1, num1_len);
+
+    return success;
+}
+
+/**
+ * Usuwa z indeksu odwrotnego budowanej wersji przekierowania zapisane
+ * w poddrzewie węzła poprzedniej wersji.
+ * @param[in, out] b        Stan budowania wersji
+ * @param[in] node          Węzeł drzewa przekierowań poprzedniej wersji
+ * @param[in, out] stack    Pusty stos, którego można użyć do przeglądania
+ * @param[in, out] path     Bufor z numerem odpowiadającym ścieżce do rodzica węzła,
+ *                          mieszczący najdłuższą ścieżkę w poddrzewie
+ * @param[in] length        Długość numeru w buforze
+ * @param[out] target       Bufor mieszczący najdłuższe przekierowanie w poddrzewie
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionForget(VersionBuilder *b, Node *node, NodeStack *stack,
+                          char *path, size_t length, char *target) {
+    if (!stackPush(stack, node, length))
+        return false;
+
+    while (stack->size > 0) {
+        NodeFrame frame = stackPop(stack);
+        Node *t = frame.node;
+
+        stringUnpack(&t->key, path + frame.depth);
+        length = frame.depth + t->key.length;
+
+        if (t->terminal) {
+            stringUnpack(&t->phfwd, target);
+            if (!versionReverseRemove(b, target, t->phfwd.length, path, length))
+                return false;
+        }
+
+        if (!stackPushChildren(stack, t, length))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Usuwa z budowanej wersji węzeł @p result wraz z poddrzewem.
+ * @param[in, out] b    Stan budowania wersji
+ * @param[in] num       Numer, którego prefiksy są usuwane
+ * @param[in] result    Usuwany węzeł poprzedniej wersji
+ * @param[in] depth     Długość ścieżki do rodzica usuwanego węzła
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool versionRemoveUtil(VersionBuilder *b, char const *num, Node *result,
+                              size_t depth) {
+    NodeStack stack;
+    stackIni(&stack);
+    size_t height = 0;
+    size_t longest = 0;
+    char *path = NULL;
+    char *target = NULL;
+    if (subtreeHeight(result, &stack, &height, &longest)) {
+        path = malloc(depth + height + 1);
+        target = malloc(longest + 1);
+    }
+
+    bool success = path != NULL && target != NULL;
+    if (success) {
+        memcpy(path, num, depth);
+        success = versionForget(b, result, &stack, path, depth, target);
+    }
+
+    free((void *) target);
+    free((void *) path);
+    stackFree(&stack);
+
+    if (!success)
+        return false;
+
+    Node *parent = versionDescend(b, &b->root, false, num, depth);
+    if (parent == NULL || !retiredReserve(&b->retired, 1))
+        return false;
+
+    // Poddrzewo nie jest częścią nowej wersji, ale używa go poprzednia
+    removeChild(b->pf, parent, nodeFirstChar(result));
+    retiredPush(&b->retired, result, false, true);
+    return versionPrune(b, false);
+}
+
+bool phfwdVersionRemove(PhoneForwardVersion *version, char const *num,
+                        PhoneForwardVersion **next) {
+    *next = NULL;
+    if (version == NULL)
+        return false;
+
+    if (!isNumber(num))
+        return true;
+
+    size_t num_length = strlen(num);
+    size_t depth = 0;
+    Node *result = findSubtree(version->root, num, num_length, &depth, NULL);
+    if (result == NULL)
+        return true;
+
+    VersionBuilder b;
+    bool success = builderIni(&b, version) &&
+                   versionRemoveUtil(&b, num, result, depth);
+
+    *next = builderFinish(&b, version, success);
+    if (success && version->pf->cache != NULL)
+        getCacheInvalidate(version->pf->cache, num, num_length);
+
+    return success;
+}
+
+struct PhoneNumbers const *phfwdVersionGet(PhoneForwardVersion const *version,
+                                           char const *num) {
+    return treeGet(version != NULL ? version->root : NULL, num);
+}
+
+struct PhoneNumbers const *phfwdVersionReverse(PhoneForwardVersion const *version,
+                                               char const *num) {
+    return treeReverse(version != NULL ? version->targets : NULL, num);
+}
@@ -0,0 +1,93 @@
+/** @file
+ * Interfejs niezmiennych wersji bazy przekierowań, współdzielących
+ * niezmienione węzły drzewa
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_FORWARD_VERSION_H
+#define TELEFONY_FORWARD_VERSION_H
+
+#include <stdbool.h>
+#include "phone_forward.h"
+
+/**
+ * @struct PhoneForwardVersion
+ * @brief Niezmienna wersja struktury przechowującej przekierowania,
+ * współdzieląca niezmienione węzły z kolejnymi wersjami.
+ */
+struct PhoneForwardVersion;
+
+/** @brief Tworzy wersję bazy przekierowań.
+ * Tworzy wersję odpowiadającą obecnemu stanowi bazy. Dopóki istnieją wersje
+ * bazy, można ją zmieniać wyłącznie funkcjami @ref phfwdVersionAdd
+ * i @ref phfwdVersionRemove, wywoływanymi dla najnowszej wersji.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy @p pf ma wartość NULL
+ *         lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForwardVersion *phfwdVersionNew(struct PhoneForward *pf);
+
+/** @brief Usuwa wersję bazy.
+ * Zwalnia wersję i węzły, których nie używa już następna wersja. Nic nie robi,
+ * jeśli @p version ma wartość NULL. Baza musi jeszcze istnieć.
+ * @param[in] version – wskaźnik na usuwaną strukturę.
+ */
+void phfwdVersionDelete(struct PhoneForwardVersion *version);
+
+/** @brief Tworzy wersję bazy z dodanym przekierowaniem.
+ * Działa jak @ref phfwdAdd, ale nie zmienia węzłów @p version: kopiuje tylko
+ * węzły na ścieżkach, które zmienia, więc koszt nie zależy od rozmiaru bazy.
+ * Nowa wersja staje się najnowszą wersją bazy.
+ * @param[in, out] version – wskaźnik na najnowszą wersję bazy;
+ * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
+ *                   przekierowywanych;
+ * @param[in] num2 – wskaźnik na napis reprezentujący prefiks numerów, na które
+ *                   jest wykonywane przekierowanie;
+ * @param[out] next – nowa wersja lub NULL, jeśli baza się nie zmieniła.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane lub już
+ *         istniało. Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się zaalokować pamięci; wtedy baza się nie zmienia.
+ */
+bool phfwdVersionAdd(struct PhoneForwardVersion *version, char const *num1,
+                     char const *num2, struct PhoneForwardVersion **next);
+
+/** @brief Tworzy wersję bazy z usuniętymi przekierowaniami.
+ * Działa jak @ref phfwdRemove, kopiując tylko zmieniane węzły, tak jak
+ * @ref phfwdVersionAdd.
+ * @param[in, out] version – wskaźnik na najnowszą wersję bazy;
+ * @param[in] num – wskaźnik na napis reprezentujący prefiks numerów;
+ * @param[out] next – nowa wersja lub NULL, jeśli baza się nie zmieniła.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub nie było
+ *         czego usuwać. Wartość @p false, jeśli @p version ma wartość NULL lub
+ *         nie udało się zaalokować pamięci; wtedy baza się nie zmienia.
+ */
+bool phfwdVersionRemove(struct PhoneForwardVersion *version, char const *num,
+                        struct PhoneForwardVersion **next);
+
+/** @brief Wyznacza przekierowanie numeru w wersji bazy.
+ * Działa jak @ref phfwdGet dla bazy w stanie z chwili utworzenia @p version.
+ * Może być wywoływana współbieżnie z tworzeniem kolejnych wersji.
+ * @param[in] version – wskaźnik na wersję bazy;
+ * @param[in] num     – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdVersionGet(struct PhoneForwardVersion const *version,
+                                           char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w wersji bazy.
+ * Działa jak @ref phfwdReverse dla bazy w stanie z chwili utworzenia
+ * @p version. Może być wywoływana współbieżnie z tworzeniem kolejnych wersji.
+ * @param[in] version – wskaźnik na wersję bazy;
+ * @param[in] num     – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdVersionReverse(struct PhoneForwardVersion const *version,
+                                               char const *num);
+
+#endif //TELEFONY_FORWARD_VERSION_H
@@ -0,0 +1,327 @@
+/** @file
+ * Testy porównujące wersje bazy przekierowań i bazę współdzieloną ze zwykłą
+ * bazą przekierowań na losowych ciągach operacji
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "forward_version.h"
+#include "phone_forward.h"
+#include "shared_forward.h"
+
+/**
+ * Liczba sprawdzanych ciągów operacji, każdy z innym ziarnem.
+ */
+#define SEEDS 8
+
+/**
+ * Liczba operacji w jednym ciągu.
+ */
+#define OPERATIONS 1500
+
+/**
+ * Liczba numerów, dla których po każdej operacji porównywane są wyniki
+ * phfwdGet i phfwdReverse.
+ */
+#define QUERIES 32
+
+/**
+ * Liczba zachowywanych poprzednich wersji, których wyniki nie mogą się zmienić.
+ */
+#define SNAPSHOTS 4
+
+/**
+ * Rozmiar bufora na numer, mieszczący numery dłuższe niż napisy
+ * przechowywane bezpośrednio w węźle.
+ */
+#define NUMBER_SIZE 48
+
+/**
+ * @struct snapshot
+ * @details Poprzednia wersja bazy wraz z wynikami zapytań wyznaczonymi
+ * w chwili, gdy była najnowsza.
+ */
+typedef struct snapshot {
+    struct PhoneForwardVersion *version;            ///< Wersja
+    struct PhoneNumbers const *get[QUERIES];        ///< Wyniki phfwdVersionGet
+    struct PhoneNumbers const *reverse[QUERIES];    ///< Wyniki phfwdVersionReverse
+} Snapshot;
+
+/**
+ * Stan generatora liczb losowych.
+ */
+static uint64_t state;
+
+/**
+ * Liczba znalezionych różnic.
+ */
+static size_t failures = 0;
+
+/**
+ * Losuje liczbę z przedziału [0, @p n).
+ * @param[in] n Rozmiar przedziału
+ * @return Wylosowana liczba.
+ */
+static size_t randomBelow(size_t n) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (size_t) (state % n);
+}
+
+/**
+ * Losuje numer z kilku cyfr, aby numery często miały wspólne prefiksy.
+ * Co jakiś czas numer jest dłuższy niż napis przechowywany w węźle,
+ * a co jakiś czas nie jest poprawnym numerem.
+ * @param[out] num Bufor o rozmiarze NUMBER_SIZE
+ */
+static void randomNumber(char *num) {
+    static char const digits[] = "012:";
+    size_t length = randomBelow(16) == 0 ? 33 + randomBelow(NUMBER_SIZE - 34)
+                                         : 1 + randomBelow(6);
+    for (size_t i = 0; i < length; i++)
+        num[i] = digits[randomBelow(sizeof(digits) - 1)];
+    num[length] = '\0';
+
+    if (randomBelow(64) == 0)
+        num[randomBelow(length)] = 'x';
+}
+
+/**
+ * Sprawdza, czy dwa ciągi numerów są równe.
+ * @param[in] a Pierwszy ciąg
+ * @param[in] b Drugi ciąg
+ * @return True, jeżeli ciągi są równe i oba istnieją, false w p.p.
+ */
+static bool sameNumbers(struct PhoneNumbers const *a,
+                        struct PhoneNumbers const *b) {
+    if (a == NULL || b == NULL)
+        return false;
+
+    for (size_t i = 0;; i++) {
+        char const *x = phnumGet(a, i);
+        char const *y = phnumGet(b, i);
+        if (x == NULL || y == NULL)
+            return x == y;
+        if (strcmp(x, y) != 0)
+            return false;
+    }
+}
+
+/**
+ * Zapisuje różnicę wyników.
+ * @param[in] seed      Ziarno ciągu operacji
+ * @param[in] step      Numer operacji w ciągu
+ * @param[in] what      Opis porównania
+ * @param[in] num       Numer, którego dotyczy porównanie
+ */
+static void report(uint64_t seed, size_t step, char const *what,
+                   char const *num) {
+    // Wypisuję tylko kilka pierwszych różnic, resztę wyłącznie liczę
+    if (failures++ < 10)
+        fprintf(stderr, "ziarno %llu, operacja %zu: %s dla %s\n",
+                (unsigned long long) seed, step, what, num);
+}
+
+/**
+ * Porównuje trzy ciągi numerów i zwalnia je.
+ * @param[in] expected  Wynik zwykłej bazy
+ * @param[in] version   Wynik wersji
+ * @param[in] shared    Wynik bazy współdzielonej
+ * @return True, jeżeli wszystkie wyniki są równe, false w p.p.
+ */
+static bool compareAndDelete(struct PhoneNumbers const *expected,
+                             struct PhoneNumbers const *version,
+                             struct PhoneNumbers const *shared) {
+    bool same = sameNumbers(expected, version) && sameNumbers(expected, shared);
+    phnumDelete(expected);
+    phnumDelete(version);
+    phnumDelete(shared);
+    return same;
+}
+
+/**
+ * Zapamiętuje wersję razem z jej obecnymi wynikami zapytań.
+ * @param[out] s        Zapamiętana wersja
+ * @param[in] version   Wersja
+ * @param[in] queries   Numery zapytań
+ */
+static void snapshotIni(Snapshot *s, struct PhoneForwardVersion *version,
+                        char queries[][NUMBER_SIZE]) {
+    s->version = version;
+    for (size_t i = 0; i < QUERIES; i++) {
+        s->get[i] = phfwdVersionGet(version, queries[i]);
+        s->reverse[i] = phfwdVersionReverse(version, queries[i]);
+    }
+}
+
+/**
+ * Sprawdza, czy wyniki zapytań do zapamiętanej wersji się nie zmieniły.
+ * @param[in] s         Zapamiętana wersja
+ * @param[in] queries   Numery zapytań
+ * @param[in] seed      Ziarno ciągu operacji
+ * @param[in] step      Numer operacji w ciągu
+ */
+static void snapshotCheck(Snapshot const *s, char queries[][NUMBER_SIZE],
+                          uint64_t seed, size_t step) {
+    for (size_t i = 0; i < QUERIES; i++) {
+        struct PhoneNumbers const *get = phfwdVersionGet(s->version, queries[i]);
+        struct PhoneNumbers const *reverse = phfwdVersionReverse(s->version,
+                                                                 queries[i]);
+        if (!sameNumbers(s->get[i], get) || !sameNumbers(s->reverse[i], reverse))
+            report(seed, step, "zmiana poprzedniej wersji", queries[i]);
+
+        phnumDelete(get);
+        phnumDelete(reverse);
+    }
+}
+
+/**
+ * Zwalnia zapamiętaną wersję i jej wyniki.
+ * @param[in, out] s Zapamiętana wersja
+ */
+static void snapshotFree(Snapshot *s) {
+    for (size_t i = 0; i < QUERIES; i++) {
+        phnumDelete(s->get[i]);
+        phnumDelete(s->reverse[i]);
+    }
+
+    phfwdVersionDelete(s->version);
+}
+
+/**
+ * Porównuje statystyki drzew dwóch baz, które powinny mieć ten sam kształt.
+ * @param[in] a     Pierwsza baza
+ * @param[in] b     Druga baza
+ * @return True, jeżeli statystyki są równe, false w p.p.
+ */
+static bool sameShape(struct PhoneForward const *a, struct PhoneForward const *b) {
+    struct PhoneForwardStats x, y;
+    if (!phfwdStats(a, &x) || !phfwdStats(b, &y))
+        return false;
+
+    return x.nodes == y.nodes && x.rules == y.rules &&
+           x.max_depth == y.max_depth && x.depth_sum == y.depth_sum &&
+           x.reverse_nodes == y.reverse_nodes &&
+           memcmp(x.children, y.children, sizeof(x.children)) == 0;
+}
+
+/**
+ * Wykonuje ten sam losowy ciąg operacji na zwykłej bazie, na kolejnych
+ * wersjach drugiej bazy i na bazie współdzielonej, porównując po każdej
+ * operacji wyniki zapytań.
+ * @param[in] seed Ziarno
+ */
+static void testSequence(uint64_t seed) {
+    // Generator nie może zacząć od zera, a bliskie ziarna dają różne ciągi
+    state = seed * 0x9E3779B97F4A7C15ULL;
+
+    struct PhoneForward *plain = phfwdNew();
+    struct PhoneForward *base = phfwdNew();
+    struct PhoneForwardVersion *version = phfwdVersionNew(base);
+    struct SharedForward *shared = phfwdSharedNew();
+    if (plain == NULL || version == NULL || shared == NULL) {
+        report(seed, 0, "brak pamięci", "-");
+        phfwdSharedDelete(shared);
+        phfwdVersionDelete(version);
+        phfwdDelete(base);
+        phfwdDelete(plain);
+        return;
+    }
+
+    char queries[QUERIES][NUMBER_SIZE];
+    for (size_t i = 0; i < QUERIES; i++)
+        randomNumber(queries[i]);
+
+    Snapshot snapshots[SNAPSHOTS];
+    size_t snapshots_count = 0;
+
+    for (size_t step = 0; step < OPERATIONS; step++) {
+        char num1[NUMBER_SIZE];
+        char num2[NUMBER_SIZE];
+        randomNumber(num1);
+        randomNumber(num2);
+
+        struct PhoneForwardVersion *next = NULL;
+        if (randomBelow(4) == 0) {
+            // Krótkie prefiksy usuwają całe poddrzewa
+            if (randomBelow(2) == 0)
+                num1[1] = '\0';
+
+            phfwdRemove(plain, num1);
+            bool removed = phfwdVersionRemove(version, num1, &next);
+            if (!removed || !phfwdSharedRemove(shared, num1))
+                report(seed, step, "nieudane usunięcie", num1);
+        } else {
+            bool expected = phfwdAdd(plain, num1, num2);
+            bool added = phfwdVersionAdd(version, num1, num2, &next);
+            if (added != expected || phfwdSharedAdd(shared, num1, num2) != expected)
+                report(seed, step, "inny wynik dodania", num1);
+        }
+
+        // Najstarszą zapamiętaną wersję zwalniam przed nowszymi, tak jak
+        // bazy współdzielone
+        if (next != NULL) {
+            if (snapshots_count == SNAPSHOTS) {
+                snapshotFree(&snapshots[0]);
+                memmove(snapshots, snapshots + 1,
+                        (SNAPSHOTS - 1) * sizeof(Snapshot));
+                snapshots_count--;
+            }
+
+            snapshotIni(&snapshots[snapshots_count++], version, queries);
+            version = next;
+        }
+
+        for (size_t i = 0; i < snapshots_count; i++)
+            snapshotCheck(&snapshots[i], queries, seed, step);
+
+        for (size_t i = 0; i < QUERIES; i++) {
+            char const *num = queries[i];
+            if (!compareAndDelete(phfwdGet(plain, num),
+                                  phfwdVersionGet(version, num),
+                                  phfwdSharedGet(shared, num)))
+                report(seed, step, "różne wyniki phfwdGet", num);
+
+            if (!compareAndDelete(phfwdReverse(plain, num),
+                                  phfwdVersionReverse(version, num),
+                                  phfwdSharedReverse(shared, num)))
+                report(seed, step, "różne wyniki phfwdReverse", num);
+        }
+
+        if (!sameShape(plain, base))
+            report(seed, step, "różne kształty drzew", num1);
+    }
+
+    for (size_t i = 0; i < snapshots_count; i++)
+        snapshotFree(&snapshots[i]);
+
+    phfwdSharedDelete(shared);
+    phfwdVersionDelete(version);
+    phfwdDelete(base);
+    phfwdDelete(plain);
+}
+
+/**
+ * Porównuje wersje bazy i bazę współdzieloną ze zwykłą bazą dla kilku
+ * losowych ciągów operacji.
+ * @return EXIT_SUCCESS, jeżeli wszystkie wyniki były równe,
+ *         EXIT_FAILURE w p.p.
+ */
+int main(void) {
+    for (uint64_t seed = 1; seed <= SEEDS; seed++) {
+        size_t previous = failures;
+        testSequence(seed);
+        printf("ziarno %llu: %s\n", (unsigned long long) seed,
+               failures == previous ? "OK" : "BŁĄD");
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
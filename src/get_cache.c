@@ -0,0 +1,337 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "get_cache.h"
+
+/**
+ * Oznacza brak wpisu w listach łączonych indeksami.
+ */
+#define GET_CACHE_NONE SIZE_MAX
+
+/**
+ * Liczba cyfr, czyli podstawa, przy której początek numeru jest liczbą.
+ */
+#define GET_CACHE_DIGITS 12
+
+/**
+ * Wyznacza hasz numeru (FNV-1a).
+ * @param num           Numer
+ * @param num_length    Długość numeru
+ * @return Hasz numeru.
+ */
+static size_t numberHash(char const *num, size_t num_length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < num_length; i++) {
+        hash ^= (unsigned char) num[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return (size_t) hash;
+}
+
+/**
+ * Wyznacza wartość początku numeru, traktując cyfry jako liczbę
+ * w systemie o podstawie GET_CACHE_DIGITS.
+ * @param num       Numer
+ * @param length    Długość początku
+ * @return Wartość początku.
+ */
+static size_t prefixValue(char const *num, size_t length) {
+    size_t value = 0;
+    for (size_t i = 0; i < length; i++)
+        value = value * GET_CACHE_DIGITS + (size_t) (num[i] - '0');
+
+    return value;
+}
+
+/**
+ * Wyznacza indeks pierwszej listy dla początków podanej długości.
+ * @param length Długość początku, od 1 do GET_CACHE_PREFIX_LENGTH
+ * @return Indeks listy.
+ */
+static size_t prefixListsBase(size_t length) {
+    size_t base = 0;
+    size_t width = 1;
+    for (size_t i = 1; i < length; i++) {
+        width *= GET_CACHE_DIGITS;
+        base += width;
+    }
+
+    return base;
+}
+
+/**
+ * Wyznacza listę, do której należy numer.
+ * @param num           Numer
+ * @param num_length    Długość numeru, większa od zera
+ * @return Indeks listy.
+ */
+static size_t prefixList(char const *num, size_t num_length) {
+    size_t length = num_length < GET_CACHE_PREFIX_LENGTH ?
+                    num_length : GET_CACHE_PREFIX_LENGTH;
+    return prefixListsBase(length) + prefixValue(num, length);
+}
+
+/**
+ * Wstawia wpis na początek listy ostatnio używanych.
+ * @param c Pamięć podręczna
+ * @param i Indeks wpisu
+ */
+static void recentPush(GetCache *c, size_t i) {
+    c->entries[i].recent_prev = GET_CACHE_NONE;
+    c->entries[i].recent_next = c->most_recent;
+    if (c->most_recent != GET_CACHE_NONE)
+        c->entries[c->most_recent].recent_prev = i;
+    else
+        c->least_recent = i;
+
+    c->most_recent = i;
+}
+
+/**
+ * Wyjmuje wpis z listy ostatnio używanych.
+ * @param c Pamięć podręczna
+ * @param i Indeks wpisu
+ */
+static void recentUnlink(GetCache *c, size_t i) {
+    GetCacheEntry *e = &c->entries[i];
+    if (e->recent_prev != GET_CACHE_NONE)
+        c->entries[e->recent_prev].recent_next = e->recent_next;
+    else
+        c->most_recent = e->recent_next;
+
+    if (e->recent_next != GET_CACHE_NONE)
+        c->entries[e->recent_next].recent_prev = e->recent_prev;
+    else
+        c->least_recent = e->recent_prev;
+}
+
+/**
+ * Usuwa wpis ze wszystkich list i zwalnia jego napisy.
+ * @param c Pamięć podręczna
+ * @param i Indeks wpisu
+ */
+static void removeEntry(GetCache *c, size_t i) {
+    GetCacheEntry *e = &c->entries[i];
+
+    // Kubełki są krótkie, więc poprzednika szukam od początku listy
+    size_t *link = &c->buckets[e->hash & c->buckets_mask];
+    while (*link != i)
+        link = &c->entries[*link].bucket_next;
+    *link = e->bucket_next;
+
+    recentUnlink(c, i);
+
+    if (e->prefix_prev != GET_CACHE_NONE)
+        c->entries[e->prefix_prev].prefix_next = e->prefix_next;
+    else
+        c->prefix_lists[e->prefix_list] = e->prefix_next;
+    if (e->prefix_next != GET_CACHE_NONE)
+        c->entries[e->prefix_next].prefix_prev = e->prefix_prev;
+
+    free((void *) e->number);
+    e->number = NULL;
+    e->bucket_next = c->free_first;
+    c->free_first = i;
+    c->stats.size--;
+}
+
+/**
+ * Szuka wpisu dla numeru.
+ * @param c             Pamięć podręczna
+ * @param num           Numer
+ * @param num_length    Długość numeru
+ * @param hash          Hasz numeru
+ * @return Indeks wpisu lub GET_CACHE_NONE.
+ */
+static size_t findEntry(GetCache const *c, char const *num, size_t num_length,
+                        size_t hash) {
+    size_t i = c->buckets[hash & c->buckets_mask];
+    while (i != GET_CACHE_NONE) {
+        GetCacheEntry const *e = &c->entries[i];
+        if (e->hash == hash && e->number_length == num_length &&
+            memcmp(e->number, num, num_length) == 0)
+            return i;
+
+        i = e->bucket_next;
+    }
+
+    return GET_CACHE_NONE;
+}
+
+bool getCacheIni(GetCache *c, size_t capacity) {
+    // Kubełków jest co najmniej dwa razy więcej niż wpisów
+    size_t buckets = 1;
+    while (buckets < 2 * capacity)
+        buckets <<= 1;
+
+    c->entries = malloc(capacity * sizeof(GetCacheEntry));
+    c->buckets = malloc(buckets * sizeof(size_t));
+    if (c->entries == NULL || c->buckets == NULL ||
+        pthread_mutex_init(&c->lock, NULL) != 0) {
+        free((void *) c->entries);
+        free((void *) c->buckets);
+        return false;
+    }
+
+    c->buckets_mask = buckets - 1;
+    for (size_t i = 0; i < buckets; i++)
+        c->buckets[i] = GET_CACHE_NONE;
+    for (size_t i = 0; i < GET_CACHE_PREFIX_LISTS; i++)
+        c->prefix_lists[i] = GET_CACHE_NONE;
+
+    for (size_t i = 0; i < capacity; i++) {
+        c->entries[i].number = NULL;
+        c->entries[i].bucket_next = i + 1 < capacity ? i + 1 : GET_CACHE_NONE;
+    }
+
+    c->free_first = 0;
+    c->most_recent = GET_CACHE_NONE;
+    c->least_recent = GET_CACHE_NONE;
+    memset(&c->stats, 0, sizeof(GetCacheStats));
+    c->stats.capacity = capacity;
+
+    return true;
+}
+
+void getCacheFree(GetCache *c) {
+    for (size_t i = 0; i < c->stats.capacity; i++)
+        free((void *) c->entries[i].number);
+
+    free((void *) c->entries);
+    free((void *) c->buckets);
+    pthread_mutex_destroy(&c->lock);
+}
+
+bool getCacheLookup(GetCache *c, char const *num, size_t num_length, char *buf,
+                    size_t cap, size_t *length) {
+    size_t hash = numberHash(num, num_length);
+
+    pthread_mutex_lock(&c->lock);
+    size_t i = findEntry(c, num, num_length, hash);
+    if (i == GET_CACHE_NONE) {
+        c->stats.misses++;
+        pthread_mutex_unlock(&c->lock);
+        return false;
+    }
+
+    GetCacheEntry const *e = &c->entries[i];
+    *length = e->result_length;
+    if (e->result_length < cap)
+        memcpy(buf, e->number + e->number_length, e->result_length + 1);
+
+    if (c->most_recent != i) {
+        recentUnlink(c, i);
+        recentPush(c, i);
+    }
+
+    c->stats.hits++;
+    pthread_mutex_unlock(&c->lock);
+    return true;
+}
+
+void getCacheInsert(GetCache *c, char const *num, size_t num_length,
+                    char const *s1, size_t l1, char const *s2, size_t l2) {
+    // Pamięć alokuję przed zajęciem blokady
+    char *number = malloc(num_length + l1 + l2 + 1);
+    if (number == NULL)
+        return;
+
+    memcpy(number, num, num_length);
+    memcpy(number + num_length, s1, l1);
+    memcpy(number + num_length + l1, s2, l2);
+    number[num_length + l1 + l2] = '\0';
+
+    size_t hash = numberHash(num, num_length);
+    size_t list = prefixList(num, num_length);
+
+    pthread_mutex_lock(&c->lock);
+
+    // Inny wątek mógł w międzyczasie zapamiętać ten sam wynik
+    if (findEntry(c, num, num_length, hash) != GET_CACHE_NONE) {
+        pthread_mutex_unlock(&c->lock);
+        free((void *) number);
+        return;
+    }
+
+    if (c->free_first == GET_CACHE_NONE) {
+        removeEntry(c, c->least_recent);
+        c->stats.evictions++;
+    }
+
+    size_t i = c->free_first;
+    GetCacheEntry *e = &c->entries[i];
+    c->free_first = e->bucket_next;
+
+    e->number = number;
+    e->number_length = num_length;
+    e->result_length = l1 + l2;
+    e->hash = hash;
+
+    e->bucket_next = c->buckets[hash & c->buckets_mask];
+    c->buckets[hash & c->buckets_mask] = i;
+
+    e->prefix_list = list;
+    e->prefix_prev = GET_CACHE_NONE;
+    e->prefix_next = c->prefix_lists[list];
+    if (e->prefix_next != GET_CACHE_NONE)
+        c->entries[e->prefix_next].prefix_prev = i;
+    c->prefix_lists[list] = i;
+
+    recentPush(c, i);
+    c->stats.size++;
+
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Usuwa z listy wpisy, których numery zaczynają się od prefiksu.
+ * @param c             Pamięć podręczna
+ * @param list          Indeks listy
+ * @param prefix        Prefiks
+ * @param prefix_length Długość prefiksu
+ */
+static void invalidateList(GetCache *c, size_t list, char const *prefix,
+                           size_t prefix_length) {
+    size_t i = c->prefix_lists[list];
+    while (i != GET_CACHE_NONE) {
+        GetCacheEntry const *e = &c->entries[i];
+        size_t next = e->prefix_next;
+        if (e->number_length >= prefix_length &&
+            memcmp(e->number, prefix, prefix_length) == 0) {
+            removeEntry(c, i);
+            c->stats.invalidations++;
+        }
+
+        i = next;
+    }
+}
+
+void getCacheInvalidate(GetCache *c, char const *prefix, size_t prefix_length) {
+    pthread_mutex_lock(&c->lock);
+
+    if (prefix_length >= GET_CACHE_PREFIX_LENGTH) {
+        invalidateList(c, prefixList(prefix, prefix_length), prefix,
+                       prefix_length);
+    } else {
+        // Krótki prefiks obejmuje spójny przedział list każdej długości początku
+        size_t value = prefixValue(prefix, prefix_length);
+        size_t width = 1;
+        for (size_t length = prefix_length;
+             length <= GET_CACHE_PREFIX_LENGTH; length++) {
+            size_t first = prefixListsBase(length) + value * width;
+            for (size_t list = first; list < first + width; list++)
+                invalidateList(c, list, prefix, prefix_length);
+
+            width *= GET_CACHE_DIGITS;
+        }
+    }
+
+    pthread_mutex_unlock(&c->lock);
+}
+
+void getCacheStats(GetCache *c, GetCacheStats *stats) {
+    pthread_mutex_lock(&c->lock);
+    *stats = c->stats;
+    pthread_mutex_unlock(&c->lock);
+}
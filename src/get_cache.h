@@ -0,0 +1,131 @@
+/** @file
+ * Interfejs pamięci podręcznej wyników phfwdGet, usuwającej najdawniej
+ * używane wpisy i unieważnianej według prefiksów
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_GET_CACHE_H
+#define TELEFONY_GET_CACHE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * Liczba początkowych cyfr numeru, według których wpisy łączone są w listy
+ * przeglądane przy unieważnianiu.
+ */
+#define GET_CACHE_PREFIX_LENGTH 3
+
+/**
+ * Liczba list wpisów: po jednej dla każdego numeru krótszego niż
+ * GET_CACHE_PREFIX_LENGTH i dla każdego możliwego początku dłuższego numeru.
+ * Listy numerowane są tak, że numery o wspólnym prefiksie i tej samej
+ * długości początku trafiają do spójnego przedziału list.
+ */
+#define GET_CACHE_PREFIX_LISTS (12 + 12 * 12 + 12 * 12 * 12)
+
+/**
+ * Wpis pamięci podręcznej. Wpisy są jednocześnie w liście kubełka tablicy
+ * haszującej, w liście od ostatnio do najdawniej używanego i w liście
+ * wpisów o tym samym początku numeru. Listy łączone są indeksami wpisów.
+ */
+typedef struct get_cache_entry {
+    char *number;           ///< Numer, a zaraz za nim wynik; NULL dla wolnego wpisu
+    size_t number_length;   ///< Długość numeru
+    size_t result_length;   ///< Długość wyniku
+    size_t hash;            ///< Hasz numeru
+    size_t bucket_next;     ///< Następny wpis w kubełku, a dla wolnego wpisu następny wolny
+    size_t recent_prev;     ///< Wpis używany ostatnio przed tym
+    size_t recent_next;     ///< Wpis używany ostatnio po tym
+    size_t prefix_prev;     ///< Poprzedni wpis o tym samym początku numeru
+    size_t prefix_next;     ///< Następny wpis o tym samym początku numeru
+    size_t prefix_list;     ///< Lista wpisów o tym samym początku numeru
+} GetCacheEntry;
+
+/**
+ * Statystyki pamięci podręcznej.
+ */
+typedef struct PhoneForwardCacheStats GetCacheStats;
+
+/**
+ * Pamięć podręczna o stałej liczbie wpisów. Wszystkie funkcje mogą być
+ * wywoływane współbieżnie, bo zapytania z okna poleceń wyznaczane są
+ * przez wiele wątków naraz.
+ */
+typedef struct get_cache {
+    GetCacheEntry *entries;                     ///< Wpisy
+    size_t *buckets;                            ///< Pierwsze wpisy kubełków
+    size_t buckets_mask;                        ///< Liczba kubełków pomniejszona o jeden
+    size_t prefix_lists[GET_CACHE_PREFIX_LISTS];///< Pierwsze wpisy list według początku numeru
+    size_t most_recent;                         ///< Ostatnio używany wpis
+    size_t least_recent;                        ///< Najdawniej używany wpis
+    size_t free_first;                          ///< Pierwszy wolny wpis
+    GetCacheStats stats;                        ///< Statystyki
+    pthread_mutex_t lock;                       ///< Blokada chroniąca wszystkie pola
+} GetCache;
+
+/**
+ * Inicjalizuje pustą pamięć podręczną.
+ * @param c         Pamięć podręczna
+ * @param capacity  Największa liczba wpisów, większa od zera
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool getCacheIni(GetCache *c, size_t capacity);
+
+/**
+ * Zwalnia pamięć zajmowaną przez wpisy.
+ * @param c Pamięć podręczna
+ */
+void getCacheFree(GetCache *c);
+
+/**
+ * Szuka wyniku dla numeru i oznacza go jako ostatnio używany. Jeśli wynik
+ * razem z kończącym go znakiem '\0' mieści się w @p cap bajtach, zapisuje go
+ * do @p buf.
+ * @param c             Pamięć podręczna
+ * @param num           Numer
+ * @param num_length    Długość numeru
+ * @param buf           Bufor na wynik
+ * @param cap           Rozmiar bufora
+ * @param length        Długość znalezionego wyniku
+ * @return True, jeżeli wynik był w pamięci podręcznej, false w p.p.
+ */
+bool getCacheLookup(GetCache *c, char const *num, size_t num_length, char *buf,
+                    size_t cap, size_t *length);
+
+/**
+ * Zapamiętuje wynik dla numeru, złożony z dwóch części. Gdy brakuje miejsca,
+ * usuwa najdawniej używany wpis. Przy braku pamięci nic nie robi.
+ * @param c             Pamięć podręczna
+ * @param num           Numer
+ * @param num_length    Długość numeru
+ * @param s1            Początek wyniku
+ * @param l1            Długość początku
+ * @param s2            Koniec wyniku
+ * @param l2            Długość końca
+ */
+void getCacheInsert(GetCache *c, char const *num, size_t num_length,
+                    char const *s1, size_t l1, char const *s2, size_t l2);
+
+/**
+ * Usuwa wyniki wszystkich numerów o podanym prefiksie. Tylko one mogą się
+ * zmienić po dodaniu lub usunięciu przekierowań tego prefiksu.
+ * @param c             Pamięć podręczna
+ * @param prefix        Prefiks złożony z cyfr
+ * @param prefix_length Długość prefiksu, większa od zera
+ */
+void getCacheInvalidate(GetCache *c, char const *prefix, size_t prefix_length);
+
+/**
+ * Odczytuje statystyki.
+ * @param c     Pamięć podręczna
+ * @param stats Miejsce na statystyki
+ */
+void getCacheStats(GetCache *c, GetCacheStats *stats);
+
+#endif //TELEFONY_GET_CACHE_H
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+#include "number_buffer.h"
+
+/**
+ * Początkowa liczba numerów, które mieści bufor.
+ */
+#define INITIAL_NUMBERS_CAPACITY 8
+
+/**
+ * Początkowy rozmiar obszaru znaków bufora.
+ */
+#define INITIAL_CHARS_CAPACITY 128
+
+/**
+ * Powiększa tablicę tak, aby mieściła co najmniej @p needed elementów.
+ * @param array         Wskaźnik na tablicę
+ * @param capacity      Obecna liczba elementów tablicy
+ * @param needed        Potrzebna liczba elementów
+ * @param element_size  Rozmiar elementu
+ * @param initial       Rozmiar pierwszej alokacji
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool reserve(void **array, size_t *capacity, size_t needed,
+                    size_t element_size, size_t initial) {
+    if (needed <= *capacity)
+        return true;
+
+    size_t new_capacity = *capacity > 0 ? *capacity : initial;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void *new_array = realloc(*array, new_capacity * element_size);
+    if (new_array == NULL)
+        return false;
+
+    *array = new_array;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Porównuje dwa numery na potrzeby qsort.
+ * @param a Wskaźnik na pierwszy numer
+ * @param b Wskaźnik na drugi numer
+ * @return Wynik strcmp dla porównywanych numerów.
+ */
+static int compareNumbers(void const *a, void const *b) {
+    return strcmp(*(char const *const *) a, *(char const *const *) b);
+}
+
+void numberBufferIni(NumberBuffer *b) {
+    b->chars = NULL;
+    b->chars_size = 0;
+    b->chars_capacity = 0;
+    b->offsets = NULL;
+    b->count = 0;
+    b->offsets_capacity = 0;
+    b->sorted = NULL;
+}
+
+bool numberBufferAppend(NumberBuffer *b, char const *s1, size_t s1_len,
+                        char const *s2, size_t s2_len) {
+    size_t length = s1_len + s2_len;
+
+    if (!reserve((void **) &b->chars, &b->chars_capacity, b->chars_size + length + 1,
+                 sizeof(char), INITIAL_CHARS_CAPACITY) ||
+        !reserve((void **) &b->offsets, &b->offsets_capacity, b->count + 1,
+                 sizeof(size_t), INITIAL_NUMBERS_CAPACITY))
+        return false;
+
+    char *number = b->chars + b->chars_size;
+    memcpy(number, s1, s1_len);
+    memcpy(number + s1_len, s2, s2_len);
+    number[length] = '\0';
+
+    b->offsets[b->count++] = b->chars_size;
+    b->chars_size += length + 1;
+    return true;
+}
+
+bool numberBufferSortUnique(NumberBuffer *b) {
+    // Wskaźniki można wyznaczyć dopiero teraz, bo tablica znaków już nie urośnie
+    b->sorted = malloc((b->count > 0 ? b->count : 1) * sizeof(char const *));
+    if (b->sorted == NULL)
+        return false;
+
+    for (size_t i = 0; i < b->count; i++)
+        b->sorted[i] = b->chars + b->offsets[i];
+
+    qsort((void *) b->sorted, b->count, sizeof(char const *), compareNumbers);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < b->count; i++) {
+        if (unique == 0 || strcmp(b->sorted[unique - 1], b->sorted[i]) != 0)
+            b->sorted[unique++] = b->sorted[i];
+    }
+    b->count = unique;
+
+    return true;
+}
+
+/**
+ * Przywraca własność kopca buforów, przesuwając element @p i w dół.
+ * Kopiec uporządkowany jest według bieżącego numeru każdego z buforów.
+ * @param heap      Indeksy buforów tworzące kopiec
+ * @param size      Rozmiar kopca
+ * @param i         Przesuwany element
+ * @param buffers   Bufory
+ * @param positions Pozycje bieżących numerów buforów
+ */
+static void siftDown(size_t *heap, size_t size, size_t i, NumberBuffer const *buffers,
+                     size_t const *positions) {
+    for (;;) {
+        size_t smallest = i;
+        for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < size; child++) {
+            if (strcmp(buffers[heap[child]].sorted[positions[heap[child]]],
+                       buffers[heap[smallest]].sorted[positions[heap[smallest]]]) < 0)
+                smallest = child;
+        }
+
+        if (smallest == i)
+            return;
+
+        size_t tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+char const **numberBuffersMerge(NumberBuffer const *buffers, size_t count,
+                                size_t *merged_count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += buffers[i].count;
+
+    char const **merged = malloc((total > 0 ? total : 1) * sizeof(char const *));
+    size_t *heap = malloc((count > 0 ? count : 1) * sizeof(size_t));
+    size_t *positions = calloc(count > 0 ? count : 1, sizeof(size_t));
+    if (merged == NULL || heap == NULL || positions == NULL) {
+        free((void *) merged);
+        free((void *) heap);
+        free((void *) positions);
+        return NULL;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (buffers[i].count > 0)
+            heap[size++] = i;
+    }
+    for (size_t i = size; i > 0; i--)
+        siftDown(heap, size, i - 1, buffers, positions);
+
+    size_t unique = 0;
+    while (size > 0) {
+        size_t top = heap[0];
+        char const *number = buffers[top].sorted[positions[top]];
+        if (unique == 0 || strcmp(merged[unique - 1], number) != 0)
+            merged[unique++] = number;
+
+        if (++positions[top] == buffers[top].count)
+            heap[0] = heap[--size];
+        siftDown(heap, size, 0, buffers, positions);
+    }
+
+    free((void *) heap);
+    free((void *) positions);
+    *merged_count = unique;
+    return merged;
+}
+
+void numberBufferFree(NumberBuffer *b) {
+    free((void *) b->chars);
+    free((void *) b->offsets);
+    free((void *) b->sorted);
+    numberBufferIni(b);
+}
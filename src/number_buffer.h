@@ -0,0 +1,77 @@
+/** @file
+ * Interfejs bufora zbierającego numery telefonów w jednym ciągłym obszarze pamięci
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_NUMBER_BUFFER_H
+#define TELEFONY_NUMBER_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Bufor, do którego dopisywane są kolejne numery zakończone '\0'.
+ * Po zebraniu wszystkich numerów są one jednokrotnie sortowane,
+ * a powtórzenia usuwane, zamiast utrzymywać porządek przy każdym wstawieniu.
+ */
+typedef struct number_buffer {
+    char *chars;            ///< Znaki kolejnych numerów, każdy zakończony '\0'
+    size_t chars_size;      ///< Liczba zajętych bajtów tablicy @p chars
+    size_t chars_capacity;  ///< Rozmiar tablicy @p chars
+
+    size_t *offsets;            ///< Początki kolejnych numerów w tablicy @p chars
+    size_t count;               ///< Liczba numerów w buforze
+    size_t offsets_capacity;    ///< Rozmiar tablicy @p offsets
+
+    char const **sorted;    ///< Posortowane, unikalne numery; wypełniane przez numberBufferSortUnique
+} NumberBuffer;
+
+/**
+ * Inicjalizuje pusty bufor.
+ * @param b Inicjalizowany bufor
+ */
+void numberBufferIni(NumberBuffer *b);
+
+/**
+ * Dopisuje do bufora numer będący złączeniem napisów @p s1 i @p s2.
+ * @param b         Bufor
+ * @param s1        Pierwsza część numeru
+ * @param s1_len    Długość pierwszej części
+ * @param s2        Druga część numeru
+ * @param s2_len    Długość drugiej części
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool numberBufferAppend(NumberBuffer *b, char const *s1, size_t s1_len,
+                        char const *s2, size_t s2_len);
+
+/**
+ * Sortuje leksykograficznie numery zebrane w buforze i usuwa powtórzenia.
+ * Po wywołaniu @p sorted wskazuje na @p count unikalnych numerów;
+ * do bufora nie należy już niczego dopisywać.
+ * @param b Bufor
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool numberBufferSortUnique(NumberBuffer *b);
+
+/**
+ * Scala posortowane bufory w jeden posortowany ciąg unikalnych numerów.
+ * Każdy z buforów musi być już przetworzony przez numberBufferSortUnique.
+ * @param buffers       Tablica buforów
+ * @param count         Liczba buforów
+ * @param merged_count  Liczba numerów wyniku
+ * @return Tablica wskaźników na numery z buforów, którą należy zwolnić,
+ *         lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+char const **numberBuffersMerge(NumberBuffer const *buffers, size_t count,
+                                size_t *merged_count);
+
+/**
+ * Zwalnia pamięć bufora.
+ * @param b Bufor
+ */
+void numberBufferFree(NumberBuffer *b);
+
+#endif //TELEFONY_NUMBER_BUFFER_H
@@ -0,0 +1,273 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include "number_scan.h"
+#include "number_scan_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/**
+ * Czy dostępne są wersje korzystające z rozkazów SSE2 i AVX2.
+ */
+#define NUMBER_SCAN_X86 1
+#include <immintrin.h>
+#else
+#define NUMBER_SCAN_X86 0
+#endif
+
+#if NUMBER_SCAN_X86 && defined(__clang__)
+/**
+ * Wyłącza sprawdzanie dostępu do pamięci przez sanitizer w funkcji, która
+ * celowo czyta cały wyrównany blok zawierający koniec napisu.
+ */
+#define NUMBER_SCAN_NO_SANITIZE __attribute__((no_sanitize("address")))
+#elif NUMBER_SCAN_X86
+#define NUMBER_SCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+#endif
+
+/**
+ * Liczba cyfr: od '0' do '9' oraz ':' i ';'.
+ */
+#define NUMBER_SCAN_DIGITS 12
+
+/**
+ * Sprawdza, czy znak jest cyfrą, jednym porównaniem bez znaku.
+ * @param[in] c Znak
+ * @return True, jeżeli znak jest cyfrą, false w p.p.
+ */
+static inline int isScanDigit(char c) {
+    return (unsigned char) (c - '0') < NUMBER_SCAN_DIGITS;
+}
+
+/**
+ * Wersja numberSpan sprawdzająca po jednym znaku.
+ * @param[in] num Napis
+ * @return Liczba początkowych znaków będących cyframi.
+ */
+static size_t spanScalar(char const *num) {
+    size_t i = 0;
+    while (isScanDigit(num[i]))
+        i++;
+
+    return i;
+}
+
+/**
+ * Wersja numberCommonPrefix porównująca po jednym znaku.
+ * @param[in] num1      Pierwszy napis
+ * @param[in] num2      Drugi napis
+ * @param[in] length    Liczba porównywanych znaków
+ * @return Pozycja pierwszej różnicy lub @p length.
+ */
+static size_t commonPrefixScalar(char const *num1, char const *num2,
+                                 size_t length) {
+    size_t i = 0;
+    while (i < length && num1[i] == num2[i])
+        i++;
+
+    return i;
+}
+
+#if NUMBER_SCAN_X86
+
+/**
+ * Wyznacza maskę bajtów bloku, które nie są cyframi.
+ * @param[in] block Blok 16 znaków
+ * @return Maska z bitem i ustawionym, gdy znak i nie jest cyfrą.
+ */
+__attribute__((target("sse2")))
+static inline unsigned invalidMaskSse2(__m128i block) {
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+    __m128i clamped = _mm_min_epu8(shifted, _mm_set1_epi8(NUMBER_SCAN_DIGITS - 1));
+    __m128i valid = _mm_cmpeq_epi8(clamped, shifted);
+    return ~(unsigned) _mm_movemask_epi8(valid) & 0xFFFFu;
+}
+
+/**
+ * Wersja numberSpan sprawdzająca 16 znaków naraz. Czyta wyłącznie wyrównane
+ * bloki, więc nie przekracza granicy strony, na której leży koniec napisu.
+ * @param[in] num Napis
+ * @return Liczba początkowych znaków będących cyframi.
+ */
+__attribute__((target("sse2"))) NUMBER_SCAN_NO_SANITIZE
+static size_t spanSse2(char const *num) {
+    size_t offset = (uintptr_t) num % 16;
+    char const *block = num - offset;
+
+    // Pomijam bity znaków leżących przed początkiem napisu
+    unsigned mask = invalidMaskSse2(_mm_load_si128((__m128i const *) block)) >> offset;
+    if (mask != 0)
+        return (size_t) __builtin_ctz(mask);
+
+    for (size_t i = 16;; i += 16) {
+        mask = invalidMaskSse2(_mm_load_si128((__m128i const *) (block + i)));
+        if (mask != 0)
+            return i - offset + (size_t) __builtin_ctz(mask);
+    }
+}
+
+/**
+ * Wersja numberCommonPrefix porównująca 16 znaków naraz.
+ * @param[in] num1      Pierwszy napis
+ * @param[in] num2      Drugi napis
+ * @param[in] length    Liczba porównywanych znaków
+ * @return Pozycja pierwszej różnicy lub @p length.
+ */
+__attribute__((target("sse2")))
+static size_t commonPrefixSse2(char const *num1, char const *num2, size_t length) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((__m128i const *) (num1 + i));
+        __m128i b = _mm_loadu_si128((__m128i const *) (num2 + i));
+        unsigned mask = ~(unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFFu;
+        if (mask != 0)
+            return i + (size_t) __builtin_ctz(mask);
+    }
+
+    return i + commonPrefixScalar(num1 + i, num2 + i, length - i);
+}
+
+/**
+ * Wyznacza maskę bajtów bloku, które nie są cyframi.
+ * @param[in] block Blok 32 znaków
+ * @return Maska z bitem i ustawionym, gdy znak i nie jest cyfrą.
+ */
+__attribute__((target("avx2")))
+static inline unsigned invalidMaskAvx2(__m256i block) {
+    __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('0'));
+    __m256i clamped = _mm256_min_epu8(shifted,
+                                      _mm256_set1_epi8(NUMBER_SCAN_DIGITS - 1));
+    __m256i valid = _mm256_cmpeq_epi8(clamped, shifted);
+    return ~(unsigned) _mm256_movemask_epi8(valid);
+}
+
+/**
+ * Wersja numberSpan sprawdzająca 32 znaki naraz, czytająca tylko wyrównane
+ * bloki.
+ * @param[in] num Napis
+ * @return Liczba początkowych znaków będących cyframi.
+ */
+__attribute__((target("avx2"))) NUMBER_SCAN_NO_SANITIZE
+static size_t spanAvx2(char const *num) {
+    size_t offset = (uintptr_t) num % 32;
+    char const *block = num - offset;
+
+    unsigned mask = invalidMaskAvx2(_mm256_load_si256((__m256i const *) block)) >> offset;
+    if (mask != 0)
+        return (size_t) __builtin_ctz(mask);
+
+    for (size_t i = 32;; i += 32) {
+        mask = invalidMaskAvx2(_mm256_load_si256((__m256i const *) (block + i)));
+        if (mask != 0)
+            return i - offset + (size_t) __builtin_ctz(mask);
+    }
+}
+
+/**
+ * Wersja numberCommonPrefix porównująca 32 znaki naraz; krótszą resztę
+ * przekazuje wersji SSE2.
+ * @param[in] num1      Pierwszy napis
+ * @param[in] num2      Drugi napis
+ * @param[in] length    Liczba porównywanych znaków
+ * @return Pozycja pierwszej różnicy lub @p length.
+ */
+__attribute__((target("avx2")))
+static size_t commonPrefixAvx2(char const *num1, char const *num2, size_t length) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256((__m256i const *) (num1 + i));
+        __m256i b = _mm256_loadu_si256((__m256i const *) (num2 + i));
+        unsigned mask = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (mask != 0)
+            return i + (size_t) __builtin_ctz(mask);
+    }
+
+    return i + commonPrefixSse2(num1 + i, num2 + i, length - i);
+}
+
+#endif
+
+/**
+ * Wszystkie skompilowane wersje funkcji, od najwęższych rozkazów.
+ */
+static NumberScanKernels const kernels[] = {
+    {"scalar", spanScalar, commonPrefixScalar},
+#if NUMBER_SCAN_X86
+    {"sse2", spanSse2, commonPrefixSse2},
+    {"avx2", spanAvx2, commonPrefixAvx2},
+#endif
+};
+
+static size_t spanResolve(char const *num);
+
+static size_t commonPrefixResolve(char const *num1, char const *num2,
+                                  size_t length);
+
+/**
+ * Wybrana wersja numberSpan; do pierwszego wywołania funkcja wybierająca.
+ */
+static _Atomic SpanKernel span_kernel = spanResolve;
+
+/**
+ * Wybrana wersja numberCommonPrefix; do pierwszego wywołania funkcja
+ * wybierająca.
+ */
+static _Atomic CommonPrefixKernel common_prefix_kernel = commonPrefixResolve;
+
+NumberScanKernels const *numberScanKernels(size_t *count) {
+    *count = 1;
+
+#if NUMBER_SCAN_X86
+    // Procesor z AVX2 ma też SSE2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        *count = 3;
+    else if (__builtin_cpu_supports("sse2"))
+        *count = 2;
+#endif
+
+    return kernels;
+}
+
+/**
+ * Wybiera wersje funkcji najlepsze dla procesora, na którym działa program.
+ * Wątki mogą wybierać je jednocześnie, bo każdy zapisze to samo.
+ */
+static void resolveKernels(void) {
+    size_t count;
+    NumberScanKernels const *best = &numberScanKernels(&count)[count - 1];
+
+    atomic_store_explicit(&span_kernel, best->span, memory_order_relaxed);
+    atomic_store_explicit(&common_prefix_kernel, best->common_prefix,
+                          memory_order_relaxed);
+}
+
+/**
+ * Wybiera wersje funkcji i wywołuje wybraną numberSpan.
+ * @param[in] num Napis
+ * @return Liczba początkowych znaków będących cyframi.
+ */
+static size_t spanResolve(char const *num) {
+    resolveKernels();
+    return numberSpan(num);
+}
+
+/**
+ * Wybiera wersje funkcji i wywołuje wybraną numberCommonPrefix.
+ * @param[in] num1      Pierwszy napis
+ * @param[in] num2      Drugi napis
+ * @param[in] length    Liczba porównywanych znaków
+ * @return Pozycja pierwszej różnicy lub @p length.
+ */
+static size_t commonPrefixResolve(char const *num1, char const *num2,
+                                  size_t length) {
+    resolveKernels();
+    return numberCommonPrefix(num1, num2, length);
+}
+
+size_t numberSpan(char const *num) {
+    return atomic_load_explicit(&span_kernel, memory_order_relaxed)(num);
+}
+
+size_t numberCommonPrefix(char const *num1, char const *num2, size_t length) {
+    return atomic_load_explicit(&common_prefix_kernel,
+                                memory_order_relaxed)(num1, num2, length);
+}
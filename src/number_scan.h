@@ -0,0 +1,36 @@
+/** @file
+ * Interfejs przeglądania numerów wieloma znakami naraz: sprawdzania, czy
+ * znaki są cyframi, i szukania pierwszej różnicy dwóch numerów
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_NUMBER_SCAN_H
+#define TELEFONY_NUMBER_SCAN_H
+
+#include <stddef.h>
+
+/**
+ * Wyznacza długość najdłuższego początku napisu złożonego z cyfr, czyli
+ * znaków od '0' do ';'. Na procesorach x86 z SSE2 lub AVX2 sprawdza 16 lub
+ * 32 znaki naraz; wybór wersji następuje przy pierwszym wywołaniu.
+ * Może czytać bajty za znakiem '\0', ale nigdy poza jego 32-bajtowym blokiem
+ * wyrównanej pamięci, więc nie wychodzi poza stronę pamięci napisu.
+ * @param[in] num Napis zakończony znakiem '\0'
+ * @return Liczba początkowych znaków będących cyframi.
+ */
+size_t numberSpan(char const *num);
+
+/**
+ * Wyznacza długość wspólnego początku dwóch napisów o tej samej długości,
+ * porównując 16 lub 32 znaki naraz tam, gdzie procesor na to pozwala.
+ * @param[in] num1      Pierwszy napis
+ * @param[in] num2      Drugi napis
+ * @param[in] length    Liczba porównywanych znaków
+ * @return Pozycja pierwszej różnicy lub @p length, gdy jej nie ma.
+ */
+size_t numberCommonPrefix(char const *num1, char const *num2, size_t length);
+
+#endif //TELEFONY_NUMBER_SCAN_H
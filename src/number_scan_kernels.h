@@ -0,0 +1,45 @@
+/** @file
+ * Wewnętrzny interfejs wersji funkcji z number_scan.h, przeznaczony dla
+ * testów porównujących wersje SSE2 i AVX2 z wersją skalarną
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_NUMBER_SCAN_KERNELS_H
+#define TELEFONY_NUMBER_SCAN_KERNELS_H
+
+#include <stddef.h>
+
+/**
+ * Typ funkcji wyznaczającej długość początku złożonego z cyfr.
+ */
+typedef size_t (*SpanKernel)(char const *num);
+
+/**
+ * Typ funkcji wyznaczającej długość wspólnego początku.
+ */
+typedef size_t (*CommonPrefixKernel)(char const *num1, char const *num2,
+                                     size_t length);
+
+/**
+ * @struct number_scan_kernels
+ * @details Jedna wersja funkcji numberSpan i numberCommonPrefix.
+ */
+typedef struct number_scan_kernels {
+    char const *name;                   ///< Nazwa wersji, np. "sse2"
+    SpanKernel span;                    ///< Wersja numberSpan
+    CommonPrefixKernel common_prefix;   ///< Wersja numberCommonPrefix
+} NumberScanKernels;
+
+/**
+ * Zwraca wersje funkcji, które może wykonać procesor, na którym działa program.
+ * Pierwsza jest zawsze wersja skalarna, a kolejne korzystają z coraz
+ * szerszych rozkazów, niezależnie od wersji wybranej przez numberSpan.
+ * @param[out] count Liczba wersji
+ * @return Tablica wersji.
+ */
+NumberScanKernels const *numberScanKernels(size_t *count);
+
+#endif //TELEFONY_NUMBER_SCAN_KERNELS_H
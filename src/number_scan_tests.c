@@ -0,0 +1,296 @@
+/** @file
+ * Testy porównujące wersje SSE2 i AVX2 funkcji z number_scan.h z wersją
+ * skalarną, dla wszystkich wersji, które może wykonać procesor
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "number_scan_kernels.h"
+
+/**
+ * Sprawdzane przesunięcia napisów względem wyrównanego bloku: od 0 do
+ * MAX_ALIGNMENT - 1, co obejmuje każde położenie w bloku AVX2.
+ */
+#define MAX_ALIGNMENT 32
+
+/**
+ * Największa sprawdzana długość napisu, obejmująca kilka pełnych bloków
+ * i niepełną resztę.
+ */
+#define MAX_LENGTH 130
+
+/**
+ * Rozmiar bufora na napis z dowolnym przesunięciem i blokami odczytanymi
+ * za jego końcem.
+ */
+#define BUFFER_SIZE (2 * MAX_ALIGNMENT + MAX_LENGTH + 2 * MAX_ALIGNMENT)
+
+/**
+ * Cyfry w kolejności, w której wypełniane są napisy.
+ */
+static char const digits[] = "0123456789:;";
+
+/**
+ * Liczba znalezionych różnic.
+ */
+static size_t failures = 0;
+
+/**
+ * Sprawdza, czy znak jest cyfrą.
+ * @param[in] c Znak
+ * @return True, jeżeli znak jest cyfrą, false w p.p.
+ */
+static bool isDigit(int c) {
+    return c >= '0' && c <= ';';
+}
+
+/**
+ * Zapisuje różnicę wyników wersji funkcji.
+ * @param[in] kernel    Nazwa wersji
+ * @param[in] function  Nazwa funkcji
+ * @param[in] alignment Przesunięcie napisu
+ * @param[in] length    Długość napisu
+ * @param[in] extra     Dodatkowy parametr przypadku
+ * @param[in] expected  Wynik wersji skalarnej
+ * @param[in] actual    Wynik sprawdzanej wersji
+ */
+static void report(char const *kernel, char const *function, size_t alignment,
+                   size_t length, size_t extra, size_t expected, size_t actual) {
+    // Wypisuję tylko kilka pierwszych różnic, resztę wyłącznie liczę
+    if (failures++ < 10)
+        fprintf(stderr, "%s: %s, przesunięcie %zu, długość %zu, parametr %zu: "
+                        "oczekiwano %zu, otrzymano %zu\n", kernel, function,
+                alignment, length, extra, expected, actual);
+}
+
+/**
+ * Zapisuje od @p s napis złożony z @p length cyfr.
+ * @param[out] s        Bufor
+ * @param[in] length    Liczba cyfr
+ * @param[in] seed      Przesunięcie ciągu cyfr, aby napisy się różniły
+ */
+static void fillDigits(char *s, size_t length, size_t seed) {
+    for (size_t i = 0; i < length; i++)
+        s[i] = digits[(i * 7 + seed) % (sizeof(digits) - 1)];
+}
+
+/**
+ * Porównuje wersje numberSpan dla każdego przesunięcia, długości i znaku
+ * kończącego ciąg cyfr. Przed napisem i za kończącym znakiem leżą cyfry,
+ * których wersje blokowe nie mogą policzyć.
+ * @param[in] scalar    Wersja skalarna
+ * @param[in] kernel    Sprawdzana wersja
+ */
+static void testSpan(NumberScanKernels const *scalar,
+                     NumberScanKernels const *kernel) {
+    static _Alignas(64) char buffer[BUFFER_SIZE];
+
+    for (size_t alignment = 0; alignment < MAX_ALIGNMENT; alignment++) {
+        for (size_t length = 0; length <= MAX_LENGTH; length++) {
+            for (int c = 0; c < 256; c++) {
+                if (isDigit(c))
+                    continue;
+
+                fillDigits(buffer, BUFFER_SIZE - 1, length);
+                buffer[BUFFER_SIZE - 1] = '\0';
+                buffer[alignment + length] = (char) c;
+
+                char const *num = buffer + alignment;
+                size_t expected = scalar->span(num);
+                size_t actual = kernel->span(num);
+                if (expected != length)
+                    report(scalar->name, "numberSpan", alignment, length,
+                           (size_t) c, length, expected);
+                if (actual != expected)
+                    report(kernel->name, "numberSpan", alignment, length,
+                           (size_t) c, expected, actual);
+            }
+        }
+    }
+}
+
+/**
+ * Porównuje wersje numberSpan dla napisów, których znak '\0' jest ostatnim
+ * bajtem strony pamięci, za którą leży strona niedostępna do odczytu.
+ * @param[in] scalar    Wersja skalarna
+ * @param[in] kernel    Sprawdzana wersja
+ * @param[in] page_end  Koniec strony dostępnej do odczytu
+ */
+static void testSpanPageEnd(NumberScanKernels const *scalar,
+                            NumberScanKernels const *kernel, char *page_end) {
+    for (size_t length = 0; length <= MAX_LENGTH; length++) {
+        for (int c = 0; c < 256; c++) {
+            if (isDigit(c))
+                continue;
+
+            // Dla znaku różnego od '\0' napis kończy się zaraz za nim
+            size_t size = c == 0 ? length + 1 : length + 2;
+            char *num = page_end - size;
+            fillDigits(num, length, length);
+            num[length] = (char) c;
+            page_end[-1] = '\0';
+
+            size_t expected = scalar->span(num);
+            size_t actual = kernel->span(num);
+            if (actual != expected)
+                report(kernel->name, "numberSpan na końcu strony",
+                       (size_t) ((uintptr_t) num % MAX_ALIGNMENT), length,
+                       (size_t) c, expected, actual);
+        }
+    }
+}
+
+/**
+ * Porównuje wersje numberCommonPrefix dla napisów różniących się na pozycji
+ * @p difference lub równych, gdy jest ona równa @p length.
+ * @param[in] scalar        Wersja skalarna
+ * @param[in] kernel        Sprawdzana wersja
+ * @param[in] num1          Pierwszy napis
+ * @param[in] num2          Drugi napis
+ * @param[in] length        Długość napisów
+ * @param[in] difference    Pozycja różnicy
+ * @param[in] alignment     Przesunięcie zgłaszane przy różnicy wyników
+ */
+static void checkCommonPrefix(NumberScanKernels const *scalar,
+                              NumberScanKernels const *kernel, char *num1,
+                              char *num2, size_t length, size_t difference,
+                              size_t alignment) {
+    fillDigits(num1, length, 0);
+    fillDigits(num2, length, 0);
+    if (difference < length)
+        num2[difference] = (char) (num1[difference] ^ (difference % 2 ? 0x80 : 1));
+
+    size_t expected = scalar->common_prefix(num1, num2, length);
+    size_t actual = kernel->common_prefix(num1, num2, length);
+    if (expected != difference)
+        report(scalar->name, "numberCommonPrefix", alignment, length, difference,
+               difference, expected);
+    if (actual != expected)
+        report(kernel->name, "numberCommonPrefix", alignment, length, difference,
+               expected, actual);
+}
+
+/**
+ * Porównuje wersje numberCommonPrefix dla każdej pary przesunięć i długości.
+ * Różnice leżą na granicach bloków, a dla równych przesunięć na każdej pozycji.
+ * @param[in] scalar    Wersja skalarna
+ * @param[in] kernel    Sprawdzana wersja
+ */
+static void testCommonPrefix(NumberScanKernels const *scalar,
+                             NumberScanKernels const *kernel) {
+    static _Alignas(64) char buffer1[BUFFER_SIZE];
+    static _Alignas(64) char buffer2[BUFFER_SIZE];
+    static size_t const boundaries[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64,
+                                        65, 95, 96, 127, 128, 129};
+
+    for (size_t alignment1 = 0; alignment1 < MAX_ALIGNMENT; alignment1++) {
+        for (size_t alignment2 = 0; alignment2 < MAX_ALIGNMENT; alignment2++) {
+            char *num1 = buffer1 + alignment1;
+            char *num2 = buffer2 + alignment2;
+
+            for (size_t length = 0; length <= MAX_LENGTH; length++) {
+                checkCommonPrefix(scalar, kernel, num1, num2, length, length,
+                                  alignment1);
+
+                for (size_t i = 0; i < sizeof(boundaries) / sizeof(size_t); i++) {
+                    if (boundaries[i] < length)
+                        checkCommonPrefix(scalar, kernel, num1, num2, length,
+                                          boundaries[i], alignment1);
+                }
+
+                for (size_t d = 0; alignment1 == alignment2 && d < length; d++)
+                    checkCommonPrefix(scalar, kernel, num1, num2, length, d,
+                                      alignment1);
+            }
+        }
+    }
+}
+
+/**
+ * Porównuje wersje numberCommonPrefix dla napisów kończących się na końcu
+ * stron pamięci, za którymi leżą strony niedostępne do odczytu.
+ * @param[in] scalar    Wersja skalarna
+ * @param[in] kernel    Sprawdzana wersja
+ * @param[in] page_end1 Koniec strony pierwszego napisu
+ * @param[in] page_end2 Koniec strony drugiego napisu
+ */
+static void testCommonPrefixPageEnd(NumberScanKernels const *scalar,
+                                    NumberScanKernels const *kernel,
+                                    char *page_end1, char *page_end2) {
+    for (size_t length = 0; length <= MAX_LENGTH; length++) {
+        for (size_t d = 0; d <= length; d++)
+            checkCommonPrefix(scalar, kernel, page_end1 - length,
+                              page_end2 - length, length, d,
+                              (size_t) ((uintptr_t) (page_end1 - length) %
+                                       MAX_ALIGNMENT));
+    }
+}
+
+/**
+ * Rezerwuje dwie strony pamięci, z których druga jest niedostępna.
+ * @param[in] page_size Rozmiar strony
+ * @return Koniec pierwszej strony lub NULL, gdy się nie udało.
+ */
+static char *guardedPage(size_t page_size) {
+    int fd = open("/dev/zero", O_RDWR);
+    if (fd < 0)
+        return NULL;
+
+    char *pages = mmap(NULL, 2 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, 0);
+    close(fd);
+    if (pages == MAP_FAILED)
+        return NULL;
+
+    if (mprotect(pages + page_size, page_size, PROT_NONE) != 0) {
+        munmap(pages, 2 * page_size);
+        return NULL;
+    }
+
+    return pages + page_size;
+}
+
+/**
+ * Porównuje z wersją skalarną każdą wersję funkcji, którą może wykonać
+ * procesor.
+ * @return EXIT_SUCCESS, jeżeli wszystkie wersje dały te same wyniki,
+ *         EXIT_FAILURE w p.p.
+ */
+int main(void) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    char *page_end1 = guardedPage(page_size);
+    char *page_end2 = guardedPage(page_size);
+    if (page_end1 == NULL || page_end2 == NULL) {
+        fprintf(stderr, "nie udało się przygotować stron pamięci\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t count;
+    NumberScanKernels const *kernels = numberScanKernels(&count);
+
+    // Wersję skalarną też porównuję z nią samą, co sprawdza jej wyniki
+    for (size_t i = 0; i < count; i++) {
+        size_t previous = failures;
+        testSpan(&kernels[0], &kernels[i]);
+        testSpanPageEnd(&kernels[0], &kernels[i], page_end1);
+        testCommonPrefix(&kernels[0], &kernels[i]);
+        testCommonPrefixPageEnd(&kernels[0], &kernels[i], page_end1, page_end2);
+        printf("%s: %s\n", kernels[i].name, failures == previous ? "OK" : "BŁĄD");
+    }
+
+    munmap(page_end1 - page_size, 2 * page_size);
+    munmap(page_end2 - page_size, 2 * page_size);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
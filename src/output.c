@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+#include "output.h"
+
+/**
+ * Bufor wyjścia.
+ */
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+
+/**
+ * Liczba zajętych bajtów bufora wyjścia.
+ */
+static size_t output_size = 0;
+
+void outputFlush() {
+    if (output_size > 0)
+        fwrite(output_buffer, sizeof(char), output_size, stdout);
+
+    output_size = 0;
+    fflush(stdout);
+}
+
+void outputWrite(char const *chars, size_t n) {
+    if (output_size + n > OUTPUT_BUFFER_SIZE) {
+        outputFlush();
+
+        // Bardzo długi napis nie zmieści się w buforze, więc wypisuję go od razu
+        if (n > OUTPUT_BUFFER_SIZE) {
+            fwrite(chars, sizeof(char), n, stdout);
+            return;
+        }
+    }
+
+    memcpy(output_buffer + output_size, chars, n);
+    output_size += n;
+}
+
+void outputLine(char const *line) {
+    outputWrite(line, strlen(line));
+    outputWrite("\n", 1);
+}
+
+void outputNumberLine(size_t value) {
+    // Cyfry zapisuję od końca, 20 cyfr wystarcza dla 64-bitowej liczby
+    char digits[3 * sizeof(size_t) + 1];
+    size_t i = sizeof(digits);
+
+    digits[--i] = '\n';
+    do {
+        digits[--i] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    outputWrite(digits + i, sizeof(digits) - i);
+}
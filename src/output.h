@@ -0,0 +1,44 @@
+/** @file
+ * Interfejs bufora wyjścia, przez który wypisywane są wyniki komend
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_OUTPUT_H
+#define TELEFONY_OUTPUT_H
+
+#include <stddef.h>
+
+/**
+ * Rozmiar bufora wyjścia. Zapełniony bufor jest wypisywany jednym wywołaniem fwrite.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+/**
+ * Dopisuje do bufora wyjścia ciąg bajtów.
+ * @param chars Dopisywane bajty
+ * @param n Liczba bajtów
+ */
+void outputWrite(char const *chars, size_t n);
+
+/**
+ * Dopisuje do bufora wyjścia napis zakończony znakiem nowej linii.
+ * @param line Napis zakończony '\0'
+ */
+void outputLine(char const *line);
+
+/**
+ * Dopisuje do bufora wyjścia liczbę w zapisie dziesiętnym i znak nowej linii.
+ * @param value Wypisywana liczba
+ */
+void outputNumberLine(size_t value);
+
+/**
+ * Wypisuje zawartość bufora na standardowe wyjście. Musi być wywołana przed
+ * zakończeniem programu, również w przypadku błędu.
+ */
+void outputFlush();
+
+#endif //TELEFONY_OUTPUT_H
@@ -1,14 +1,70 @@
 #include "phone_forward.h"
-#include "list.h"
+#include "forward_tree.h"
+#include "number_buffer.h"
+#include "arena.h"
+#include "snapshot_io.h"
+#include "worker_pool.h"
+#include "get_cache.h"
+#include "number_scan.h"
 
 #include <string.h>
-#include <ctype.h>
 #include <stdio.h>
+#include <stdint.h>
 
 /**
- * Definicja początkowego rozmiaru tablicy numerów dla struktury PhoneNumbers
+ * Początkowy rozmiar stosu węzłów NodeStack.
  */
-#define initial_numbers_array_size (2)
+#define INITIAL_STACK_CAPACITY 16
+
+/**
+ * Pierwsze bajty zrzutu bazy przekierowań.
+ */
+#define SNAPSHOT_MAGIC "PHFW"
+
+/**
+ * Wersja formatu zrzutu, zapisywana zaraz po SNAPSHOT_MAGIC.
+ */
+#define SNAPSHOT_VERSION 1
+
+/**
+ * Liczba węzłów drzew numerów źródłowych, które phfwdReverseParallel
+ * przegląda sama, zanim rozdzieli pozostałe poddrzewa między wątki.
+ * Mniejsze wyniki wyznaczane są bez tworzenia wątków.
+ */
+#define REVERSE_SEQUENTIAL_LIMIT 1024
+
+/**
+ * Liczba poddrzew przypadających na wątek, po której osiągnięciu
+ * phfwdReverseParallel przestaje dzielić pracę.
+ */
+#define REVERSE_TASKS_PER_WORKER 8
+
+/**
+ * Liczba węzłów indeksu odwrotnego, które phfwdNonTrivialCount odwiedza sama,
+ * zanim rozdzieli pozostałe poddrzewa między wątki.
+ */
+#define NON_TRIVIAL_SEQUENTIAL_LIMIT 4096
+
+/**
+ * Liczba poddrzew przypadających na wątek, po której osiągnięciu
+ * phfwdNonTrivialCount przestaje przeglądać węzły sama.
+ */
+#define NON_TRIVIAL_TASKS_PER_WORKER 8
+
+/**
+ * Oznacza brak poprzedniego kroku ścieżki w phfwdReverseParallel.
+ */
+#define REVERSE_NO_STEP SIZE_MAX
+
+/**
+ * Indeks oznaczający brak węzła w zamrożonym drzewie.
+ */
+#define FROZEN_NONE UINT32_MAX
+
+/**
+ * Rozmiar bufora na stosie, do którego phfwdGet wyznacza wynik.
+ */
+#define GET_BUFFER_SIZE 64
 
 /**
  * Domyslnie ustawione jako 0
@@ -22,9 +78,6 @@
 #define DEBUG_PRINT(...) \
             do { if (DEBUG_TEST) fprintf(stderr, __VA_ARGS__); } while (0)
 
-
-
-
 /** @file
  * Implementacja klasy przechowującej przekierowania numerów telefonicznych
  * @author Patryk Banach
@@ -33,727 +86,2697 @@
  */
 
 /**
- * @struct PhoneForward phone_forward.h
- * @details Struktura przechowująca przekierowania numerów telefonów, zaimplementowana
- * jako drzewo Patricia (Skompresowane drzewo trie).
+ * @struct PhoneNumbers phone_forward.h
+ * @details Struktura przechowująca numery telefonów indeksowane wedlug kolejnosci dodania, od zera.
+ * Struktura, początki numerów i ich znaki zajmują jeden blok pamięci, alokowany
+ * dopiero wtedy, gdy znana jest liczba numerów i łączna liczba ich znaków.
+ */
+struct PhoneNumbers {
+    char *chars;            ///< Znaki kolejnych numerów, każdy zakończony '\0'
+    size_t *offsets;        ///< Początki kolejnych numerów w tablicy @p chars
+
+    size_t numbers_count;   ///< Ilość numerów telefonów przechowywanych w strukturze
+    size_t chars_size;      ///< Liczba zajętych bajtów tablicy @p chars
+};
+typedef struct PhoneNumbers PhoneNumbers; ///< domyślny typedef
+
+/**
+ * @struct batch_query
+ * @details Numer z zapytania wsadowego wraz z jego pozycją w tablicy wejściowej.
  */
-struct PhoneForward {
-    char *key;                     ///< ciąg znaków zapisanych w danym węźle
-    char *phfwd;                   ///< przekierowanie dla prefixu złożonego z kluczy przechowywanych w ciągu od korzenia do obecnego węzła
+typedef struct batch_query {
+    char const *num;    ///< Numer
+    size_t length;      ///< Długość numeru
+    size_t index;       ///< Pozycja numeru w tablicy wejściowej
+} BatchQuery;
 
-    size_t key_length;             ///< dlugosc klucza
+/**
+ * @struct bulk_pair
+ * @details Przekierowanie dodawane przez phfwdAddBulk wraz z jego pozycją
+ * w tablicach wejściowych.
+ */
+typedef struct bulk_pair {
+    char const *num1;       ///< Prefiks przekierowywany
+    size_t num1_length;     ///< Długość prefiksu przekierowywanego
+    char const *num2;       ///< Prefiks, na który przekierowuję
+    size_t num2_length;     ///< Długość prefiksu, na który przekierowuję
+    size_t index;           ///< Pozycja pary w tablicach wejściowych
+    uint64_t num1_head;     ///< Początek num1 w postaci porównywalnej jak liczba
+    uint64_t num2_head;     ///< Początek num2 w postaci porównywalnej jak liczba
+} BulkPair;
 
-    struct PhoneForward *child;    ///< wskaźnik na pierwsze dziecko obecnego węzła
-    struct PhoneForward *next;     ///< wskaźnik na rodzeństwo obecnego węzła
-};
-typedef struct PhoneForward PhoneForward; ///< domyślny typedef
+/**
+ * Drzewa budowane przez phfwdAddBulk z posortowanych par.
+ */
+typedef enum bulk_tree {
+    BULK_FORWARDS,  ///< Drzewo przekierowań, klucze num1 posortowane rosnąco
+    BULK_TARGETS,   ///< Indeks odwrotny, pary posortowane według num2, a potem num1
+    BULK_SOURCES    ///< Numery źródłowe jednego celu, klucze num1 posortowane rosnąco
+} BulkTree;
 
 /**
- * @struct PhoneNumbers phone_forward.h
- * @details Struktura przechowująca numery telefonów indeksowane wedlug kolejnosci dodania, od zera.
+ * @struct descent_frame
+ * @details Węzeł na ścieżce zejścia w głąb drzewa, razem z najgłębszym
+ * przekierowaniem znalezionym do tej pory na tej ścieżce.
  */
-struct PhoneNumbers {
-    char **numbers;             ///< Tablica wskaźników na numery telefonów
+typedef struct descent_frame {
+    Node *node;         ///< Węzeł, którego cały klucz pasuje do numeru
+    size_t depth;       ///< Długość ścieżki od korzenia do węzła
+    Node *best;         ///< Najgłębszy węzeł z przekierowaniem na ścieżce lub NULL
+    size_t best_depth;  ///< Długość ścieżki od korzenia do węzła @p best
+} DescentFrame;
+
+/**
+ * @struct frozen_node
+ * @details Węzeł zamrożonego drzewa. Zamiast wskaźników przechowuje indeksy:
+ * dzieci węzła leżą obok siebie w tablicy węzłów, a klucz i wartość są
+ * fragmentami wspólnej puli znaków.
+ */
+typedef struct frozen_node {
+    uint32_t key_offset;        ///< Początek klucza w puli znaków
+    uint32_t key_length;        ///< Długość klucza
+    uint32_t value_offset;      ///< Początek przekierowania w puli znaków, a w indeksie odwrotnym indeks korzenia drzewa numerów źródłowych
+    uint32_t value_length;      ///< Długość przekierowania
+    uint32_t first_child;       ///< Indeks pierwszego dziecka
+    uint8_t children_count;     ///< Liczba dzieci
+    bool terminal;              ///< Czy ścieżka od korzenia do węzła ma przypisaną wartość
+} FrozenNode;
 
-    size_t numbers_count;          ///< Ilość numerów telefonów przechowywanych w tablicy
-    size_t numbers_array_size;     ///< Aktualny rozmiar tablicy
+/**
+ * @struct FrozenForward phone_forward.h
+ * @details Niezmienna kopia bazy przekierowań. Węzły drzewa przekierowań,
+ * a po nich indeksu odwrotnego, ułożone są wszerz w jednej tablicy, więc
+ * dzieci węzła zajmują spójny przedział. Pierwsze znaki kluczy leżą w osobnej
+ * tablicy, dzięki czemu szukanie dziecka przegląda kilka sąsiednich bajtów.
+ */
+struct FrozenForward {
+    FrozenNode *nodes;      ///< Węzły; korzeń drzewa przekierowań ma indeks 0
+    char *first_chars;      ///< Pierwsze znaki kluczy kolejnych węzłów
+    char *pool;             ///< Znaki wszystkich kluczy i przekierowań
+    size_t nodes_count;     ///< Liczba węzłów
+    uint32_t targets;       ///< Indeks korzenia indeksu odwrotnego
 };
-typedef struct PhoneNumbers PhoneNumbers; ///< domyślny typedef
+typedef struct FrozenForward FrozenForward; ///< domyślny typedef
 
+/**
+ * @struct frozen_frame
+ * @details Element stosu używanego do przeglądania zamrożonego drzewa.
+ */
+typedef struct frozen_frame {
+    uint32_t node;  ///< Indeks węzła do odwiedzenia
+    size_t depth;   ///< Długość ścieżki od korzenia do rodzica węzła
+} FrozenFrame;
 
-bool isDigitWrapper(char c) {
-    return (isdigit(c) || c == ';' || c == ':');
-}
+/**
+ * @struct reverse_step
+ * @details Węzeł drzewa numerów źródłowych odwiedzony przy dzieleniu pracy
+ * phfwdReverseParallel. Kroki tworzą drzewo, z którego odtwarzane są ścieżki,
+ * więc ścieżki nie muszą być kopiowane dla każdego poddrzewa.
+ */
+typedef struct reverse_step {
+    Node *node;     ///< Węzeł
+    size_t parent;  ///< Krok rodzica węzła lub REVERSE_NO_STEP
+} ReverseStep;
 
 /**
- * Sprawdza czy w ciągu znaków num znajdują się tylko znaki uznawane za cyfry.
- * @param num Sprawdzany ciąg znaków
- * @return False gdy w ciągu znajduje się znak niebędący cyfrą od 0 do 9. True w pozostałych przypadkach.
+ * @struct reverse_task
+ * @details Poddrzewo drzewa numerów źródłowych do przejrzenia przez wątek.
  */
-static inline bool isNumber(const char *num) {
-    //Według definicji, pusty ciąg znaków nie jest numerem
-    if (num == NULL) {
-        return false;
-    }
+typedef struct reverse_task {
+    Node *node;     ///< Korzeń poddrzewa
+    size_t parent;  ///< Krok rodzica węzła lub REVERSE_NO_STEP
+    size_t depth;   ///< Długość ścieżki od korzenia drzewa do rodzica węzła
+    size_t suffix;  ///< Początek sufiksu dołączanego do numerów, w szukanym numerze
+} ReverseTask;
 
-    size_t len = strlen(num);
-    unsigned int i = 0;
-    bool result = true;
+/**
+ * @struct reverse_worker
+ * @details Stan wątku przeglądającego poddrzewa w phfwdReverseParallel.
+ */
+typedef struct reverse_worker {
+    NodeStack stack;    ///< Stos przeglądania
+    char *path;         ///< Bufor na numery z drzewa
+    size_t capacity;    ///< Rozmiar bufora
+    bool failed;        ///< Czy nie udało się zaalokować pamięci
+} ReverseWorker;
 
-    while (i < len && result) {
-        result = (isDigitWrapper(num[i]) != 0);
-        i++;
-    }
+/**
+ * @struct reverse_job
+ * @details Dane zlecenia phfwdReverseParallel wspólne dla wszystkich wątków.
+ */
+typedef struct reverse_job {
+    char const *num;            ///< Szukany numer
+    size_t num_length;          ///< Długość numeru
+    ReverseStep const *steps;   ///< Kroki odwiedzone przy dzieleniu pracy
+    ReverseTask const *tasks;   ///< Poddrzewa do przejrzenia
+    ReverseWorker *workers;     ///< Stany wątków
+    NumberBuffer *results;      ///< Wyniki wątków
+} ReverseJob;
 
-    return result && len != 0;
-}
+/**
+ * @struct reverse_cursor_item
+ * @details Element kopca kursora przekierowań: poddrzewo drzewa numerów
+ * źródłowych, którego wszystkie numery są nie mniejsze niż ścieżka do jego
+ * korzenia, albo gotowy numer wyniku. Element utworzony dla dziecka węzła
+ * pamięta swoje miejsce w rodzicu, bo dalsze rodzeństwo trafia do kopca
+ * dopiero po nim.
+ */
+typedef struct reverse_cursor_item {
+    Node *node;             ///< Korzeń poddrzewa lub NULL dla gotowego numeru
+    Node *parent;           ///< Rodzic, którego dzieckiem jest element, lub NULL
+    size_t slot;            ///< Pole dziecka w tablicy dzieci rodzica
+    char *number;           ///< Ścieżka do korzenia poddrzewa lub numer, zakończone '\0'
+    size_t length;          ///< Długość napisu @p number
+    size_t parent_length;   ///< Długość ścieżki do rodzica, będącej prefiksem @p number
+    size_t suffix;          ///< Początek sufiksu dołączanego do numerów, w szukanym numerze
+} ReverseCursorItem;
 
 /**
- * Inicjalizuje egzemplarz struktury PhoneForward.
- * @param[in] pf        Inicjalizowana struktura
- * @param[in] key       Przypisywany klucz
- * @param[in] phfwd     Przypisywane przekierowanie
- * @param[in] child     Wskaźnik na dziecko
- * @param[in] next      Wskaźnik na rodzeństwo
+ * @struct ReverseCursor phone_forward.h
+ * @details Kursor przeglądający przekierowania na numer w porządku
+ * leksykograficznym. Numery drzew numerów źródłowych z dołączonym sufiksem
+ * nie są uporządkowane tak jak same drzewa, dlatego kursor rozwija zawsze
+ * najmniejszy element kopca, a numer wydaje dopiero, gdy żadne poddrzewo
+ * w kopcu nie może zawierać mniejszego. Kopiec zawiera tylko węzły sąsiadujące
+ * z bieżącymi ścieżkami, więc pamięć nie zależy od liczby wyników.
  */
-static inline void
-phfwdIni(PhoneForward *pf, const char *key, const char *phfwd, PhoneForward *child,
-         PhoneForward *next) {
-    if (key != NULL) {
-        free((void *) pf->key);
-        size_t key_len = strlen(key);
-        pf->key = malloc((key_len + 1) * sizeof(char));
-        pf->key[key_len] = '\0';
-        strcpy(pf->key, key);
-        pf->key_length = key_len;
-    } else {
-        pf->key = malloc(sizeof(char));
-        pf->key[0] = '\0';
-        pf->key_length = 0;
-    }
+struct ReverseCursor {
+    char *num;                  ///< Kopia szukanego numeru
+    size_t num_length;          ///< Długość numeru
+    ReverseCursorItem *heap;    ///< Kopiec elementów do przejrzenia
+    size_t size;                ///< Liczba elementów kopca
+    size_t capacity;            ///< Rozmiar tablicy @p heap
+    Arena strings;              ///< Alokator napisów elementów
+    char *last;                 ///< Ostatnio wydany numer lub początkowe ograniczenie, albo NULL
+    size_t last_length;         ///< Długość napisu @p last
+    size_t limit;               ///< Największa liczba wydanych numerów, 0 oznacza brak ograniczenia
+    size_t emitted;             ///< Liczba wydanych numerów
+};
+typedef struct ReverseCursor ReverseCursor; ///< domyślny typedef
 
-    if (phfwd != NULL) {
-        free((void *) pf->phfwd);
-        size_t phfwd_len = strlen(phfwd);
-        pf->phfwd = malloc((phfwd_len + 1) * sizeof(char));
-        pf->phfwd[phfwd_len] = '\0';
-        strcpy(pf->phfwd, phfwd);
-    } else {
-        pf->phfwd = malloc(sizeof(char));
-        pf->phfwd[0] = '\0';
-    }
+/**
+ * @struct non_trivial_worker
+ * @details Stan wątku zliczającego kombinacje w phfwdNonTrivialCount.
+ */
+typedef struct non_trivial_worker {
+    NodeStack stack;    ///< Stos przeglądania
+    size_t count;       ///< Suma kombinacji przejrzanych poddrzew
+    bool failed;        ///< Czy nie udało się zaalokować pamięci
+} NonTrivialWorker;
+
+/**
+ * @struct non_trivial_job
+ * @details Dane zlecenia phfwdNonTrivialCount wspólne dla wszystkich wątków.
+ */
+typedef struct non_trivial_job {
+    NodeFrame const *tasks;                 ///< Poddrzewa do przejrzenia
+    bool const *available_chars;            ///< Które znaki są dostępne
+    unsigned int num_of_available_chars;    ///< Liczba dostępnych znaków
+    NonTrivialWorker *workers;              ///< Stany wątków
+} NonTrivialJob;
 
-    pf->child = child;
-    pf->next = next;
+bool isDigitWrapper(char c) {
+    // Znaki od '0' do ';' leżą obok siebie, wystarczy jedno porównanie
+    return (unsigned char) (c - '0') <= ';' - '0';
 }
 
 /**
- * Inicjalizuje egzemplarz struktury PhoneNumbers
- * @param[in] (*t) Inicjalizowana struktura
+ * Przygotowuje wyzerowaną pamięć na napis danej długości.
+ * @param[in] pf        Baza, z której alokatora pochodzi napis
+ * @param[out] s        Napis, dotąd bez pamięci
+ * @param[in] length    Liczba cyfr
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
  */
-static inline void phNumIni(PhoneNumbers *(*t)) {
-    if ((*t) != NULL) {
-        (*t)->numbers_count = 0;
-        (*t)->numbers_array_size = initial_numbers_array_size;
-        (*t)->numbers = malloc(initial_numbers_array_size * sizeof(char *));
-        for (int i = 0; i < initial_numbers_array_size; i++) {
-            (*t)->numbers[i] = NULL;
-        }
-    }
-}
+static bool stringReserve(PhoneForward *pf, ShortString *s, size_t length) {
+    if (length > INLINE_STRING_CAPACITY) {
+        s->heap = arenaAlloc(&pf->bytes, packedSize(length));
+        if (s->heap == NULL)
+            return false;
 
-PhoneForward *phfwdNew(void) {
-    PhoneForward *ret = (PhoneForward *) malloc(sizeof(PhoneForward));
-    // Inicjalizuję ret z domyślnymi wartościami
-    phfwdIni(ret, NULL, NULL, NULL, NULL);
-    return ret;
+        memset(s->heap, 0, packedSize(length));
+    } else
+        memset(s->inline_digits, 0, sizeof(s->inline_digits));
+
+    s->length = length;
+    return true;
 }
 
 /**
- * Dzieli węzęł drzewa PhoneForward na dwa.
- * @details Funkcja pomocnicza dzielaca węzęł drzewa PhoneForward na dwa. W węźle-rodzicu pozostaje
- * numer o długości k, w węźle-dziecku jako klucz przypisywane zostaje pozostałe key_length - k znaków.
- * @param[in]  parent                    Wskaźnik na dzielony węzeł
- * @param[in]  remaining_length          Długość ciągu znaków, który pozostanie w kluczu węzła-rodzica
+ * Pakuje znaki do napisu.
+ * @param[in, out] digits   Spakowane cyfry, wyzerowane od pozycji @p from
+ * @param[in] from          Pozycja pierwszej zapisywanej cyfry
+ * @param[in] chars         Znaki
+ * @param[in] length        Liczba znaków
  */
-void splitNode(PhoneForward **parent, size_t remaining_length) {
+static void packChars(unsigned char *digits, size_t from, char const *chars,
+                      size_t length) {
+    for (size_t i = 0; i < length; i++)
+        packedSetDigit(digits, from + i, (unsigned) (chars[i] - '0'));
+}
 
-    PhoneForward *child = phfwdNew();
-    child->child = (*parent)->child;
+bool stringAssignConcat(PhoneForward *pf, ShortString *s, const char *s1,
+                        size_t s1_len, const char *s2, size_t s2_len) {
+    ShortString result;
+    if (!stringReserve(pf, &result, s1_len + s2_len))
+        return false;
 
-    /*-------nadpisuje przekierowanie ----*/
-    free((void *) (child)->phfwd);
+    packChars(stringDigits(&result), 0, s1, s1_len);
+    packChars(stringDigits(&result), s1_len, s2, s2_len);
 
-    char *a;
-    size_t phfwd_len = strlen((*parent)->phfwd);
-    a = (char *) malloc((phfwd_len + 1) * sizeof(char));
-    if (a != NULL) {
-        strcpy(a, (*parent)->phfwd);
-        a[phfwd_len] = '\0';
-    }
-    child->phfwd = a;
+    stringClear(pf, s);
+    *s = result;
+    return true;
+}
 
-    /*-------nadpisuje klucz ----*/
 
-    size_t child_key_length = (*parent)->key_length - remaining_length;
-    free((void *) (child)->key);
-    child->key = (char *) malloc((child_key_length + 1) * sizeof(char));
+bool stringAssignSlice(PhoneForward *pf, ShortString *s, ShortString const *a,
+                       size_t a_from, size_t a_length, ShortString const *b,
+                       size_t b_length) {
+    ShortString result;
+    if (!stringReserve(pf, &result, a_length + b_length))
+        return false;
 
-    if (child->key != NULL) {
-        strncpy(child->key, (*parent)->key + remaining_length, child_key_length);
-        child->key[child_key_length] = '\0';
-    }
-    child->key_length = child_key_length;
+    unsigned char *digits = stringDigits(&result);
+    unsigned char const *a_digits = stringDigits(a);
+    for (size_t i = 0; i < a_length; i++)
+        packedSetDigit(digits, i, packedDigit(a_digits, a_from + i));
 
-    /*-------nadpisuje klucz rodzica pozostaloscia ----*/
+    for (size_t i = 0; i < b_length; i++)
+        packedSetDigit(digits, a_length + i, packedDigit(stringDigits(b), i));
 
-    a = (char *) malloc((remaining_length + 1) * sizeof(char));
-    if (a != NULL) {
-        strncpy(a, (*parent)->key, remaining_length);
-        a[remaining_length] = '\0';
-    }
+    stringClear(pf, s);
+    *s = result;
+    return true;
+}
 
-    free((void *) (*parent)->key);
-    (*parent)->key = a;
-    (*parent)->key_length = remaining_length;
+/**
+ * Zamienia rzadką tablicę dzieci węzła na gęstą.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł
+ * @return True, jeżeli udało się zaalokować pamięć, false w p.p.
+ */
+static bool makeDense(PhoneForward *pf, Node *node) {
+    Node **table = arenaAlloc(&pf->bytes, childrenTableSize(true));
+    if (table == NULL)
+        return false;
 
-    if ((*parent)->phfwd != NULL) {
-        (*parent)->phfwd[0] = '\0';
-    }
+    for (size_t i = 0; i < NUMBER_OF_DIGITS; i++)
+        table[i] = NULL;
 
-    (*parent)->child = child;
+    for (size_t i = 0; i < node->children_count; i++)
+        table[digitIndex(node->child_keys[i])] = node->children[i];
 
+    arenaFree(&pf->bytes, node->children, childrenTableSize(false));
+    node->children = table;
+    node->dense = true;
+    return true;
 }
 
 /**
- * Szuka długości najdłuższego wspólngo prefiksu ciągów num1 i num2.
- * @details Funkcja pomocnicza znajdująca długość najdłuższego wspólngo prefiksu ciągów num1 i num2.
- * @param[in] num1      Pierwszy z porównywanych napisów
- * @param[in] num1_len  Dlugość pierwszego ciągu znaków
- * @param[in] num2      Drugi z porównywanych napisów
- * @param[in] num2_len  Dlugość drugiego ciągu znaków
- * @return Dlugość najduższego porównywanego napisu.
+ * Zamienia gęstą tablicę dzieci węzła na rzadką.
+ * Wywoływana, gdy liczba dzieci spadnie do połowy pojemności węzła rzadkiego,
+ * dzięki czemu węzły na granicy nie zmieniają reprezentacji przy każdej operacji.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł
  */
-static inline size_t
-lengthOfLongestCommonPrefix(const char *num1, size_t num1_len, const char *num2,
-                            size_t num2_len) {
-    for (unsigned int k = 0; k < num1_len; k++) {
-        if (k == num2_len || num1[k] != num2[k]) {
-            return k;
+static void makeSparse(PhoneForward *pf, Node *node) {
+    Node **table = arenaAlloc(&pf->bytes, childrenTableSize(false));
+    if (table == NULL)
+        return;
+
+    size_t count = 0;
+    for (size_t i = 0; i < NUMBER_OF_DIGITS; i++) {
+        if (node->children[i] != NULL) {
+            table[count] = node->children[i];
+            node->child_keys[count] = nodeFirstChar(node->children[i]);
+            count++;
         }
     }
 
-    return (int) num1_len;
+    arenaFree(&pf->bytes, node->children, childrenTableSize(true));
+    node->children = table;
+    node->dense = false;
 }
 
-/**
- * Funkcja pomocnicza znajdująca najogólniejszy prefix dla napisu num, w drzewie t.
- * @param[in]      t                     Przeszukiwane drzewo.
- * @param[in]      num                   Numer którego prefiksu poszukujemy.
- * @param[in]      num_length            Długość poszukiwanego numeru.
- * @param[in]  depth_in_characters   Ilość już znalezionych znaków poszukiwanego numeru.
- * @return  Wskaźnik na znaleziony węzęł.
- */
-PhoneForward *
-phfwdFindPrefixMatch(PhoneForward *t, const char *num, size_t num_length,
-                     int *depth_in_characters) {
-    // *number_length to dlugosc numeru od korzenia do obecnego miejsca
-    if (!t) {
-        return NULL;
+bool insertChild(PhoneForward *pf, Node *node, Node *child) {
+    char c = nodeFirstChar(child);
+
+    if (!node->dense && node->children_count == SPARSE_CHILDREN_CAPACITY) {
+        if (!makeDense(pf, node))
+            return false;
     }
 
-    if (num_length == 0) {
-        num_length = strlen(num);
+    if (node->dense) {
+        node->children[digitIndex(c)] = child;
+        node->children_count++;
+        return true;
     }
-    DEBUG_PRINT("phfwdFindPrefix: Wezel o kluczu %s, z przekierowaniem na %s\n",
-                t->key, t->phfwd);
-    DEBUG_PRINT("Pozostaje num:  %s\n", num);
 
-    size_t common_prefix_len = lengthOfLongestCommonPrefix(num, num_length, t->key,
-                                                           t->key_length);
+    if (node->children == NULL) {
+        node->children = arenaAlloc(&pf->bytes, childrenTableSize(false));
+        if (node->children == NULL)
+            return false;
+    }
 
-    if (common_prefix_len == 0 && t->key_length != 0) {
-        return phfwdFindPrefixMatch(t->next, (num), num_length, depth_in_characters);
+    // Przesuwam większe klucze o jedno miejsce, zachowując porządek
+    size_t i = node->children_count;
+    while (i > 0 && node->child_keys[i - 1] > c) {
+        node->child_keys[i] = node->child_keys[i - 1];
+        node->children[i] = node->children[i - 1];
+        i--;
     }
+    node->child_keys[i] = c;
+    node->children[i] = child;
+    node->children_count++;
+
+    return true;
+}
 
-    // jezeli poszukiwany num zawiera sie w obecnym kluczu
-    // to, poniewaz przeszukujemy drzewo od korzenia
-    // nie znajdziemy ogolniejszego
+void removeChild(PhoneForward *pf, Node *node, char c) {
+    if (node->dense) {
+        node->children[digitIndex(c)] = NULL;
+        node->children_count--;
+        if (node->children_count <= SPARSE_CHILDREN_CAPACITY / 2)
+            makeSparse(pf, node);
+    } else {
+        size_t i = 0;
+        while (i < node->children_count && node->child_keys[i] != c)
+            i++;
 
-    if (common_prefix_len > 0 || t->key_length == 0) {
-        *depth_in_characters += common_prefix_len;
-        PhoneForward *temp = NULL;
-        //szukamy glebiej tylko jezeli caly obecny wezel jest zgodny
-        if (common_prefix_len == t->key_length) {
-            temp = phfwdFindPrefixMatch(t->child, (num + common_prefix_len),
-                                        num_length - common_prefix_len,
-                                        depth_in_characters);
-            if (temp != NULL)
-                return temp;
+        for (; i + 1 < node->children_count; i++) {
+            node->child_keys[i] = node->child_keys[i + 1];
+            node->children[i] = node->children[i + 1];
         }
-        *depth_in_characters -= common_prefix_len;
-        return t;
+        node->children_count--;
     }
 
-    return NULL;
+    if (node->children_count == 0) {
+        arenaFree(&pf->bytes, node->children, childrenTableSize(node->dense));
+        node->children = NULL;
+        node->dense = false;
+    }
 }
 
-/**
- * Nadpisuje napis to, napisem from.
- * @param[out] to            Nadpisywany napis
- * @param[in] from      Docelowy napis
- * @param[in] num_len   Dlugosc docelowego napisu
- */
-static inline void overwriteString(char **to, const char *from, size_t num_len) {
-    free((void *) *to);
-    char *temp = malloc((num_len + 1) * sizeof(char));
-    strcpy(temp, from);
-    temp[num_len] = '\0';
-    *to = temp;
-}
 
 
-/**
- * Rekurencyjnie przeszukuje drzewo PhoneForward i dodająca przekierowanie num2.
- * @param[in] pf        Przeszukiwana struktura
- * @param[in] num1      Przekierowywany numer
- * @param[in] num2      Przekierowanie
- * @param[in] num1_len Dlugosc przekierowanego numeru
- * @return          Wskaźnik na dodany węzeł, lub NULL jeżeli z jakiegoś powodu to się nie udało.
- */
-PhoneForward *
-phfwdAddUtil(PhoneForward *pf, char const *num1, char const *num2, size_t num1_len) {
-    //Najpierw szukam najgłębszego dopasowania w drzewie
-    int depth_in_characters = 0;
-    PhoneForward *temp = phfwdFindPrefixMatch(pf, num1, num1_len,
-                                              &depth_in_characters);
-
-    num1 = num1 + depth_in_characters;
-    num1_len = num1_len - depth_in_characters;
-
-    // Jeżeli temp == NULL, to tworzony jest nowy węzeł
-    if (!temp) {
-        DEBUG_PRINT("Brak wspolnych prefikow, tworze wezel %s ---> na %s\n",
-                    num1,
-                    num2);
-        PhoneForward *ret = phfwdNew();
-        phfwdIni(ret, num1, num2, NULL, NULL);
-        ret->next = pf->next;
-        pf->next = ret;
-        return ret;
-    }
-
-    if (temp->key[0] == '\0') {
-        DEBUG_PRINT("pf -> key jest pusty, nadpisuje go\n");
-        phfwdIni(temp, num1, num2, temp->child, temp->next);
-        return temp;
+bool stackPush(NodeStack *stack, Node *node, size_t depth) {
+    if (stack->size == stack->capacity) {
+        size_t capacity = stack->capacity > 0 ? 2 * stack->capacity
+                                              : INITIAL_STACK_CAPACITY;
+        NodeFrame *frames = realloc(stack->frames, capacity * sizeof(NodeFrame));
+        if (frames == NULL)
+            return false;
+
+        stack->frames = frames;
+        stack->capacity = capacity;
     }
 
-    DEBUG_PRINT("Temp to wezel o kluczu %s, z przekierowaniem na %s\n",
-                temp->key, temp->phfwd);
-    DEBUG_PRINT(
-            "Pomijajac go, do tej pory pokrylo sie %d znakow, pozostal numer  %s\n",
-            depth_in_characters, num1);
-
-    size_t common_prefix_len = lengthOfLongestCommonPrefix(num1, num1_len, temp->key,
-                                                           temp->key_length);
-    DEBUG_PRINT("Dlugosc common prefix miedzy %s a %s  to %ld \n", num1, temp->key,
-                common_prefix_len);
-
-    if (common_prefix_len == 0) {
-        //koniec sparowania, czyli nalezy stworzyc nowy wezel jako next od temp
-        DEBUG_PRINT(
-                "Common prefix jest pusty, nalezy stworzyc nowy wezel jako dziecko temp\n");
-        PhoneForward *ret = phfwdNew();
-        if (temp->child != NULL) {
-            phfwdIni(ret, num1, num2, NULL, temp->child->next);
-        } else {
-            phfwdIni(ret, num1, num2, NULL, NULL);
-        }
-        temp->child = ret;
-    } else if (common_prefix_len < num1_len) {
-        DEBUG_PRINT(
-                "Istnieje wspolny prefix, ale nie jest calym dodawanym numerem\n");
-        if (common_prefix_len < temp->key_length) {
-            DEBUG_PRINT("Wspolny prefix jest krotszy od obecnego klucza\n");
-            DEBUG_PRINT("Dziele obecny wezel\n");
-            splitNode(&temp, common_prefix_len);
-            DEBUG_PRINT("po podziale jestem w wezle o kluczu %s ---> %s\n",
-                        temp->key, temp->phfwd);
-            DEBUG_PRINT("dziecko to wezel o kluczu %s, z przekierowaniem na %s\n",
-                        (temp->child)->key,
-                        (temp->child)->phfwd);
-
-            PhoneForward *ret = phfwdNew();
-            phfwdIni(ret, num1 + common_prefix_len, num2, NULL, NULL);
-
-            DEBUG_PRINT("Tworze wezel dla numeru %s ----> %s\n",
-                        num1 + common_prefix_len, num2);
-            ret->next = temp->child;
-            temp->child = ret;
-
-            return ret;
-        } else if (common_prefix_len == temp->key_length) {
-            //obecny klucz to najglebsze dopasowanie, i jest ono pelne
-            //to znaczy ze ucinam num1 w dlugosci dopasowania, i tworze nowy wezel
-            PhoneForward *ret = phfwdNew();
-            phfwdIni(ret, num1 + common_prefix_len, num2, NULL, temp->child);
-            temp->child = ret;
-            return ret;
-        }
-    } else if (num1_len == common_prefix_len) {
-        if (temp->key_length == num1_len) {
-        } else {
-            DEBUG_PRINT("Wspolny prefix jest krotszy od obecnego klucza\n");
-            DEBUG_PRINT("Dziele obecny wezel\n");
-            splitNode(&temp, common_prefix_len);
-
-            DEBUG_PRINT("po podziale jestem w wezle o kluczu %s ---> %s\n",
-                        temp->key, temp->phfwd);
-            DEBUG_PRINT("dziecko to wezel o kluczu %s, z przekierowaniem na %s\n",
-                        (temp->child)->key,
-                        (temp->child)->phfwd);
-        }
-        size_t temp_length = strlen(num2);
-        overwriteString(&temp->phfwd, num2, temp_length);
-        DEBUG_PRINT("Nadpisuje przekierowanie dla temp\n");
-        DEBUG_PRINT("po Nadpisuniu jestem w wezle o kluczu %s ---> %s\n",
-                    temp->key, temp->phfwd);
+    stack->frames[stack->size].node = node;
+    stack->frames[stack->size].depth = depth;
+    stack->size++;
+    return true;
+}
 
+bool stackPushChildren(NodeStack *stack, Node const *node, size_t depth) {
+    for (size_t i = childSlots(node); i > 0; i--) {
+        if (node->children[i - 1] != NULL &&
+            !stackPush(stack, node->children[i - 1], depth))
+            return false;
     }
-    return pf;
+
+    return true;
 }
 
+/**
+ * Zapewnia, że bufor na numery ma co najmniej @p length bajtów.
+ * @param[in, out] path     Bufor
+ * @param[in, out] capacity Rozmiar bufora
+ * @param[in] length        Wymagany rozmiar
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool reservePath(char **path, size_t *capacity, size_t length) {
+    if (length <= *capacity)
+        return true;
 
-bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2) {
-    if (!isNumber(num2) || !isNumber(num1) || !pf || strcmp(num1, num2) == 0) {
+    size_t new_capacity = 2 * (*capacity) > length ? 2 * (*capacity) : length;
+    char *new_path = realloc(*path, new_capacity);
+    if (new_path == NULL)
         return false;
-    }
-    DEBUG_PRINT("dodaje numer %s \n", num1);
 
-    size_t num1_len = strlen(num1);
-    PhoneForward *ret = phfwdAddUtil(pf, num1, num2, num1_len);
-
-    DEBUG_PRINT("\n\n");
-    return ret != NULL;
+    *path = new_path;
+    *capacity = new_capacity;
+    return true;
 }
 
 /**
- * Dokładnie jak phfwdAdd, z tą różnicą, że ta dopuszcza num1 == num2
+ * Inicjalizuje egzemplarz struktury Node.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in] node          Inicjalizowana struktura
+ * @param[in] key           Przypisywany klucz
+ * @param[in] key_length    Długość przypisywanego klucza
+ * @param[in] phfwd         Przypisywane przekierowanie lub NULL
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
  */
-bool
-phfwdAddforNonTrivial(struct PhoneForward *pf, char const *num1, char const *num2) {
-    if (!isNumber(num2) || !isNumber(num1) || !pf) {
+static inline bool
+nodeIni(PhoneForward *pf, Node *node, const char *key, size_t key_length,
+        const char *phfwd) {
+    stringIni(&node->key);
+    stringIni(&node->phfwd);
+    node->children = NULL;
+    node->children_count = 0;
+    node->dense = false;
+    node->terminal = phfwd != NULL;
+    node->building = false;
+
+    if (!stringAssign(pf, &node->key, key, key_length))
         return false;
-    }
-    DEBUG_PRINT("dodaje numer na potrzeby NonTrivial %s \n", num1);
 
-    size_t num1_len = strlen(num1);
-    PhoneForward *ret = phfwdAddUtil(pf, num1, num2, num1_len);
+    if (phfwd != NULL && !stringAssign(pf, &node->phfwd, phfwd, strlen(phfwd))) {
+        stringClear(pf, &node->key);
+        return false;
+    }
 
-    DEBUG_PRINT("\n\n");
-    return ret != NULL;
+    return true;
 }
 
 /**
- * Funkcja pomocnicza, znajdująca dokładne trafienie dla napisu num w drzewie t.
- * @param[in] t                 Przeszukiwane drzewo
- * @param[in] num               Wzór szukanego napisu
- * @param[in] len_from_root     Dlugośc napisu od korzenia do obecnego węzła
- * @param[in]  num_length       Dlugosc wzoru
- * @return wskaźnik na węzeł zawierający odpowiadający klucz, lub NULL, jeżeli taki nie istnieje
+ * Tworzy pustą strukturę PhoneNumbers z miejscem na podaną liczbę numerów
+ * i znaków.
+ * @param[in] count         Liczba numerów
+ * @param[in] chars_size    Łączna długość numerów razem z kończącymi je znakami '\0'
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się zaalokować pamięci.
  */
-PhoneForward *
-phfwdFindExactMatch(PhoneForward *t, char const *num, int *len_from_root,
-                    size_t num_length) {
-    // *number_length to dlugosc numeru od korzenia do obecnego miejsca
-    if (!t) {
+static PhoneNumbers *phnumNew(size_t count, size_t chars_size) {
+    if (count > (SIZE_MAX - sizeof(PhoneNumbers) - chars_size) / sizeof(size_t))
         return NULL;
-    }
 
-    if (num_length == 0) {
-        num_length = strlen(num);
-    }
-    DEBUG_PRINT("Szukam trafienia dla %s \n", num);
-    DEBUG_PRINT("Jestem w wezle o kluczu %s \n", t->key);
-    size_t common_prefix_len = lengthOfLongestCommonPrefix(num, num_length,
-                                                           t->key, t->key_length);
-
-    *len_from_root += common_prefix_len;
-    DEBUG_PRINT("common prefix len to %ld, a len from root to %d \n",
-                common_prefix_len, *len_from_root);
-
-    // Brak wspolnego prefixu: szukam wsrod rodzenstwa
-    if (common_prefix_len == 0) {
-        return phfwdFindExactMatch(t->next, num, len_from_root, num_length);
-    }
-    // Jezeli caly klucz jest zgodnym prefiksem, to zapamiętuje
-    // węzeł jako potencjalnie najlepsze trafienie, i przeszukuję drzewo w głąb
-    if (common_prefix_len == t->key_length) {
-
-        int temporary_num_len = *len_from_root;
-        PhoneForward *temporary;
-        temporary = phfwdFindExactMatch(t->child, num + common_prefix_len,
-                                        len_from_root,
-                                        num_length -
-                                        common_prefix_len);
-        if (temporary != NULL)
-            return temporary;
-        else {
-            *len_from_root = temporary_num_len;
-        }
+    PhoneNumbers *t = malloc(sizeof(PhoneNumbers) + count * sizeof(size_t) +
+                             chars_size);
+    if (t == NULL)
+        return NULL;
 
-    }
-    if (common_prefix_len == t->key_length && (num_length >= t->key_length))
-        return t;
+    t->offsets = (size_t *) (t + 1);
+    t->chars = (char *) (t->offsets + count);
+    t->numbers_count = 0;
+    t->chars_size = 0;
 
-    return NULL;
+    return t;
 }
 
-
 /**
- * Funkcja pomocnicza łącząca dwa napisy.
- * @param[in] s1
- * @param[in] s2
- * @return Wskaźnik na napis stworzony z połączonych napisów s1 i s2
+ * Dopisuje do struktury PhoneNumbers numer będący złączeniem napisów @p s1
+ * i @p s2. Miejsce na numer musi być zarezerwowane przez phnumNew.
+ * @param[in, out] t    Struktura
+ * @param[in] s1        Pierwsza część numeru
+ * @param[in] s1_len    Długość pierwszej części
+ * @param[in] s2        Druga część numeru
+ * @param[in] s2_len    Długość drugiej części
  */
-char *concatenate(const char *s1, const char *s2) {
-    const size_t len1 = strlen(s1);
-    size_t len2 = 0;
-    len2 = strlen(s2);
-    char *result = malloc(len1 + len2 + 1);
-    memcpy(result, s1, len1);
-    memcpy(result + len1, s2, len2 + 1);
-    return result;
+static void phnumAppend(PhoneNumbers *t, char const *s1, size_t s1_len,
+                        char const *s2, size_t s2_len) {
+    char *number = t->chars + t->chars_size;
+    memcpy(number, s1, s1_len);
+    memcpy(number + s1_len, s2, s2_len);
+    number[s1_len + s2_len] = '\0';
+
+    t->offsets[t->numbers_count++] = t->chars_size;
+    t->chars_size += s1_len + s2_len + 1;
 }
 
 /**
- * Funkcja pomocnicza dodająca numer do struktury PhoneNumbers
- * @param[in] t    Struktura do której dodwany jest numer
- * @param[in] num   Dodawany numer
+ * Tworzy strukturę PhoneNumbers z kopii podanych numerów.
+ * @param[in] numbers   Tablica numerów
+ * @param[in] count     Liczba numerów
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się zaalokować pamięci.
  */
-void addNumber(PhoneNumbers *t, const char *num) {
-    // Jeżeli liczba numerów w strukturze jest równa ich maksymalnej liczbie
-    // to rozmiar tablicy wskaźnków zwiększany jest dwukrotnie
-    if (t->numbers_count >= t->numbers_array_size) {
-        t->numbers = (char **) realloc(t->numbers, (2 * (t->numbers_array_size)) *
-                                                   sizeof(char *));
-        size_t temp = t->numbers_array_size;
-        t->numbers_array_size = 2 * (t->numbers_array_size);
-        for (size_t i = temp; i < t->numbers_array_size; i++) {
-            t->numbers[i] = NULL;
-        }
-    }
+static PhoneNumbers *phnumFromArray(char const *const *numbers, size_t count) {
+    size_t chars_size = 0;
+    for (size_t i = 0; i < count; i++)
+        chars_size += strlen(numbers[i]) + 1;
 
-    size_t len = strlen(num);
-    t->numbers[t->numbers_count] = malloc(len * sizeof(char) + 1);
-    t->numbers[t->numbers_count][len] = '\0';
-    strcpy(t->numbers[t->numbers_count], num);
-    t->numbers_count++;
-}
+    PhoneNumbers *t = phnumNew(count, chars_size);
+    if (t == NULL)
+        return NULL;
 
-PhoneNumbers const *phfwdGet(struct PhoneForward *pf, char const *num) {
+    for (size_t i = 0; i < count; i++)
+        phnumAppend(t, numbers[i], strlen(numbers[i]), "", 0);
 
+    return t;
+}
 
-    PhoneNumbers *result;
-    result = malloc(sizeof(PhoneNumbers));
-    phNumIni(&result);
+void nodeFree(PhoneForward *pf, Node *node) {
+    if (node->children != NULL)
+        arenaFree(&pf->bytes, node->children, childrenTableSize(node->dense));
+    stringClear(pf, &node->key);
+    stringClear(pf, &node->phfwd);
+    arenaFree(&pf->nodes, node, sizeof(Node));
+}
 
-    if (result == NULL)
-        return NULL;
+void nodeDelete(PhoneForward *pf, Node *node) {
+    if (node == NULL)
+        return;
 
-    if (num == NULL || !isNumber(num))
-        return result;
+    // Liść, najczęstszy przypadek, nie potrzebuje stosu
+    if (node->children_count == 0) {
+        nodeFree(pf, node);
+        return;
+    }
 
-    /* szukam najdluzszego pasujacego prefixu przekierowania */
-    PhoneForward *tmp;
-    int number_length = 0;
-    tmp = phfwdFindExactMatch(pf, num, &number_length, 0);
-
-    if (tmp != NULL && tmp->phfwd[0] != '\0') {
-        char *number;
-        number = concatenate(tmp->phfwd, num + number_length);
-        addNumber(result, number);
-        free((void *) number);
-    } else
-        addNumber(result, num);
+    NodeStack stack;
+    stackIni(&stack);
+    bool success = stackPush(&stack, node, 0);
 
+    while (success && stack.size > 0) {
+        Node *t = stackPop(&stack).node;
+        success = stackPushChildren(&stack, t, 0);
+        if (success)
+            nodeFree(pf, t);
+    }
 
-    return result;
+    stackFree(&stack);
 }
 
-/**
- * Wypisuje drzewo PhoneForward.
- * @param[in]  pf       Wskaznik na wypisywaną strukturę
- * @param[in]  indent   glebokosc wciecia dla obecnego wezla
- */
-void phfwdPrint(PhoneForward *pf, int indent) {
-    //rekurencyjnie wypisuje drzewo PhoneForward
-    for (int i = 0; i < indent; i++)
-        DEBUG_PRINT("---");
+Node *nodeNew(PhoneForward *pf, const char *key, size_t key_length,
+              const char *phfwd) {
+    Node *ret = arenaAlloc(&pf->nodes, sizeof(Node));
+    if (ret == NULL)
+        return NULL;
 
-    if (pf != NULL) {
-        DEBUG_PRINT("%s", (pf)->key);
+    if (!nodeIni(pf, ret, key, key_length, phfwd)) {
+        arenaFree(&pf->nodes, ret, sizeof(Node));
+        return NULL;
+    }
 
-        if (pf->phfwd[0] != '\0')
-            DEBUG_PRINT("------>%s", (pf)->phfwd);
+    return ret;
+}
 
-        DEBUG_PRINT("\n");
+PhoneForward *phfwdNew(void) {
+    PhoneForward *ret = (PhoneForward *) malloc(sizeof(PhoneForward));
+    if (ret == NULL)
+        return NULL;
 
-        phfwdPrint((pf)->child, indent + 1);
-        phfwdPrint((pf)->next, indent);
-    } else
-        DEBUG_PRINT("NULL\n");
+    arenaIni(&ret->nodes);
+    arenaIni(&ret->bytes);
+    ret->cache = NULL;
+
+    // Korzeń ma pusty klucz i nie ma przekierowania
+    ret->root = nodeNew(ret, "", 0, NULL);
+    ret->targets = nodeNew(ret, "", 0, NULL);
+    if (ret->root == NULL || ret->targets == NULL) {
+        phfwdDelete(ret);
+        return NULL;
+    }
+
+    return ret;
 }
 
 void phfwdDelete(PhoneForward *pf) {
-    //rekurencyjnie usuwam drzewo PhoneForward
+    // Cała pamięć drzewa pochodzi z alokatorów bazy
     if (pf != NULL) {
-        phfwdDelete((pf)->next);
-        phfwdDelete((pf)->child);
-
-        free((void *) (pf)->key);
-        free((void *) (pf)->phfwd);
-        free((void *) (pf));
+        phfwdCacheEnable(pf, 0);
+        arenaRelease(&pf->nodes);
+        arenaRelease(&pf->bytes);
+        free((void *) pf);
     }
 }
 
-/**
- * Funkcja pomocnicza służąca do usuwania struktury PhoneForward.
- * @details Funkcja pomocnicza służąca do usuwania struktury PhoneForward. Rekurencyjnie usuwa drzewo.
- * @param pf Wskaźnik na wskaźnik usuwanego drzewa.
- */
-void phfwdDeleteUtil(PhoneForward **pf) {
-    //rekurencyjnie usuwam drzewo PhoneForward
-    if ((*pf) != NULL) {
-        phfwdDeleteUtil(&(*pf)->next);
-        (*pf)->next = NULL;
-        phfwdDeleteUtil(&(*pf)->child);
-        (*pf)->child = NULL;
-
-        free((void *) (*pf)->key);
-        (*pf)->key = NULL;
-        free((void *) (*pf)->phfwd);
-        (*pf)->phfwd = NULL;
-
-        (*pf)->key_length = 0;
-        free((void *) (*pf));
-        (*pf) = NULL;
+bool splitNode(PhoneForward *pf, Node *parent, size_t remaining_length) {
+    Node *child = nodeNew(pf, "", 0, NULL);
+    Node **table = arenaAlloc(&pf->bytes, childrenTableSize(false));
+
+    if (child == NULL || table == NULL ||
+        !stringAssignSlice(pf, &child->key, &parent->key, remaining_length,
+                           parent->key.length - remaining_length, NULL, 0) ||
+        !stringAssignSlice(pf, &parent->key, &parent->key, 0, remaining_length,
+                           NULL, 0)) {
+        nodeDelete(pf, child);
+        arenaFree(&pf->bytes, table, childrenTableSize(false));
+        return false;
     }
-}
 
+    /*-------dziecko przejmuje przekierowanie oraz dzieci ----*/
+    nodeMoveValue(child, parent);
 
-void phfwdRemove(struct PhoneForward *pf, char const *num) {
-    if (!isNumber(num))
-        return;
+    child->children = parent->children;
+    child->children_count = parent->children_count;
+    child->dense = parent->dense;
+    memcpy(child->child_keys, parent->child_keys, sizeof(parent->child_keys));
 
-    if (!pf)
-        return;
+    /*-------rodzic ma teraz jedno dziecko ----*/
+    parent->children = table;
+    parent->children[0] = child;
+    parent->child_keys[0] = nodeFirstChar(child);
+    parent->children_count = 1;
+    parent->dense = false;
 
-    PhoneForward *result;
-    size_t len_from_root = 0;
-    int temp = 0;
+    return true;
+}
 
-    result = phfwdFindPrefixMatch(pf, num, len_from_root, &temp);
 
-    if (result != NULL) {
-        free((void *) result->phfwd);
-        result->phfwd = malloc(sizeof(char));
-        result->phfwd[0] = '\0';
+Node *absorbChild(PhoneForward *pf, Node *node) {
+    Node *child = onlyChild(node);
 
-        free((void *) result->key);
-        result->key = malloc(sizeof(char));
-        result->key[0] = '\0';
+    if (!stringAssignSlice(pf, &node->key, &node->key, 0, node->key.length,
+                           &child->key, child->key.length))
+        return NULL;
 
-        result->key_length = 0;
+    nodeMoveValue(node, child);
 
-        phfwdDeleteUtil(&result->child);
-        result->child = NULL;
-    }
+    arenaFree(&pf->bytes, node->children, childrenTableSize(node->dense));
+    node->children = child->children;
+    node->children_count = child->children_count;
+    node->dense = child->dense;
+    memcpy(node->child_keys, child->child_keys, sizeof(child->child_keys));
+
+    child->children = NULL;
+    child->children_count = 0;
+    child->dense = false;
+    return child;
 }
 
 /**
- * Funkcja pomocnicza dla phfwdReverse.
- * @param[in] t             Przeszukiwana struktura
- * @param[in] num           Szukany numer
- * @param[in] result        Lista do której dodawne sa odpowiadające przekierowania
- * @param[in] forwarded     Numer stworzony przez klucze od korzenia do obecnego węzła
- * @param[in] num_len       Dlugośc napisu num
+ * Łączy węzeł z jego jedynym dzieckiem.
+ * @details Wywoływana po usunięciu dziecka, aby drzewo pozostało skompresowane:
+ * węzeł bez przekierowania, który ma tylko jedno dziecko, przejmuje jego klucz,
+ * przekierowanie i dzieci.
+ * @param[in] pf            Baza, do której należy węzeł
+ * @param[in, out] node     Węzeł, różny od korzenia
  */
-void phfwdReverseUtil(struct PhoneForward *t, char const *num, list **result,
-                      char *forwarded, size_t num_len) {
-    if (!t)
+static void mergeWithChild(PhoneForward *pf, Node *node) {
+    if (node->children_count != 1 || node->terminal)
         return;
 
-    if (num_len == 0)
-        num_len = strlen(num);
-
-    size_t phfwd_length = strlen(t->phfwd);
-    size_t k = lengthOfLongestCommonPrefix(num, num_len, t->phfwd, phfwd_length);
-
-    phfwdReverseUtil(t->next, num, result, forwarded, num_len);
-
-    if (k == 0) {
-        char *temp = concatenate(forwarded, t->key);
-        phfwdReverseUtil(t->child, num, result, temp, num_len);
-        free((void *) temp);
-    } else {
-        size_t phfwd_len = strlen(t->phfwd);
-        if (k == phfwd_len) {
-            char *temp = concatenate(forwarded, t->key);
-            char *temp1 = concatenate(temp, num + phfwd_length);
-            insertIntoSortedList((*result), temp1, strlen(temp1), result);
-            free((void *) temp1);
-            phfwdReverseUtil(t->child, num, result, temp, num_len);
-            free((void *) temp);
-        }
-    }
+    nodeDelete(pf, absorbChild(pf, node));
 }
 
 /**
- * Funkca pomocnicza kopiująca numery z listy do struktury PhoneNumbers.
- * @param[in]  to
- * @param[in]  from
+ * Szuka długości najdłuższego wspólngo prefiksu ciągów num1 i num2.
+ * @details Funkcja pomocnicza znajdująca długość najdłuższego wspólngo prefiksu ciągów num1 i num2.
+ * @param[in] num1      Pierwszy z porównywanych napisów
+ * @param[in] num1_len  Dlugość pierwszego ciągu znaków
+ * @param[in] num2      Drugi z porównywanych napisów
+ * @param[in] num2_len  Dlugość drugiego ciągu znaków
+ * @return Dlugość najduższego porównywanego napisu.
  */
-void copyListToPhnumStruct(PhoneNumbers *to, list *from) {
-    if ((from) == NULL) return;
-    list *current = from;
-    list *next;
+static inline size_t
+lengthOfLongestCommonPrefix(const char *num1, size_t num1_len, const char *num2,
+                            size_t num2_len) {
+    return numberCommonPrefix(num1, num2, num1_len < num2_len ? num1_len : num2_len);
+}
 
-    while (current != NULL) {
-        next = current->next;
-        addNumber(to, current->num);
-        current = next;
+Node *
+phfwdFindPrefixMatch(Node *t, const char *num, size_t num_length,
+                     size_t *depth_in_characters, Node **parent) {
+    size_t depth = 0;
+    Node *previous = NULL;
+
+    while (depth < num_length) {
+        Node *child = findChild(t, num[depth]);
+        if (child == NULL)
+            break;
+
+        size_t common_prefix_len = keyCommonPrefix(&child->key, num + depth,
+                                                   num_length - depth);
+        //szukamy glebiej tylko jezeli caly klucz dziecka jest zgodny
+        if (common_prefix_len < child->key.length)
+            break;
+
+        DEBUG_PRINT("phfwdFindPrefix: Wezel o kluczu %.*s\n",
+                    (int) common_prefix_len, num + depth);
+        depth += common_prefix_len;
+        previous = t;
+        t = child;
     }
-}
 
-struct PhoneNumbers const *phfwdReverse(struct PhoneForward *pf, char const *num) {
-    PhoneNumbers *result;
-    result = malloc(sizeof(PhoneNumbers));
-    phNumIni(&result);
+    *depth_in_characters = depth;
+    if (parent != NULL)
+        *parent = previous;
 
+    return t;
+}
 
-    if (!isNumber(num))
-        return result;
+/**
+ * Znajduje węzeł, którego ścieżka od korzenia jest równa @p key, w razie
+ * potrzeby tworząc go lub dzieląc istniejący węzeł. Nowy węzeł nie ma wartości.
+ * @param[in] pf            Baza, do której należy drzewo
+ * @param[in] root          Korzeń drzewa
+ * @param[in] key           Ścieżka szukanego węzła
+ * @param[in] key_length    Długość ścieżki
+ * @return Wskaźnik na węzeł lub NULL, gdy nie udało się zaalokować pamięci.
+ */
+static Node *insertPath(PhoneForward *pf, Node *root, char const *key,
+                        size_t key_length) {
+    //Najpierw szukam najgłębszego dopasowania w drzewie
+    size_t depth_in_characters = 0;
+    Node *temp = phfwdFindPrefixMatch(root, key, key_length, &depth_in_characters,
+                                      NULL);
 
-    list *temp;
-    temp = NULL;
-    size_t num_len = strlen(num);
+    key += depth_in_characters;
+    key_length -= depth_in_characters;
 
-    insertIntoSortedList(temp, num, strlen(num), &temp);
-    char *forwarded;
-    forwarded = malloc(sizeof(char));
-    forwarded[0] = '\0';
-    phfwdReverseUtil(pf, num, &temp, forwarded, num_len);
+    if (key_length == 0)
+        return temp;
 
-    free((void *) forwarded);
+    Node *child = findChild(temp, key[0]);
+    if (child != NULL) {
+        // Dziecko pasuje tylko częściowo, więc trzeba je podzielić
+        size_t common_prefix_len = keyCommonPrefix(&child->key, key, key_length);
+        DEBUG_PRINT("Dziele wezel o kluczu dlugosci %zu po %zu znakach\n",
+                    child->key.length, common_prefix_len);
+        if (!splitNode(pf, child, common_prefix_len))
+            return NULL;
+
+        temp = child;
+        key += common_prefix_len;
+        key_length -= common_prefix_len;
+
+        if (key_length == 0)
+            return temp;
+    }
 
-    copyListToPhnumStruct(result, temp);
+    DEBUG_PRINT("Tworze wezel %.*s\n", (int) key_length, key);
+    Node *ret = nodeNew(pf, key, key_length, NULL);
+    if (ret == NULL || !insertChild(pf, temp, ret)) {
+        nodeDelete(pf, ret);
+        // Cofam ewentualny podział, aby drzewo pozostało skompresowane
+        if (temp != root)
+            mergeWithChild(pf, temp);
+        return NULL;
+    }
+
+    return ret;
+}
+
+/**
+ * Usuwa z drzewa węzeł o ścieżce @p key, jeżeli nie ma on wartości i jest
+ * zbędny, czyli nie ma dzieci lub ma dokładnie jedno, z którym zostaje scalony.
+ * @param[in] pf            Baza, do której należy drzewo
+ * @param[in] root          Korzeń drzewa
+ * @param[in] key           Ścieżka węzła
+ * @param[in] key_length    Długość ścieżki
+ */
+static void prunePath(PhoneForward *pf, Node *root, char const *key,
+                      size_t key_length) {
+    size_t depth = 0;
+    Node *parent = NULL;
+    Node *node = phfwdFindPrefixMatch(root, key, key_length, &depth, &parent);
+
+    if (depth != key_length || node == root || node->terminal)
+        return;
+
+    if (node->children_count == 0) {
+        removeChild(pf, parent, nodeFirstChar(node));
+        nodeDelete(pf, node);
+
+        if (parent != root)
+            mergeWithChild(pf, parent);
+    } else
+        mergeWithChild(pf, node);
+}
+
+/**
+ * Usuwa z węzła indeksu odwrotnego puste drzewo numerów źródłowych,
+ * a następnie sam węzeł, jeżeli stał się zbędny.
+ * @param[in] pf                Baza
+ * @param[in, out] node         Węzeł indeksu odwrotnego o ścieżce @p target
+ * @param[in] target            Numer, na który przekierowano
+ * @param[in] target_length     Długość numeru
+ */
+static void reverseIndexPrune(PhoneForward *pf, Node *node, char const *target,
+                              size_t target_length) {
+    if (node->sources->children_count > 0)
+        return;
+
+    nodeDelete(pf, node->sources);
+    stringIni(&node->phfwd);
+    node->terminal = false;
+
+    prunePath(pf, pf->targets, target, target_length);
+}
+
+/**
+ * Zapisuje w indeksie odwrotnym, że numer @p source jest przekierowany na @p target.
+ * @param[in] pf                Baza
+ * @param[in] target            Numer, na który przekierowano
+ * @param[in] target_length     Długość numeru @p target
+ * @param[in] source            Przekierowany numer
+ * @param[in] source_length     Długość numeru @p source
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool reverseIndexAdd(PhoneForward *pf, char const *target,
+                            size_t target_length, char const *source,
+                            size_t source_length) {
+    Node *node = insertPath(pf, pf->targets, target, target_length);
+    if (node == NULL)
+        return false;
+
+    if (!node->terminal) {
+        node->sources = nodeNew(pf, "", 0, NULL);
+        if (node->sources == NULL) {
+            stringIni(&node->phfwd);
+            prunePath(pf, pf->targets, target, target_length);
+            return false;
+        }
+        node->terminal = true;
+    }
+
+    Node *entry = insertPath(pf, node->sources, source, source_length);
+    if (entry == NULL) {
+        reverseIndexPrune(pf, node, target, target_length);
+        return false;
+    }
+
+    entry->terminal = true;
+    return true;
+}
+
+/**
+ * Usuwa z indeksu odwrotnego informację, że numer @p source jest przekierowany
+ * na @p target. Nic nie robi, jeżeli jej tam nie ma.
+ * @param[in] pf                Baza
+ * @param[in] target            Numer, na który przekierowano
+ * @param[in] target_length     Długość numeru @p target
+ * @param[in] source            Przekierowany numer
+ * @param[in] source_length     Długość numeru @p source
+ */
+static void reverseIndexRemove(PhoneForward *pf, char const *target,
+                               size_t target_length, char const *source,
+                               size_t source_length) {
+    size_t depth = 0;
+    Node *node = phfwdFindPrefixMatch(pf->targets, target, target_length, &depth,
+                                      NULL);
+    if (depth != target_length || !node->terminal)
+        return;
+
+    Node *entry = phfwdFindPrefixMatch(node->sources, source, source_length, &depth,
+                                       NULL);
+    if (depth != source_length || !entry->terminal)
+        return;
+
+    entry->terminal = false;
+    prunePath(pf, node->sources, source, source_length);
+    reverseIndexPrune(pf, node, target, target_length);
+}
+
+/**
+ * Dodaje przekierowanie num2 dla numeru num1, zaczynając poszukiwanie miejsca od korzenia pf.
+ * @param[in] pf        Przeszukiwana struktura
+ * @param[in] num1      Przekierowywany numer
+ * @param[in] num2      Przekierowanie
+ * @param[in] num1_len Dlugosc przekierowanego numeru
+ * @param[in] local     Bufor o rozmiarze UNPACK_BUFFER_SIZE
+ * @param[out] replaced Nadpisane przekierowanie zakończone '\0', zapisane
+ *                      w @p local lub w pamięci, którą należy zwolnić;
+ *                      bez zmian, jeżeli nic nie nadpisano
+ * @return          Wskaźnik na węzeł z dodanym przekierowaniem, lub NULL jeżeli z jakiegoś powodu to się nie udało.
+ */
+static Node *
+phfwdAddUtil(PhoneForward *pf, char const *num1, char const *num2, size_t num1_len,
+             char *local, char **replaced) {
+    Node *temp = insertPath(pf, pf->root, num1, num1_len);
+    if (temp == NULL)
+        return NULL;
+
+    size_t num2_len = strlen(num2);
+    if (temp->terminal && stringEquals(&temp->phfwd, num2, num2_len))
+        return temp;
+
+    // Nowe przekierowanie przygotowuję obok, aby błąd nie zniszczył starego
+    ShortString phfwd;
+    stringIni(&phfwd);
+    if (!stringAssign(pf, &phfwd, num2, num2_len)) {
+        prunePath(pf, pf->root, num1, num1_len);
+        return NULL;
+    }
+
+    // Stare przekierowanie rozpakowuję, zanim zostanie zwolnione
+    if (temp->terminal) {
+        size_t length = temp->phfwd.length;
+        char *old = length < UNPACK_BUFFER_SIZE ? local : malloc(length + 1);
+        if (old == NULL) {
+            stringClear(pf, &phfwd);
+            return NULL;
+        }
+
+        stringUnpack(&temp->phfwd, old);
+        old[length] = '\0';
+        *replaced = old;
+    }
+
+    stringClear(pf, &temp->phfwd);
+    stringMove(&temp->phfwd, &phfwd);
+    temp->terminal = true;
+
+    DEBUG_PRINT("Ustawiam przekierowanie w wezle o kluczu %s ---> %s\n",
+                num1, num2);
+
+    return temp;
+}
+
+
+bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2) {
+    if (!isNumber(num2) || !isNumber(num1) || !pf || strcmp(num1, num2) == 0) {
+        return false;
+    }
+    DEBUG_PRINT("dodaje numer %s \n", num1);
+
+    size_t num1_len = strlen(num1);
+    size_t num2_len = strlen(num2);
+    if (!reverseIndexAdd(pf, num2, num2_len, num1, num1_len))
+        return false;
+
+    char local[UNPACK_BUFFER_SIZE];
+    char *replaced = NULL;
+    Node *ret = phfwdAddUtil(pf, num1, num2, num1_len, local, &replaced);
+
+    // phfwdAddUtil nie zawodzi, gdy przekierowanie już istniało
+    if (ret == NULL)
+        reverseIndexRemove(pf, num2, num2_len, num1, num1_len);
+
+    if (replaced != NULL) {
+        reverseIndexRemove(pf, replaced, strlen(replaced), num1, num1_len);
+        if (replaced != local)
+            free((void *) replaced);
+    }
+
+    if (ret != NULL && pf->cache != NULL)
+        getCacheInvalidate(pf->cache, num1, num1_len);
+
+    DEBUG_PRINT("\n\n");
+    return ret != NULL;
+}
+
+/**
+ * Zapisuje do ośmiu pierwszych znaków numeru w jednej liczbie, tak by
+ * porównanie liczb dawało ten sam wynik co strcmp, o ile liczby są różne.
+ * Dzięki temu sortowanie par rzadko sięga do rozrzuconych w pamięci napisów.
+ * @param[in] num       Numer
+ * @param[in] length    Długość numeru
+ * @return Początek numeru; brakujące znaki są zerami.
+ */
+static uint64_t numberHead(char const *num, size_t length) {
+    uint64_t head = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++)
+        head = (head << 8) | (i < length ? (unsigned char) num[i] : 0);
+
+    return head;
+}
+
+/**
+ * Porównuje num1 dwóch par.
+ * @param x Pierwsza para
+ * @param y Druga para
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp.
+ */
+static int compareBulkNum1(BulkPair const *x, BulkPair const *y) {
+    if (x->num1_head != y->num1_head)
+        return x->num1_head < y->num1_head ? -1 : 1;
+
+    return strcmp(x->num1, y->num1);
+}
+
+/**
+ * Porównuje dwie pary według num1, a przy równych num1 według pozycji
+ * w tablicach wejściowych, na potrzeby qsort.
+ * @param a Wskaźnik na pierwszą parę
+ * @param b Wskaźnik na drugą parę
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp.
+ */
+static int compareBulkSources(void const *a, void const *b) {
+    BulkPair const *x = a;
+    BulkPair const *y = b;
+    int cmp = compareBulkNum1(x, y);
+    if (cmp != 0)
+        return cmp;
+
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/**
+ * Porównuje dwie pary według num2, a przy równych num2 według num1,
+ * na potrzeby qsort.
+ * @param a Wskaźnik na pierwszą parę
+ * @param b Wskaźnik na drugą parę
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp.
+ */
+static int compareBulkTargets(void const *a, void const *b) {
+    BulkPair const *x = a;
+    BulkPair const *y = b;
+    if (x->num2_head != y->num2_head)
+        return x->num2_head < y->num2_head ? -1 : 1;
+
+    int cmp = strcmp(x->num2, y->num2);
+    if (cmp != 0)
+        return cmp;
+
+    return compareBulkNum1(x, y);
+}
+
+/**
+ * Buduje drzewo z posortowanych, parami różnych kluczy w jednym przebiegu.
+ * @details Na stosie leży ścieżka od korzenia do węzła ostatnio dodanego klucza.
+ * Kolejny klucz ma z poprzednim wspólny prefiks długości lcp, więc zdejmuję
+ * węzły kończące się głębiej niż lcp, a ostatni zdjęty węzeł dzielę, gdy
+ * prefiks kończy się w środku jego klucza. Nowy węzeł jest zawsze ostatnim
+ * dzieckiem swojego rodzica, więc łączny czas jest liniowy względem sumy
+ * długości kluczy.
+ * @param[in] pf        Baza, do której należą węzły
+ * @param[in] root      Korzeń budowanego drzewa, bez dzieci
+ * @param[in] pairs     Pary posortowane zgodnie z rodzajem drzewa
+ * @param[in] count     Liczba par
+ * @param[in] tree      Rodzaj drzewa
+ * @param[in] stack     Stos na ścieżkę
+ * @param[in] inner     Stos na ścieżki drzew numerów źródłowych, używany dla
+ *                      BULK_TARGETS
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool buildSorted(PhoneForward *pf, Node *root, BulkPair const *pairs,
+                        size_t count, BulkTree tree, NodeStack *stack,
+                        NodeStack *inner) {
+    stack->size = 0;
+    if (!stackPush(stack, root, 0))
+        return false;
+
+    char const *previous = "";
+    size_t previous_length = 0;
+    size_t i = 0;
+    while (i < count) {
+        bool by_target = tree == BULK_TARGETS;
+        char const *key = by_target ? pairs[i].num2 : pairs[i].num1;
+        size_t length = by_target ? pairs[i].num2_length : pairs[i].num1_length;
+
+        // W indeksie odwrotnym jeden węzeł obejmuje wszystkie pary o tym samym celu
+        size_t group = 1;
+        while (by_target && i + group < count &&
+               pairs[i + group].num2_length == length &&
+               memcmp(pairs[i + group].num2, key, length) == 0)
+            group++;
+
+        size_t common = lengthOfLongestCommonPrefix(key, length, previous,
+                                                    previous_length);
+        Node *last = NULL;
+        NodeFrame top = stack->frames[stack->size - 1];
+        while (top.depth + top.node->key.length > common) {
+            last = stackPop(stack).node;
+            top = stack->frames[stack->size - 1];
+        }
+
+        size_t end = top.depth + top.node->key.length;
+        if (end < common) {
+            if (!splitNode(pf, last, common - end) ||
+                !stackPush(stack, last, end))
+                return false;
+
+            top = stack->frames[stack->size - 1];
+        }
+
+        Node *node = nodeNew(pf, key + common, length - common, NULL);
+        if (node == NULL)
+            return false;
+        if (!insertChild(pf, top.node, node)) {
+            nodeDelete(pf, node);
+            return false;
+        }
+
+        if (tree == BULK_FORWARDS) {
+            if (!stringAssign(pf, &node->phfwd, pairs[i].num2,
+                              pairs[i].num2_length))
+                return false;
+        } else if (by_target) {
+            node->sources = nodeNew(pf, "", 0, NULL);
+            if (node->sources == NULL ||
+                !buildSorted(pf, node->sources, pairs + i, group, BULK_SOURCES,
+                             inner, NULL))
+                return false;
+        }
+
+        node->terminal = true;
+        if (!stackPush(stack, node, common))
+            return false;
+
+        previous = key;
+        previous_length = length;
+        i += group;
+    }
+
+    return true;
+}
+
+/**
+ * Buduje drzewo przekierowań i indeks odwrotny bazy z par o parami różnych
+ * num1, które obejmują wszystkie przekierowania bazy. Drzewa powstają
+ * w osobnej bazie, którą baza przejmuje dopiero po udanej budowie, więc przy
+ * braku pamięci baza się nie zmienia.
+ * @param[in] pf    Baza
+ * @param[in] pairs Pary posortowane według num1; funkcja zmienia ich kolejność
+ * @param[in] count Liczba par
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool bulkBuild(PhoneForward *pf, BulkPair *pairs, size_t count) {
+    PhoneForward *fresh = phfwdNew();
+    NodeStack stack;
+    NodeStack inner;
+    stackIni(&stack);
+    stackIni(&inner);
+
+    bool success = fresh != NULL &&
+                   buildSorted(fresh, fresh->root, pairs, count, BULK_FORWARDS,
+                               &stack, NULL);
+    if (success) {
+        qsort((void *) pairs, count, sizeof(BulkPair), compareBulkTargets);
+        success = buildSorted(fresh, fresh->targets, pairs, count, BULK_TARGETS,
+                              &stack, &inner);
+    }
+
+    stackFree(&stack);
+    stackFree(&inner);
+    if (!success) {
+        phfwdDelete(fresh);
+        return false;
+    }
+
+    // Nowe drzewa zawierają wszystkie przekierowania, więc zastępuję nimi
+    // wszystkie węzły bazy
+    arenaRelease(&pf->nodes);
+    arenaRelease(&pf->bytes);
+    pf->root = fresh->root;
+    pf->targets = fresh->targets;
+    pf->nodes = fresh->nodes;
+    pf->bytes = fresh->bytes;
+    free((void *) fresh);
+
+    return true;
+}
+
+/**
+ * Zbiera przekierowania bazy w jednym przejściu drzewa, w porządku rosnącym
+ * num1. Numery zapisywane są kolejno w jednym buforze, każdy zakończony '\0',
+ * num1 przed num2; wskaźniki par ustawiane są dopiero na końcu, gdy bufor
+ * przestaje się przesuwać.
+ * @param[in] pf        Baza
+ * @param[out] pairs    Tablica par, którą należy zwolnić
+ * @param[out] count    Liczba par
+ * @param[out] chars    Bufor ze znakami numerów, który należy zwolnić
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool collectRules(PhoneForward const *pf, BulkPair **pairs, size_t *count,
+                         char **chars) {
+    NodeStack stack;
+    stackIni(&stack);
+    char *path = NULL;
+    size_t path_capacity = 0;
+    size_t pairs_capacity = 0;
+    size_t chars_size = 0;
+    size_t chars_capacity = 0;
+    *pairs = NULL;
+    *count = 0;
+    *chars = NULL;
+
+    // Dzieci zdejmowane są w porządku leksykograficznym, a węzeł przed swoim
+    // poddrzewem, więc klucze pojawiają się posortowane tak jak przez strcmp
+    bool success = stackPushChildren(&stack, pf->root, 0);
+    while (success && stack.size > 0) {
+        NodeFrame frame = stackPop(&stack);
+        Node *t = frame.node;
+        size_t length = frame.depth + t->key.length;
+        success = reservePath(&path, &path_capacity, length);
+        if (!success)
+            break;
+
+        stringUnpack(&t->key, path + frame.depth);
+
+        if (t->terminal) {
+            size_t size = length + t->phfwd.length + 2;
+            if (*count == pairs_capacity) {
+                pairs_capacity = pairs_capacity > 0 ? 2 * pairs_capacity
+                                                    : INITIAL_STACK_CAPACITY;
+                BulkPair *new_pairs = realloc(*pairs,
+                                              pairs_capacity * sizeof(BulkPair));
+                success = new_pairs != NULL;
+                if (success)
+                    *pairs = new_pairs;
+            }
+
+            success = success &&
+                      reservePath(chars, &chars_capacity, chars_size + size);
+            if (!success)
+                break;
+
+            char *num1 = *chars + chars_size;
+            char *num2 = num1 + length + 1;
+            memcpy(num1, path, length);
+            num1[length] = '\0';
+            stringUnpack(&t->phfwd, num2);
+            num2[t->phfwd.length] = '\0';
+            chars_size += size;
+
+            BulkPair *pair = &(*pairs)[(*count)++];
+            pair->num1_length = length;
+            pair->num2_length = t->phfwd.length;
+            pair->index = 0;
+            pair->num1_head = numberHead(num1, length);
+            pair->num2_head = numberHead(num2, t->phfwd.length);
+        }
+
+        success = stackPushChildren(&stack, t, length);
+    }
+
+    free((void *) path);
+    stackFree(&stack);
+
+    char const *num = *chars;
+    for (size_t i = 0; success && i < *count; i++) {
+        (*pairs)[i].num1 = num;
+        num += (*pairs)[i].num1_length + 1;
+        (*pairs)[i].num2 = num;
+        num += (*pairs)[i].num2_length + 1;
+    }
+
+    return success;
+}
+
+/**
+ * Scala dwie tablice par posortowanych według parami różnych num1.
+ * Przy równych num1 zostaje para z @p added.
+ * @param[in] old           Dotychczasowe przekierowania bazy
+ * @param[in] old_count     Liczba dotychczasowych przekierowań
+ * @param[in] added         Dodawane pary
+ * @param[in] added_count   Liczba dodawanych par
+ * @param[out] merged       Tablica na co najmniej @p old_count + @p added_count par
+ * @return Liczba scalonych par.
+ */
+static size_t mergeRules(BulkPair const *old, size_t old_count,
+                         BulkPair const *added, size_t added_count,
+                         BulkPair *merged) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+    while (i < old_count || j < added_count) {
+        int cmp = i == old_count ? 1 : j == added_count ? -1
+                                                        : compareBulkNum1(&old[i], &added[j]);
+        if (cmp < 0)
+            merged[count++] = old[i++];
+        else {
+            // Nowa para zastępuje dotychczasowe przekierowanie tego samego num1
+            i += cmp == 0;
+            merged[count++] = added[j++];
+        }
+    }
+
+    return count;
+}
+
+bool phfwdAddBulk(struct PhoneForward *pf, char const *const *nums1,
+                  char const *const *nums2, size_t count) {
+    if (pf == NULL || ((nums1 == NULL || nums2 == NULL) && count > 0))
+        return false;
+
+    BulkPair *pairs = malloc((count > 0 ? count : 1) * sizeof(BulkPair));
+    if (pairs == NULL)
+        return false;
+
+    // Najpierw sprawdzam wszystkie pary, by niepoprawna nie zostawiła
+    // bazy zmienionej w połowie
+    for (size_t i = 0; i < count; i++) {
+        if (!isNumber(nums1[i]) || !isNumber(nums2[i]) ||
+            strcmp(nums1[i], nums2[i]) == 0) {
+            free((void *) pairs);
+            return false;
+        }
+
+        pairs[i].num1 = nums1[i];
+        pairs[i].num1_length = strlen(nums1[i]);
+        pairs[i].num2 = nums2[i];
+        pairs[i].num2_length = strlen(nums2[i]);
+        pairs[i].index = i;
+        pairs[i].num1_head = numberHead(nums1[i], pairs[i].num1_length);
+        pairs[i].num2_head = numberHead(nums2[i], pairs[i].num2_length);
+    }
+
+    qsort((void *) pairs, count, sizeof(BulkPair), compareBulkSources);
+
+    // Z par o tym samym num1 zostaje ostatnia, tak jak przy kolejnych phfwdAdd
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i + 1 < count && compareBulkNum1(&pairs[i], &pairs[i + 1]) == 0)
+            continue;
+
+        pairs[unique++] = pairs[i];
+    }
+
+    DEBUG_PRINT("dodaje %zu przekierowan naraz\n", unique);
+
+    // Dotychczasowe przekierowania scalam z nowymi i buduję całą bazę od nowa,
+    // więc czas jest liniowy względem sumy długości wszystkich numerów
+    BulkPair *existing = NULL;
+    size_t existing_count = 0;
+    char *chars = NULL;
+    BulkPair *merged = NULL;
+    BulkPair *all = pairs;
+    size_t all_count = unique;
+    bool success = unique == 0 ||
+                   collectRules(pf, &existing, &existing_count, &chars);
+
+    if (success && unique > 0 && existing_count > 0) {
+        merged = malloc((existing_count + unique) * sizeof(BulkPair));
+        success = merged != NULL;
+        if (success) {
+            all_count = mergeRules(existing, existing_count, pairs, unique, merged);
+            all = merged;
+        }
+    }
+
+    if (success && unique > 0)
+        success = bulkBuild(pf, all, all_count);
+
+    for (size_t i = 0; success && pf->cache != NULL && i < unique; i++)
+        getCacheInvalidate(pf->cache, pairs[i].num1, pairs[i].num1_length);
+
+    free((void *) merged);
+    free((void *) existing);
+    free((void *) chars);
+    free((void *) pairs);
+    return success;
+}
+
+/**
+ * Funkcja pomocnicza, znajdująca najdłuższy prefiks napisu num, dla którego
+ * zdefiniowano przekierowanie.
+ * @param[in] t                 Przeszukiwane drzewo
+ * @param[in] num               Wzór szukanego napisu
+ * @param[out] len_from_root    Dlugośc napisu od korzenia do znalezionego węzła
+ * @param[in]  num_length       Dlugosc wzoru
+ * @return wskaźnik na węzeł zawierający odpowiadający klucz, lub NULL, jeżeli taki nie istnieje
+ */
+static Node *
+phfwdFindExactMatch(Node *t, char const *num, size_t *len_from_root,
+                    size_t num_length) {
+    Node *best = NULL;
+    size_t depth = 0;
+
+    while (depth < num_length) {
+        Node *child = findChild(t, num[depth]);
+        if (child == NULL)
+            break;
+
+        size_t common_prefix_len = keyCommonPrefix(&child->key, num + depth,
+                                                   num_length - depth);
+        if (common_prefix_len < child->key.length)
+            break;
+
+        depth += common_prefix_len;
+        t = child;
+
+        // Zapamiętuję węzeł jako najlepsze dotychczasowe trafienie
+        if (t->phfwd.length > 0) {
+            best = t;
+            *len_from_root = depth;
+        }
+    }
+
+    return best;
+}
+
+
+PhoneNumbers const *phfwdGet(struct PhoneForward *pf, char const *num) {
+    if (num == NULL || !isNumber(num) || pf == NULL)
+        return phnumNew(0, 0);
+
+    // Zwykle wynik mieści się w buforze na stosie, a w p.p. wyznaczam go
+    // ponownie, już bezpośrednio do struktury
+    char buffer[GET_BUFFER_SIZE];
+    size_t length = phfwdGetInto(pf, num, buffer, sizeof(buffer));
+    PhoneNumbers *result = phnumNew(1, length + 1);
+    if (result == NULL)
+        return NULL;
+
+    if (length < sizeof(buffer)) {
+        phnumAppend(result, buffer, length, "", 0);
+    } else {
+        phfwdGetInto(pf, num, result->chars, length + 1);
+        result->offsets[result->numbers_count++] = 0;
+        result->chars_size = length + 1;
+    }
+
+    return result;
+}
+
+/**
+ * Wyznacza przekierowanie numeru w drzewie o podanym korzeniu, bez pamięci
+ * podręcznej. Wynik zapisuje do bufora tylko wtedy, gdy się w nim mieści.
+ * @param[in] root          Korzeń drzewa przekierowań
+ * @param[in] num           Numer
+ * @param[in] num_length    Długość numeru
+ * @param[out] buf          Bufor na wynik zakończony '\0'
+ * @param[in] cap           Rozmiar bufora
+ * @return Długość wyniku.
+ */
+static size_t treeGetInto(Node *root, char const *num, size_t num_length,
+                          char *buf, size_t cap) {
+    /* szukam najdluzszego pasujacego prefixu przekierowania */
+    size_t matched = 0;
+    Node *tmp = phfwdFindExactMatch(root, num, &matched, num_length);
+
+    size_t prefix_length = tmp != NULL ? tmp->phfwd.length : 0;
+    if (tmp == NULL)
+        matched = 0;
+
+    // Przekierowanie rozpakowuję dopiero do bufora na wynik
+    size_t length = prefix_length + num_length - matched;
+    if (length < cap) {
+        if (tmp != NULL)
+            stringUnpack(&tmp->phfwd, buf);
+        memcpy(buf + prefix_length, num + matched, num_length - matched);
+        buf[length] = '\0';
+    }
+
+    return length;
+}
+
+PhoneNumbers *treeGet(Node *root, char const *num) {
+    if (root == NULL || !isNumber(num))
+        return phnumNew(0, 0);
+
+    size_t num_length = strlen(num);
+    char buffer[GET_BUFFER_SIZE];
+    size_t length = treeGetInto(root, num, num_length, buffer, sizeof(buffer));
+    PhoneNumbers *result = phnumNew(1, length + 1);
+    if (result == NULL)
+        return NULL;
+
+    if (length < sizeof(buffer)) {
+        phnumAppend(result, buffer, length, "", 0);
+    } else {
+        treeGetInto(root, num, num_length, result->chars, length + 1);
+        result->offsets[result->numbers_count++] = 0;
+        result->chars_size = length + 1;
+    }
+
+    return result;
+}
+
+size_t phfwdGetInto(struct PhoneForward const *pf, char const *num, char *buf,
+                    size_t cap) {
+    if (num == NULL || pf == NULL || !isNumber(num)) {
+        if (cap > 0)
+            buf[0] = '\0';
+        return 0;
+    }
+
+    size_t num_length = strlen(num);
+    size_t length;
+    if (pf->cache != NULL &&
+        getCacheLookup(pf->cache, num, num_length, buf, cap, &length))
+        return length;
+
+    // Zapamiętuję tylko wyniki, które zmieściły się w buforze
+    length = treeGetInto(pf->root, num, num_length, buf, cap);
+    if (length < cap && pf->cache != NULL)
+        getCacheInsert(pf->cache, num, num_length, buf, length, "", 0);
+
+    return length;
+}
+
+bool phfwdCacheEnable(struct PhoneForward *pf, size_t capacity) {
+    if (pf == NULL)
+        return false;
+
+    if (pf->cache != NULL) {
+        getCacheFree(pf->cache);
+        free((void *) pf->cache);
+        pf->cache = NULL;
+    }
+
+    if (capacity == 0)
+        return true;
+
+    GetCache *cache = malloc(sizeof(GetCache));
+    if (cache == NULL)
+        return false;
+
+    if (!getCacheIni(cache, capacity)) {
+        free((void *) cache);
+        return false;
+    }
+
+    pf->cache = cache;
+    return true;
+}
+
+bool phfwdCacheStats(struct PhoneForward const *pf,
+                     struct PhoneForwardCacheStats *stats) {
+    if (pf == NULL || pf->cache == NULL)
+        return false;
+
+    getCacheStats(pf->cache, stats);
+    return true;
+}
+
+/**
+ * Pamięć zajmowana przez napis poza węzłem.
+ * @param[in] s Napis
+ * @return Rozmiar w bajtach, 0 dla napisu zapisanego w węźle.
+ */
+static inline size_t stringHeapBytes(ShortString const *s) {
+    return s->length > INLINE_STRING_CAPACITY ? packedSize(s->length) : 0;
+}
+
+/**
+ * Pamięć węzła razem z jego tablicą dzieci i kluczem.
+ * @param[in] node Węzeł
+ * @return Rozmiar w bajtach, bez przekierowania węzła.
+ */
+static inline size_t nodeBytes(Node const *node) {
+    size_t size = sizeof(Node) + stringHeapBytes(&node->key);
+    if (node->children != NULL)
+        size += childrenTableSize(node->dense);
+
+    return size;
+}
+
+/**
+ * Dolicza do statystyk drzewo przekierowań.
+ * @param[in] pf        Baza
+ * @param[in, out] stack Pusty stos
+ * @param[in, out] stats Statystyki
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool statsForwards(PhoneForward const *pf, NodeStack *stack,
+                          struct PhoneForwardStats *stats) {
+    // Głębokość w ramce stosu to tu liczba węzłów na ścieżce, a nie znaków
+    bool success = stackPush(stack, pf->root, 0);
+
+    while (success && stack->size > 0) {
+        NodeFrame frame = stackPop(stack);
+        Node const *node = frame.node;
+
+        stats->nodes++;
+        stats->node_bytes += sizeof(Node);
+        if (node->children != NULL)
+            stats->node_bytes += childrenTableSize(node->dense);
+        stats->key_bytes += stringHeapBytes(&node->key);
+        stats->children[node->children_count]++;
+        if (frame.depth > stats->max_depth)
+            stats->max_depth = frame.depth;
+
+        if (node->terminal) {
+            stats->rules++;
+            stats->depth_sum += frame.depth;
+            stats->target_bytes += stringHeapBytes(&node->phfwd);
+        }
+
+        success = stackPushChildren(stack, node, frame.depth + 1);
+    }
+
+    return success;
+}
+
+/**
+ * Dolicza do statystyk indeks odwrotny: drzewo numerów, na które
+ * przekierowano, i drzewa przekierowanych numerów w jego węzłach.
+ * @param[in] pf        Baza
+ * @param[in, out] stack Pusty stos na drzewo numerów, na które przekierowano
+ * @param[in, out] inner Pusty stos na drzewa przekierowanych numerów
+ * @param[in, out] stats Statystyki
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool statsReverse(PhoneForward const *pf, NodeStack *stack,
+                         NodeStack *inner, struct PhoneForwardStats *stats) {
+    bool success = stackPush(stack, pf->targets, 0);
+
+    while (success && stack->size > 0) {
+        Node const *node = stackPop(stack).node;
+        stats->reverse_nodes++;
+        stats->reverse_bytes += nodeBytes(node);
+
+        if (node->terminal) {
+            success = stackPush(inner, node->sources, 0);
+            while (success && inner->size > 0) {
+                Node const *source = stackPop(inner).node;
+                stats->reverse_nodes++;
+                stats->reverse_bytes += nodeBytes(source);
+                success = stackPushChildren(inner, source, 0);
+            }
+        }
+
+        success = success && stackPushChildren(stack, node, 0);
+    }
+
+    return success;
+}
+
+bool phfwdStats(struct PhoneForward const *pf, struct PhoneForwardStats *stats) {
+    if (pf == NULL || stats == NULL)
+        return false;
+
+    memset(stats, 0, sizeof(struct PhoneForwardStats));
+    stats->reserved_bytes = arenaReserved(&pf->nodes) + arenaReserved(&pf->bytes);
+
+    NodeStack stack, inner;
+    stackIni(&stack);
+    stackIni(&inner);
+
+    bool success = statsForwards(pf, &stack, stats);
+    stack.size = 0;
+    success = success && statsReverse(pf, &stack, &inner, stats);
+
+    stackFree(&inner);
+    stackFree(&stack);
+    return success;
+}
+
+/**
+ * Porównuje dwa zapytania wsadowe na potrzeby qsort.
+ * @param a Wskaźnik na pierwsze zapytanie
+ * @param b Wskaźnik na drugie zapytanie
+ * @return Wynik strcmp dla numerów zapytań.
+ */
+static int compareQueries(void const *a, void const *b) {
+    return strcmp(((BatchQuery const *) a)->num, ((BatchQuery const *) b)->num);
+}
+
+struct PhoneNumbers const *phfwdGetBatch(struct PhoneForward const *pf,
+                                         char const *const *nums, size_t count,
+                                         bool sorted) {
+    if (pf == NULL || (nums == NULL && count > 0))
+        return NULL;
+
+    BatchQuery *queries = malloc((count > 0 ? count : 1) * sizeof(BatchQuery));
+    if (queries == NULL)
+        return NULL;
+
+    // Niepoprawne numery pomijam, odpowiadają im puste napisy
+    size_t valid = 0;
+    size_t max_length = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (isNumber(nums[i])) {
+            queries[valid].num = nums[i];
+            queries[valid].length = strlen(nums[i]);
+            queries[valid].index = i;
+            if (queries[valid].length > max_length)
+                max_length = queries[valid].length;
+            valid++;
+        }
+    }
+
+    if (!sorted)
+        qsort((void *) queries, valid, sizeof(BatchQuery), compareQueries);
+
+    // Każdy węzeł na ścieżce ma niepusty klucz, więc ścieżka ma co najwyżej
+    // max_length + 1 węzłów
+    DescentFrame *stack = malloc((max_length + 1) * sizeof(DescentFrame));
+    size_t *offsets = malloc((count > 0 ? count : 1) * sizeof(size_t));
+    NumberBuffer chars;
+    numberBufferIni(&chars);
+    char *target = NULL;
+    size_t target_capacity = 0;
+    bool success = stack != NULL && offsets != NULL &&
+                   numberBufferAppend(&chars, "", 0, "", 0);
+
+    // Pod przesunięciem 0 jest pusty napis dla niepoprawnych numerów
+    for (size_t i = 0; success && i < count; i++)
+        offsets[i] = 0;
+
+    size_t top = 0;
+    if (success) {
+        stack[0].node = pf->root;
+        stack[0].depth = 0;
+        stack[0].best = NULL;
+        stack[0].best_depth = 0;
+    }
+
+    for (size_t q = 0; success && q < valid; q++) {
+        char const *num = queries[q].num;
+        size_t length = queries[q].length;
+
+        // Zostawiam tylko węzły, których ścieżka jest też prefiksem obecnego numeru
+        if (q > 0) {
+            size_t common = lengthOfLongestCommonPrefix(num, length,
+                                                        queries[q - 1].num,
+                                                        queries[q - 1].length);
+            while (stack[top].depth > common)
+                top--;
+        }
+
+        while (stack[top].depth < length) {
+            size_t depth = stack[top].depth;
+            Node *child = findChild(stack[top].node, num[depth]);
+            if (child == NULL ||
+                keyCommonPrefix(&child->key, num + depth, length - depth) <
+                child->key.length)
+                break;
+
+            DescentFrame *frame = &stack[top + 1];
+            frame->node = child;
+            frame->depth = depth + child->key.length;
+            frame->best = stack[top].best;
+            frame->best_depth = stack[top].best_depth;
+            if (child->terminal) {
+                frame->best = child;
+                frame->best_depth = frame->depth;
+            }
+            top++;
+        }
+
+        offsets[queries[q].index] = chars.chars_size;
+        Node *best = stack[top].best;
+        if (best != NULL) {
+            success = reservePath(&target, &target_capacity, best->phfwd.length);
+            if (success) {
+                stringUnpack(&best->phfwd, target);
+                success = numberBufferAppend(&chars, target, best->phfwd.length,
+                                             num + stack[top].best_depth,
+                                             length - stack[top].best_depth);
+            }
+        } else
+            success = numberBufferAppend(&chars, num, length, "", 0);
+    }
+
+    // Dopiero teraz znany jest rozmiar wyniku, więc przenoszę go do jednego bloku
+    PhoneNumbers *result = success ? phnumNew(count, chars.chars_size) : NULL;
+    if (result != NULL) {
+        memcpy(result->chars, chars.chars, chars.chars_size);
+        memcpy(result->offsets, offsets, count * sizeof(size_t));
+        result->numbers_count = count;
+        result->chars_size = chars.chars_size;
+    }
+
+    numberBufferFree(&chars);
+    free((void *) target);
+    free((void *) offsets);
+    free((void *) stack);
+    free((void *) queries);
+
+    return result;
+}
+
+/**
+ * Wypisuje drzewo PhoneForward.
+ * @param[in]  pf       Wskaznik na wypisywaną strukturę
+ * @param[in]  indent   glebokosc wciecia dla obecnego wezla
+ */
+void phfwdPrint(Node *pf, int indent) {
+    if (pf == NULL) {
+        DEBUG_PRINT("NULL\n");
+        return;
+    }
+
+    // Jako głębokość na stosie zapisuję wcięcie węzła
+    NodeStack stack;
+    stackIni(&stack);
+    bool success = stackPush(&stack, pf, (size_t) indent);
+
+    while (success && stack.size > 0) {
+        NodeFrame frame = stackPop(&stack);
+        for (size_t i = 0; i < frame.depth; i++)
+            DEBUG_PRINT("---");
+
+        for (size_t i = 0; i < frame.node->key.length; i++)
+            DEBUG_PRINT("%c", stringChar(&frame.node->key, i));
+
+        if (frame.node->phfwd.length > 0)
+            DEBUG_PRINT("------>");
+        for (size_t i = 0; i < frame.node->phfwd.length; i++)
+            DEBUG_PRINT("%c", stringChar(&frame.node->phfwd, i));
+
+        DEBUG_PRINT("\n");
+
+        success = stackPushChildren(&stack, frame.node, frame.depth + 1);
+    }
+
+    stackFree(&stack);
+}
+
+
+bool subtreeHeight(Node *node, NodeStack *stack, size_t *height,
+                   size_t *longest) {
+    *height = 0;
+    *longest = 0;
+    if (!stackPush(stack, node, 0))
+        return false;
+
+    while (stack->size > 0) {
+        NodeFrame frame = stackPop(stack);
+        size_t depth = frame.depth + frame.node->key.length;
+        if (depth > *height)
+            *height = depth;
+        if (frame.node->phfwd.length > *longest)
+            *longest = frame.node->phfwd.length;
+
+        if (!stackPushChildren(stack, frame.node, depth))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Usuwa z indeksu odwrotnego przekierowania zapisane w poddrzewie węzła.
+ * @param[in] pf            Baza
+ * @param[in] node          Węzeł drzewa przekierowań
+ * @param[in, out] stack    Pusty stos, którego można użyć do przeglądania
+ * @param[in, out] path     Bufor z numerem odpowiadającym ścieżce do rodzica węzła,
+ *                          mieszczący najdłuższą ścieżkę w poddrzewie
+ * @param[in] length        Długość numeru w buforze
+ * @param[out] target       Bufor mieszczący najdłuższe przekierowanie w poddrzewie
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool reverseIndexForget(PhoneForward *pf, Node *node, NodeStack *stack,
+                               char *path, size_t length, char *target) {
+    if (!stackPush(stack, node, length))
+        return false;
+
+    // Ścieżka przodków leży w buforze przed miejscem zapisu klucza węzła,
+    // bo w porządku preorder nadpisują ją tylko węzły na tej samej głębokości
+    while (stack->size > 0) {
+        NodeFrame frame = stackPop(stack);
+        Node *t = frame.node;
+
+        stringUnpack(&t->key, path + frame.depth);
+        length = frame.depth + t->key.length;
+
+        if (t->terminal) {
+            stringUnpack(&t->phfwd, target);
+            reverseIndexRemove(pf, target, t->phfwd.length, path, length);
+        }
+
+        if (!stackPushChildren(stack, t, length))
+            return false;
+    }
+
+    return true;
+}
+
+Node *findSubtree(Node *root, char const *num, size_t num_length, size_t *depth,
+                  Node **parent) {
+    Node *result = phfwdFindPrefixMatch(root, num, num_length, depth, parent);
+
+    // Usuwany jest cały węzeł, w którym kończy się num, razem z poddrzewem
+    if (*depth < num_length) {
+        Node *child = findChild(result, num[*depth]);
+        if (child == NULL ||
+            keyCommonPrefix(&child->key, num + *depth, num_length - *depth) !=
+            num_length - *depth)
+            return NULL;
+
+        if (parent != NULL)
+            *parent = result;
+        return child;
+    }
+
+    *depth -= result->key.length;
+    return result;
+}
+
+void phfwdRemove(struct PhoneForward *pf, char const *num) {
+    if (!isNumber(num))
+        return;
+
+    if (!pf)
+        return;
+
+    size_t num_length = strlen(num);
+    size_t depth = 0;
+    Node *parent = NULL;
+    Node *result = findSubtree(pf->root, num, num_length, &depth, &parent);
+    if (result == NULL)
+        return;
+
+    // Ścieżka do rodzica usuwanego węzła to pierwsze depth znaków num
+    NodeStack stack;
+    stackIni(&stack);
+    size_t height = 0;
+    size_t longest = 0;
+    char *path = NULL;
+    char *target = NULL;
+    if (subtreeHeight(result, &stack, &height, &longest)) {
+        path = malloc(depth + height + 1);
+        target = malloc(longest + 1);
+    }
+
+    // Przy braku pamięci nic nie usuwam, aby indeks odwrotny był spójny z drzewem
+    if (path == NULL || target == NULL) {
+        free((void *) path);
+        free((void *) target);
+        stackFree(&stack);
+        return;
+    }
+
+    // Stos urósł już przy liczeniu wysokości, a przeglądanie odkłada na niego
+    // te same węzły, więc tu nie zabraknie pamięci
+    memcpy(path, num, depth);
+    bool success = reverseIndexForget(pf, result, &stack, path, depth, target);
+    free((void *) target);
+    free((void *) path);
+    stackFree(&stack);
+
+    if (!success)
+        return;
+
+    if (pf->cache != NULL)
+        getCacheInvalidate(pf->cache, num, num_length);
+
+    removeChild(pf, parent, nodeFirstChar(result));
+    nodeDelete(pf, result);
+
+    if (parent != pf->root)
+        mergeWithChild(pf, parent);
+}
+
+/**
+ * Przegląda węzły ze stosu i ich poddrzewa, dopisując do bufora numer każdego
+ * węzła z wartością, z dołączonym sufiksem. Bufor na numery musi zawierać
+ * ścieżki do rodziców węzłów ze stosu.
+ * @param[in, out] stack        Stos węzłów do przejrzenia
+ * @param[in, out] path         Bufor na numery z drzewa
+ * @param[in, out] capacity     Rozmiar bufora
+ * @param[in] suffix            Dołączany sufiks
+ * @param[in] suffix_length     Długość sufiksu
+ * @param[in, out] result       Bufor do którego dodawne sa odpowiadające przekierowania
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool reverseCollect(NodeStack *stack, char **path, size_t *capacity,
+                           char const *suffix, size_t suffix_length,
+                           NumberBuffer *result) {
+    while (stack->size > 0) {
+        NodeFrame frame = stackPop(stack);
+        Node *t = frame.node;
+
+        size_t length = frame.depth + t->key.length;
+        if (!reservePath(path, capacity, length))
+            return false;
+
+        stringUnpack(&t->key, *path + frame.depth);
+
+        if (t->terminal &&
+            !numberBufferAppend(result, *path, length, suffix, suffix_length))
+            return false;
+
+        if (!stackPushChildren(stack, t, length))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Funkcja pomocnicza dla phfwdReverse. Dopisuje do bufora numery zapisane
+ * w drzewie numerów źródłowych, każdy z dołączonym sufiksem.
+ * @param[in] t                 Korzeń drzewa numerów źródłowych
+ * @param[in, out] stack        Pusty stos, którego można użyć do przeglądania
+ * @param[in, out] path         Bufor na numery z drzewa
+ * @param[in, out] capacity     Rozmiar bufora
+ * @param[in] suffix            Dołączany sufiks
+ * @param[in] suffix_length     Długość sufiksu
+ * @param[in, out] result       Bufor do którego dodawne sa odpowiadające przekierowania
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool phfwdReverseUtil(Node *t, NodeStack *stack, char **path,
+                             size_t *capacity, char const *suffix,
+                             size_t suffix_length, NumberBuffer *result) {
+    if (!stackPushChildren(stack, t, 0))
+        return false;
+
+    return reverseCollect(stack, path, capacity, suffix, suffix_length, result);
+}
+
+PhoneNumbers *treeReverse(Node *targets, char const *num) {
+    if (targets == NULL || !isNumber(num))
+        return phnumNew(0, 0);
+
+    // Wyniki są zbierane bez porządku, sortowane i deduplikowane raz na końcu
+    NumberBuffer temp;
+    numberBufferIni(&temp);
+    size_t num_len = strlen(num);
+
+    NodeStack stack;
+    stackIni(&stack);
+    size_t capacity = num_len + 1;
+    char *path = malloc(capacity);
+    bool success = path != NULL && numberBufferAppend(&temp, num, num_len, "", 0);
+
+    // Każdy węzeł indeksu na ścieżce num odpowiada przekierowaniom na prefiks num
+    Node *t = targets;
+    size_t depth = 0;
+    while (success && depth < num_len) {
+        Node *child = findChild(t, num[depth]);
+        if (child == NULL ||
+            keyCommonPrefix(&child->key, num + depth, num_len - depth) <
+            child->key.length)
+            break;
+
+        depth += child->key.length;
+        t = child;
+
+        if (t->terminal)
+            success = phfwdReverseUtil(t->sources, &stack, &path, &capacity,
+                                       num + depth, num_len - depth, &temp);
+    }
+
+    free((void *) path);
+    stackFree(&stack);
+
+    PhoneNumbers *result = NULL;
+    if (success && numberBufferSortUnique(&temp))
+        result = phnumFromArray(temp.sorted, temp.count);
+
+    numberBufferFree(&temp);
+
+    return result;
+}
+
+struct PhoneNumbers const *phfwdReverse(struct PhoneForward *pf, char const *num) {
+    return treeReverse(pf != NULL ? pf->targets : NULL, num);
+}
+
+/**
+ * Odtwarza w buforze ścieżkę od korzenia drzewa numerów źródłowych do końca
+ * klucza węzła danego kroku.
+ * @param[in] steps     Kroki
+ * @param[in] step      Ostatni krok ścieżki lub REVERSE_NO_STEP
+ * @param[in] length    Długość ścieżki
+ * @param[out] path     Bufor na co najmniej @p length znaków
+ */
+static void stepsPath(ReverseStep const *steps, size_t step, size_t length,
+                      char *path) {
+    while (step != REVERSE_NO_STEP) {
+        Node const *node = steps[step].node;
+        length -= node->key.length;
+        stringUnpack(&node->key, path + length);
+        step = steps[step].parent;
+    }
+}
+
+/**
+ * Dopisuje poddrzewo do listy poddrzew do przejrzenia.
+ * @param[in, out] tasks    Tablica poddrzew
+ * @param[in, out] count    Liczba poddrzew
+ * @param[in, out] capacity Rozmiar tablicy
+ * @param[in] task          Dopisywane poddrzewo
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool pushReverseTask(ReverseTask **tasks, size_t *count, size_t *capacity,
+                            ReverseTask task) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity > 0 ? 2 * (*capacity) : NUMBER_OF_DIGITS;
+        ReverseTask *new_tasks = realloc(*tasks, new_capacity * sizeof(ReverseTask));
+        if (new_tasks == NULL)
+            return false;
+
+        *tasks = new_tasks;
+        *capacity = new_capacity;
+    }
+
+    (*tasks)[(*count)++] = task;
+    return true;
+}
+
+/**
+ * Przegląda w wątku jedno poddrzewo zlecenia phfwdReverseParallel.
+ * @param[in] context   Zlecenie ReverseJob
+ * @param[in] worker    Numer wątku
+ * @param[in] index     Numer poddrzewa
+ */
+static void reverseTask(void *context, size_t worker, size_t index) {
+    ReverseJob *job = context;
+    ReverseWorker *w = &job->workers[worker];
+    ReverseTask const *task = &job->tasks[index];
+
+    if (w->failed)
+        return;
+
+    w->failed = !reservePath(&w->path, &w->capacity, task->depth + 1) ||
+                !stackPush(&w->stack, task->node, task->depth);
+    if (w->failed)
+        return;
+
+    stepsPath(job->steps, task->parent, task->depth, w->path);
+    w->failed = !reverseCollect(&w->stack, &w->path, &w->capacity,
+                                job->num + task->suffix,
+                                job->num_length - task->suffix,
+                                &job->results[worker]);
+    w->stack.size = 0;
+}
+
+/**
+ * Sortuje w wątku wyniki jednego z wątków zlecenia phfwdReverseParallel.
+ * @param[in] context   Zlecenie ReverseJob
+ * @param[in] worker    Numer wątku wykonującego sortowanie
+ * @param[in] index     Numer wątku, którego wyniki są sortowane
+ */
+static void reverseSortTask(void *context, size_t worker, size_t index) {
+    ReverseJob *job = context;
+    (void) worker;
+
+    if (!job->workers[index].failed &&
+        !numberBufferSortUnique(&job->results[index]))
+        job->workers[index].failed = true;
+}
+
+/**
+ * Rozdziela między wątki przeglądanie poddrzew od @p first do końca tablicy,
+ * sortuje wyniki każdego wątku i scala je z wynikami @p own.
+ * @param[in] job           Zlecenie z wypełnionymi polami numeru, kroków i poddrzew
+ * @param[in] first         Pierwsze poddrzewo do przejrzenia
+ * @param[in] count         Liczba wszystkich poddrzew
+ * @param[in] pool          Pula wątków lub NULL, gdy poddrzewa przegląda
+ *                          wątek wywołujący
+ * @param[in] workers       Największa liczba wątków
+ * @param[in, out] own      Nieposortowane wyniki znalezione przy dzieleniu pracy
+ * @return Struktura ze scalonymi numerami lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+static PhoneNumbers *reverseInParallel(ReverseJob *job, size_t first, size_t count,
+                                       WorkerPool *pool, size_t workers,
+                                       NumberBuffer *own) {
+    bool success = true;
+    size_t size = first < count ? workerPoolLimit(pool, workers) : 1;
+
+    // Wyniki znalezione przy dzieleniu pracy są ostatnim buforem
+    job->workers = malloc(size * sizeof(ReverseWorker));
+    job->results = malloc((size + 1) * sizeof(NumberBuffer));
+    if (job->workers == NULL || job->results == NULL)
+        success = false;
+
+    for (size_t i = 0; success && i < size; i++) {
+        stackIni(&job->workers[i].stack);
+        job->workers[i].path = NULL;
+        job->workers[i].capacity = 0;
+        job->workers[i].failed = false;
+        numberBufferIni(&job->results[i]);
+    }
+
+    if (success && first < count) {
+        job->tasks += first;
+        workerPoolRunLimited(pool, size, count - first, reverseTask, job);
+        workerPoolRunLimited(pool, size, size, reverseSortTask, job);
+    } else if (success)
+        success = numberBufferSortUnique(&job->results[0]);
+
+    for (size_t i = 0; success && i < size; i++)
+        success = !job->workers[i].failed;
+
+    char const **merged = NULL;
+    size_t merged_count = 0;
+    if (success) {
+        job->results[size] = *own;
+        numberBufferIni(own);
+        success = numberBufferSortUnique(&job->results[size]) &&
+                  (merged = numberBuffersMerge(job->results, size + 1,
+                                               &merged_count)) != NULL;
+        *own = job->results[size];
+    }
+
+    PhoneNumbers *result = NULL;
+    if (success)
+        result = phnumFromArray(merged, merged_count);
+
+    free((void *) merged);
+    for (size_t i = 0; job->workers != NULL && job->results != NULL && i < size;
+         i++) {
+        stackFree(&job->workers[i].stack);
+        free((void *) job->workers[i].path);
+        numberBufferFree(&job->results[i]);
+    }
+    free((void *) job->workers);
+    free((void *) job->results);
+
+    return result;
+}
+
+struct PhoneNumbers const *phfwdReverseParallel(struct PhoneForward *pf,
+                                                char const *num, size_t workers) {
+    // Wspólna pula ma po jednym wykonawcy na procesor
+    size_t processors = workerPoolProcessors();
+    if (workers == 0 || workers > processors)
+        workers = processors;
+
+    if (workers <= 1 || pf == NULL || !isNumber(num))
+        return phfwdReverse(pf, num);
+
+    NumberBuffer own;
+    numberBufferIni(&own);
+    size_t num_len = strlen(num);
+
+    ReverseStep *steps = NULL;
+    size_t steps_count = 0;
+    ReverseTask *tasks = NULL;
+    size_t tasks_count = 0;
+    size_t tasks_capacity = 0;
+    size_t capacity = num_len + 1;
+    char *path = malloc(capacity);
+    bool success = path != NULL && numberBufferAppend(&own, num, num_len, "", 0);
+
+    // Drzewa numerów źródłowych węzłów indeksu na ścieżce num to początkowe poddrzewa
+    Node *t = pf->targets;
+    size_t depth = 0;
+    while (success && depth < num_len) {
+        Node *child = findChild(t, num[depth]);
+        if (child == NULL ||
+            keyCommonPrefix(&child->key, num + depth, num_len - depth) <
+            child->key.length)
+            break;
+
+        depth += child->key.length;
+        t = child;
+
+        if (t->terminal) {
+            ReverseTask task = {t->sources, REVERSE_NO_STEP, 0, depth};
+            success = pushReverseTask(&tasks, &tasks_count, &tasks_capacity, task);
+        }
+    }
+
+    // Poddrzewa rozwijam wszerz, aż będzie ich dość dla wszystkich wątków;
+    // małe wyniki wyznaczam w całości bez tworzenia wątków
+    size_t head = 0;
+    size_t steps_capacity = 0;
+    while (success && head < tasks_count &&
+           (steps_count < REVERSE_SEQUENTIAL_LIMIT ||
+            tasks_count - head < workers * REVERSE_TASKS_PER_WORKER)) {
+        ReverseTask task = tasks[head++];
+        Node *node = task.node;
+        size_t length = task.depth + node->key.length;
+
+        if (steps_count == steps_capacity) {
+            size_t new_capacity = steps_capacity > 0 ? 2 * steps_capacity
+                                                     : REVERSE_TASKS_PER_WORKER;
+            ReverseStep *new_steps = realloc(steps, new_capacity * sizeof(ReverseStep));
+            if (new_steps == NULL) {
+                success = false;
+                break;
+            }
+
+            steps = new_steps;
+            steps_capacity = new_capacity;
+        }
+
+        size_t step = steps_count++;
+        steps[step].node = node;
+        steps[step].parent = task.parent;
+
+        if (node->terminal) {
+            success = reservePath(&path, &capacity, length);
+            if (success) {
+                stepsPath(steps, step, length, path);
+                success = numberBufferAppend(&own, path, length, num + task.suffix,
+                                             num_len - task.suffix);
+            }
+        }
+
+        for (size_t i = 0; success && i < childSlots(node); i++) {
+            if (node->children[i] != NULL) {
+                ReverseTask child = {node->children[i], step, length, task.suffix};
+                success = pushReverseTask(&tasks, &tasks_count, &tasks_capacity,
+                                          child);
+            }
+        }
+    }
+
+    // Wątki są potrzebne tylko wtedy, gdy zostały nierozwinięte poddrzewa;
+    // gdy wspólna pula jest zajęta, przeglądam je sama
+    PhoneNumbers *result = NULL;
+    if (success) {
+        WorkerPool *pool = head < tasks_count ? workerPoolAcquire() : NULL;
+        ReverseJob job = {num, num_len, steps, tasks, NULL, NULL};
+        result = reverseInParallel(&job, head, tasks_count, pool, workers, &own);
+        workerPoolRelease(pool);
+    }
+
+    free((void *) path);
+    free((void *) steps);
+    free((void *) tasks);
+    numberBufferFree(&own);
 
-    removeList(&temp);
     return result;
 }
 
-char const *phnumGet(struct PhoneNumbers const *pnum, size_t idx) {
-    if (pnum == NULL)
+/**
+ * Porównuje leksykograficznie dwa numery.
+ * @param[in] a         Pierwszy numer
+ * @param[in] a_length  Długość pierwszego numeru
+ * @param[in] b         Drugi numer
+ * @param[in] b_length  Długość drugiego numeru
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp.
+ */
+static int compareNumbers(char const *a, size_t a_length, char const *b,
+                          size_t b_length) {
+    int cmp = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (cmp != 0)
+        return cmp;
+
+    return a_length < b_length ? -1 : a_length > b_length;
+}
+
+/**
+ * Porównuje dwa elementy kopca kursora.
+ * @param[in] a Pierwszy element
+ * @param[in] b Drugi element
+ * @return True, jeżeli napis @p a jest mniejszy niż napis @p b.
+ */
+static inline bool cursorItemLess(ReverseCursorItem const *a,
+                                  ReverseCursorItem const *b) {
+    return compareNumbers(a->number, a->length, b->number, b->length) < 0;
+}
+
+/**
+ * Tworzy element kopca kursora z napisem będącym złączeniem trzech napisów.
+ * @param[in, out] c    Kursor
+ * @param[in] node      Korzeń poddrzewa lub NULL dla gotowego numeru
+ * @param[in] s1        Pierwsza część napisu
+ * @param[in] s1_len    Długość pierwszej części
+ * @param[in] key       Klucz węzła będący drugą częścią napisu lub NULL
+ * @param[in] s3        Trzecia część napisu
+ * @param[in] s3_len    Długość trzeciej części
+ * @param[in] suffix    Początek sufiksu w szukanym numerze
+ * @param[out] item     Utworzony element
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool cursorItem(ReverseCursor *c, Node *node, char const *s1, size_t s1_len,
+                       ShortString const *key, char const *s3, size_t s3_len,
+                       size_t suffix, ReverseCursorItem *item) {
+    // Kopiec rośnie najwyżej o jeden element na każdy tworzony element
+    if (c->size == c->capacity) {
+        size_t capacity = c->capacity > 0 ? 2 * c->capacity : INITIAL_STACK_CAPACITY;
+        ReverseCursorItem *heap = realloc(c->heap, capacity * sizeof(ReverseCursorItem));
+        if (heap == NULL)
+            return false;
+
+        c->heap = heap;
+        c->capacity = capacity;
+    }
+
+    size_t s2_len = key != NULL ? key->length : 0;
+    size_t length = s1_len + s2_len + s3_len;
+    char *number = arenaAlloc(&c->strings, length + 1);
+    if (number == NULL)
+        return false;
+
+    memcpy(number, s1, s1_len);
+    if (key != NULL)
+        stringUnpack(key, number + s1_len);
+    memcpy(number + s1_len + s2_len, s3, s3_len);
+    number[length] = '\0';
+
+    item->node = node;
+    item->parent = NULL;
+    item->slot = 0;
+    item->parent_length = 0;
+    item->number = number;
+    item->length = length;
+    item->suffix = suffix;
+    return true;
+}
+
+/**
+ * Wstawia element do kopca kursora. W tablicy kopca musi być na niego miejsce.
+ * @param[in, out] c    Kursor
+ * @param[in] item      Wstawiany element
+ */
+static void cursorSiftUp(ReverseCursor *c, ReverseCursorItem item) {
+    size_t i = c->size++;
+    while (i > 0 && cursorItemLess(&item, &c->heap[(i - 1) / 2])) {
+        c->heap[i] = c->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    c->heap[i] = item;
+}
+
+/**
+ * Wstawia element w miejsce najmniejszego elementu kopca kursora.
+ * @param[in, out] c    Kursor z niepustym kopcem
+ * @param[in] item      Wstawiany element
+ */
+static void cursorSiftDown(ReverseCursor *c, ReverseCursorItem item) {
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= c->size)
+            break;
+        if (child + 1 < c->size && cursorItemLess(&c->heap[child + 1], &c->heap[child]))
+            child++;
+        if (!cursorItemLess(&c->heap[child], &item))
+            break;
+
+        c->heap[i] = c->heap[child];
+        i = child;
+    }
+    c->heap[i] = item;
+}
+
+/**
+ * Usuwa z kopca kursora najmniejszy element.
+ * @param[in, out] c    Kursor z niepustym kopcem
+ */
+static void cursorPop(ReverseCursor *c) {
+    c->size--;
+    if (c->size > 0)
+        cursorSiftDown(c, c->heap[c->size]);
+}
+
+/**
+ * Zastępuje najmniejszy element kopca kursora nowym elementem lub, gdy
+ * najmniejszy został już zastąpiony, wstawia nowy element do kopca.
+ * @param[in, out] c        Kursor
+ * @param[in] item          Nowy element
+ * @param[in, out] replaced Czy najmniejszy element został już zastąpiony
+ */
+static void cursorPlace(ReverseCursor *c, ReverseCursorItem item, bool *replaced) {
+    if (*replaced) {
+        cursorSiftUp(c, item);
+    } else {
+        cursorSiftDown(c, item);
+        *replaced = true;
+    }
+}
+
+/**
+ * Umieszcza w kopcu kursora element dla dziecka węzła. Dziecko bez dzieci
+ * od razu staje się gotowym numerem.
+ * @param[in, out] c        Kursor
+ * @param[in] path          Napis zaczynający się od ścieżki do rodzica
+ * @param[in] path_length   Długość ścieżki do rodzica
+ * @param[in] parent        Rodzic
+ * @param[in] slot          Pole dziecka w tablicy dzieci rodzica
+ * @param[in] suffix        Początek sufiksu w szukanym numerze
+ * @param[in, out] replaced Czy najmniejszy element kopca został już zastąpiony
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool cursorChild(ReverseCursor *c, char const *path, size_t path_length,
+                        Node *parent, size_t slot, size_t suffix, bool *replaced) {
+    Node *child = parent->children[slot];
+    bool leaf = child->children_count == 0;
+
+    ReverseCursorItem item;
+    if (!cursorItem(c, leaf ? NULL : child, path, path_length, &child->key,
+                    leaf ? c->num + suffix : "",
+                    leaf ? c->num_length - suffix : 0, suffix, &item))
+        return false;
+
+    item.parent = parent;
+    item.slot = slot;
+    item.parent_length = path_length;
+    cursorPlace(c, item, replaced);
+    return true;
+}
+
+/**
+ * Umieszcza w kopcu kursora element dla następnego z rodzeństwa elementu.
+ * Wszystkie jego numery są większe od numerów elementu, więc wcześniej
+ * nie musi być w kopcu.
+ * @param[in, out] c        Kursor
+ * @param[in] item          Element
+ * @param[in, out] replaced Czy najmniejszy element kopca został już zastąpiony
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool cursorSibling(ReverseCursor *c, ReverseCursorItem const *item,
+                          bool *replaced) {
+    Node *parent = item->parent;
+    if (parent == NULL)
+        return true;
+
+    for (size_t i = item->slot + 1; i < childSlots(parent); i++) {
+        if (parent->children[i] != NULL)
+            return cursorChild(c, item->number, item->parent_length, parent, i,
+                               item->suffix, replaced);
+    }
+
+    return true;
+}
+
+/**
+ * Sprawdza, czy wszystkie numery poddrzewa są mniejsze od ostatnio wydanego
+ * numeru, czyli czy ścieżka do jego korzenia jest od niego mniejsza i nie
+ * jest jego prefiksem.
+ * @param[in] c     Kursor
+ * @param[in] item  Element z poddrzewem
+ * @return True, jeżeli poddrzewo można pominąć, false w p.p.
+ */
+static bool cursorSkipsSubtree(ReverseCursor const *c, ReverseCursorItem const *item) {
+    if (c->last == NULL)
+        return false;
+
+    return compareNumbers(item->number, item->length, c->last, c->last_length) < 0 &&
+           (item->length > c->last_length ||
+            memcmp(item->number, c->last, item->length) != 0);
+}
+
+struct ReverseCursor *phfwdReverseBegin(struct PhoneForward const *pf,
+                                        char const *num, char const *start_after,
+                                        size_t limit) {
+    ReverseCursor *c = malloc(sizeof(ReverseCursor));
+    if (c == NULL)
         return NULL;
 
-    if (idx < pnum->numbers_array_size)
-        return pnum->numbers[idx];
+    c->num = NULL;
+    c->num_length = 0;
+    c->heap = NULL;
+    c->size = 0;
+    c->capacity = 0;
+    arenaIni(&c->strings);
+    c->last = NULL;
+    c->last_length = 0;
+    c->limit = limit;
+    c->emitted = 0;
+
+    // Dla niepoprawnych argumentów kursor nie wyda żadnego numeru
+    if (pf == NULL || !isNumber(num))
+        return c;
+
+    c->num_length = strlen(num);
+    c->num = malloc(c->num_length + 1);
+    bool success = c->num != NULL;
+    if (success)
+        memcpy(c->num, num, c->num_length + 1);
+
+    if (success && start_after != NULL) {
+        c->last_length = strlen(start_after);
+        c->last = arenaAlloc(&c->strings, c->last_length + 1);
+        success = c->last != NULL;
+        if (success)
+            memcpy(c->last, start_after, c->last_length + 1);
+    }
 
-    return NULL;
+    ReverseCursorItem item;
+    success = success && cursorItem(c, NULL, num, c->num_length, NULL, "", 0, 0,
+                                    &item);
+    if (success)
+        cursorSiftUp(c, item);
+
+    // Każdy węzeł indeksu na ścieżce num odpowiada przekierowaniom na prefiks num
+    Node *t = pf->targets;
+    size_t depth = 0;
+    while (success && depth < c->num_length) {
+        Node *child = findChild(t, num[depth]);
+        if (child == NULL ||
+            keyCommonPrefix(&child->key, num + depth, c->num_length - depth) <
+            child->key.length)
+            break;
+
+        depth += child->key.length;
+        t = child;
+
+        if (t->terminal) {
+            success = cursorItem(c, t->sources, "", 0, NULL, "", 0, depth, &item);
+            if (success)
+                cursorSiftUp(c, item);
+        }
+    }
+
+    if (!success) {
+        phfwdReverseEnd(c);
+        return NULL;
+    }
+
+    return c;
 }
 
-void phnumDelete(struct PhoneNumbers const *pnum) {
-    if (pnum == NULL)
-        return;
+bool phfwdReverseNext(struct ReverseCursor *cursor, char const **number) {
+    *number = NULL;
+    if (cursor == NULL || (cursor->limit > 0 && cursor->emitted == cursor->limit))
+        return true;
+
+    while (cursor->size > 0) {
+        ReverseCursorItem top = cursor->heap[0];
+
+        // Element jest najmniejszy w kopcu, więc pierwszy z nowych elementów
+        // zajmuje jego miejsce zamiast wyjmowania i wstawiania
+        bool replaced = false;
+        bool success = cursorSibling(cursor, &top, &replaced);
+
+        if (success && top.node != NULL && !cursorSkipsSubtree(cursor, &top)) {
+            Node *node = top.node;
+            ReverseCursorItem item;
+            if (node->terminal) {
+                success = cursorItem(cursor, NULL, top.number, top.length, NULL,
+                                     cursor->num + top.suffix,
+                                     cursor->num_length - top.suffix,
+                                     top.suffix, &item);
+                if (success)
+                    cursorPlace(cursor, item, &replaced);
+            }
+
+            // Pozostałe dzieci trafią do kopca po kolei, jako rodzeństwo
+            for (size_t i = 0; success && i < childSlots(node); i++) {
+                if (node->children[i] != NULL) {
+                    success = cursorChild(cursor, top.number, top.length, node, i,
+                                          top.suffix, &replaced);
+                    break;
+                }
+            }
+        }
+
+        if (!replaced)
+            cursorPop(cursor);
+
+        if (!success || top.node != NULL) {
+            arenaFree(&cursor->strings, top.number, top.length + 1);
+            if (!success)
+                return false;
+            continue;
+        }
+
+        // Kopiec wydaje numery rosnąco, więc powtórzenie jest równe poprzednikowi
+        if (cursor->last != NULL &&
+            compareNumbers(top.number, top.length, cursor->last,
+                           cursor->last_length) <= 0) {
+            arenaFree(&cursor->strings, top.number, top.length + 1);
+            continue;
+        }
+
+        if (cursor->last != NULL)
+            arenaFree(&cursor->strings, cursor->last, cursor->last_length + 1);
+        cursor->last = top.number;
+        cursor->last_length = top.length;
+        cursor->emitted++;
+        *number = cursor->last;
+        return true;
+    }
+
+    return true;
+}
+
+void phfwdReverseEnd(struct ReverseCursor *cursor) {
+    // Wszystkie napisy kursora pochodzą z jego alokatora
+    if (cursor != NULL) {
+        arenaRelease(&cursor->strings);
+        free((void *) cursor->heap);
+        free((void *) cursor->num);
+        free((void *) cursor);
+    }
+}
 
+char const *phnumGet(struct PhoneNumbers const *pnum, size_t idx) {
+    if (pnum == NULL)
+        return NULL;
 
-    for (size_t i = 0; i < pnum->numbers_count; i++)
-        free((void *) pnum->numbers[i]);
+    if (idx < pnum->numbers_count)
+        return pnum->chars + pnum->offsets[idx];
 
+    return NULL;
+}
 
-    free((void *) pnum->numbers);
+void phnumDelete(struct PhoneNumbers const *pnum) {
+    // Numery leżą w tym samym bloku co struktura
     free((void *) pnum);
 }
 
@@ -769,10 +2792,8 @@ static inline unsigned int countAvailableChars(char const *set,
     size_t i = 0;
 
     while (num_of_available_chars < NUMBER_OF_DIGITS && set[i] != '\0') {
-        if (isDigitWrapper(set[i]) && !available_chars[set[i] - '0']) {
-            // Na szczęście, w tablicy ascii : oraz ; występują w tej kolejności
-            // zaraz po cyfrach 0 - 9
-            available_chars[set[i] - '0'] = true;
+        if (isDigitWrapper(set[i]) && !available_chars[digitIndex(set[i])]) {
+            available_chars[digitIndex(set[i])] = true;
             num_of_available_chars++;
         }
 
@@ -787,7 +2808,7 @@ static inline unsigned int countAvailableChars(char const *set,
  * @param exp wykladnik.
  * @return podstawa^wykładnik.
  */
-size_t power(size_t base, size_t exp) {
+static size_t power(size_t base, size_t exp) {
     size_t result = 1;
     while (exp) {
         if (exp & 1)
@@ -799,131 +2820,719 @@ size_t power(size_t base, size_t exp) {
     return result;
 }
 
+/**
+ * Funkcja pomocnicza do phfwdNonTrivialCount.
+ * Rozpatruje węzeł indeksu odwrotnego: jeżeli jego klucz składa się tylko
+ * z dostępnych znaków i mieści się w pozostałej długości, a ścieżka węzła jest
+ * numerem, na który przekierowano, dolicza wszystkie numery zaczynające się
+ * od tej ścieżki. Dzieci takiego węzła są już policzone, więc nie trzeba ich
+ * odwiedzać; w p.p. odkłada dzieci na stos.
+ * @param frame Węzeł z liczbą znaków, które pozostały przed jego kluczem.
+ * @param available_chars tablica wskazująca które znaki są dostępne.
+ * @param num_of_available_chars liczba dozwolonych znaków.
+ * @param stack stos, na który trafiają dzieci węzła.
+ * @param count suma możliwych kombinacji, powiększana o wynik węzła.
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool nonTrivialVisit(NodeFrame frame, bool const *available_chars,
+                            unsigned int num_of_available_chars, NodeStack *stack,
+                            size_t *count) {
+    Node *node = frame.node;
+    if (frame.depth < node->key.length)
+        return true;
+
+    unsigned char const *key = stringDigits(&node->key);
+    for (size_t i = 0; i < node->key.length; i++) {
+        if (!available_chars[packedDigit(key, i)])
+            return true;
+    }
+
+    size_t len = frame.depth - node->key.length;
+    if (node->terminal) {
+        *count += power((size_t) num_of_available_chars, len);
+        return true;
+    }
+
+    return len == 0 || stackPushChildren(stack, node, len);
+}
 
 /**
  * Funkcja pomocnicza do phfwdNonTrivialCount.
- * Rekurencyjnie przeszukuje drzewo w poszukiwaniu kluczy zawierających tyko znaki
- * znajdujące sie w zbiorze set.
- * @param pf Przeszukiwana struktura.
- * @param available_chars tablica wskazująca które znaki są dostępne (znajdowały się
- * w tablicy set).
- * @param result struktura PhoneForward w której zapisane są odpowiednie przekierowania.
- * @param num_of_available_chars Liczba dostępnych znaków.
- * @param len maksymalna dlugosc napisu.
- */
-void searchForNonTrivialNumbers(struct PhoneForward *pf,
-                                struct PhoneForward *result,
-                                bool available_chars[NUMBER_OF_DIGITS],
-                                int num_of_available_chars,
-                                size_t *len) {
+ * Przegląda poddrzewa indeksu odwrotnego zapisane na stosie i zlicza możliwe
+ * kombinacje ustawienia dostępnych znaków na wolnych miejscach.
+ * @param available_chars tablica wskazująca które znaki są dostępne.
+ * @param num_of_available_chars liczba dozwolonych znaków.
+ * @param stack stos węzłów do przejrzenia; głębokość na stosie to liczba
+ * znaków, które pozostały do wykorzystania przed kluczem węzła.
+ * @param count suma możliwych kombinacji, powiększana o wynik poddrzew.
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool nonTrivialCountResults(bool const *available_chars,
+                                   unsigned int num_of_available_chars,
+                                   NodeStack *stack, size_t *count) {
+    while (stack->size > 0) {
+        if (!nonTrivialVisit(stackPop(stack), available_chars,
+                             num_of_available_chars, stack, count))
+            return false;
+    }
 
-    if (!pf)
+    return true;
+}
+
+/**
+ * Zlicza w wątku kombinacje dla jednego poddrzewa zlecenia NonTrivialJob.
+ * @param context   Zlecenie NonTrivialJob
+ * @param worker    Numer wątku
+ * @param index     Numer poddrzewa
+ */
+static void nonTrivialTask(void *context, size_t worker, size_t index) {
+    NonTrivialJob *job = context;
+    NonTrivialWorker *w = &job->workers[worker];
+
+    if (w->failed)
         return;
 
-    searchForNonTrivialNumbers(pf->next, result, available_chars,
-                               num_of_available_chars,
-                               len);
-    searchForNonTrivialNumbers(pf->child, result, available_chars,
-                               num_of_available_chars,
-                               len);
+    w->failed = !stackPush(&w->stack, job->tasks[index].node,
+                           job->tasks[index].depth) ||
+                !nonTrivialCountResults(job->available_chars,
+                                        job->num_of_available_chars, &w->stack,
+                                        &w->count);
+    w->stack.size = 0;
+}
+
+/**
+ * Rozdziela między wątki zliczanie kombinacji dla poddrzew z tablicy.
+ * @param job       Zlecenie z wypełnionymi polami zbioru znaków i poddrzew
+ * @param count     Liczba poddrzew
+ * @param pool      Pula wątków lub NULL, gdy poddrzewa przegląda wątek wywołujący
+ * @param result    Suma możliwych kombinacji, powiększana o wynik poddrzew.
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool nonTrivialInParallel(NonTrivialJob *job, size_t count, WorkerPool *pool,
+                                 size_t *result) {
+    size_t size = workerPoolLimit(pool, WORKER_POOL_MAX_WORKERS);
+
+    job->workers = malloc(size * sizeof(NonTrivialWorker));
+    bool success = job->workers != NULL;
+
+    if (success) {
+        for (size_t i = 0; i < size; i++) {
+            stackIni(&job->workers[i].stack);
+            job->workers[i].count = 0;
+            job->workers[i].failed = false;
+        }
 
+        workerPoolRunLimited(pool, size, count, nonTrivialTask, job);
 
-    DEBUG_PRINT("Jestem w wezle o kluczu %s", pf->key);
-    DEBUG_PRINT("-------->%s \n", pf->phfwd);
+        for (size_t i = 0; i < size; i++) {
+            success = success && !job->workers[i].failed;
+            *result += job->workers[i].count;
+            stackFree(&job->workers[i].stack);
+        }
+    }
 
-    if (pf->key_length == 0 || *len <= 0)
-        return;
+    free((void *) job->workers);
+    return success;
+}
+
+size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len) {
+
+    if (!pf || !set || !len)
+        return 0;
+
+    bool available_chars[NUMBER_OF_DIGITS] = {false};
+
+    unsigned int num_of_available_chars = countAvailableChars(set, available_chars);
+    DEBUG_PRINT("Ilosc dostepnych znakow: %d\n", num_of_available_chars);
+
+    if (!num_of_available_chars)
+        return 0;
+
+    // Klucze indeksu odwrotnego to dokładnie numery, na które przekierowano,
+    // bez powtórzeń i uporządkowane według prefiksów, więc numer pokryty przez
+    // swój prefiks jest pomijany bez żadnej dodatkowej struktury. Węzły
+    // odwiedzam wszerz, a gdy jest ich dużo, resztę poddrzew dzielę między wątki.
+    NodeStack queue;
+    stackIni(&queue);
+    size_t workers = workerPoolProcessors();
+    size_t temp = 0;
+    size_t head = 0;
+    bool success = stackPush(&queue, pf->targets, len);
+
+    while (success && head < queue.size &&
+           (head < NON_TRIVIAL_SEQUENTIAL_LIMIT || workers == 1 ||
+            queue.size - head < workers * NON_TRIVIAL_TASKS_PER_WORKER))
+        success = nonTrivialVisit(queue.frames[head++], available_chars,
+                                  num_of_available_chars, &queue, &temp);
+
+    // Gdy wspólna pula jest zajęta, resztę poddrzew przeglądam sama
+    if (success && head < queue.size) {
+        WorkerPool *pool = workerPoolAcquire();
+        NonTrivialJob job = {queue.frames + head, available_chars,
+                             num_of_available_chars, NULL};
+        success = nonTrivialInParallel(&job, queue.size - head, pool, &temp);
+        workerPoolRelease(pool);
+    }
+
+    stackFree(&queue);
+
+    return success ? temp : 0;
+}
+
+/*
+ * Zrzut bazy to SNAPSHOT_MAGIC, numer wersji i węzły drzewa przekierowań
+ * w porządku preorder, zaczynając od korzenia. Węzeł zapisany jest jako:
+ * liczba (długość klucza * 2 + czy węzeł ma przekierowanie), cyfry klucza,
+ * dla węzła z przekierowaniem jego długość i cyfry, a na końcu liczba dzieci.
+ * Indeks odwrotny nie jest zapisywany, bo wynika z drzewa przekierowań.
+ */
+
+bool phfwdSave(struct PhoneForward const *pf, int fd) {
+    if (pf == NULL)
+        return false;
+
+    SnapshotWriter *w = malloc(sizeof(SnapshotWriter));
+    if (w == NULL)
+        return false;
+
+    snapshotWriterIni(w, fd);
+    snapshotWriteBytes(w, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC));
+    snapshotWriteVarint(w, SNAPSHOT_VERSION);
+
+    NodeStack stack;
+    stackIni(&stack);
+    bool success = stackPush(&stack, pf->root, 0);
+
+    while (success && stack.size > 0) {
+        Node *node = stackPop(&stack).node;
 
-    size_t temp_len = (*len);
-    size_t phfwd_length = 0;
-    bool proceed = true;
+        // Napisy węzłów są spakowane tak samo jak cyfry w zrzucie
+        snapshotWriteVarint(w, node->key.length << 1 | (node->terminal ? 1 : 0));
+        snapshotWriteBytes(w, stringDigits(&node->key), (node->key.length + 1) / 2);
 
-    while (pf->phfwd[phfwd_length] != '\0' && proceed == true) {
-        char char_to_int = pf->phfwd[phfwd_length] - '0';
-        if (!available_chars[char_to_int]) {
-            proceed = false;
-            phfwd_length--;
+        if (node->terminal) {
+            snapshotWriteVarint(w, node->phfwd.length);
+            snapshotWriteBytes(w, stringDigits(&node->phfwd),
+                               (node->phfwd.length + 1) / 2);
         }
-        phfwd_length++;
+
+        snapshotWriteVarint(w, node->children_count);
+        success = stackPushChildren(&stack, node, 0);
     }
-    if (pf->phfwd[phfwd_length] != '\0')
-        return;
 
-    DEBUG_PRINT("Przekierowanie zawierało tylko znaki zawarte w set \n");
-    if (pf->phfwd[0] != '\0') {
-        long long remaining_len = (*len) - phfwd_length;
-        if (remaining_len >= 0) {
-            phfwdAddforNonTrivial(result, pf->phfwd, "1");
+    stackFree(&stack);
+    success = snapshotWriterFinish(w) && success;
+    free((void *) w);
+
+    return success;
+}
+
+/**
+ * Wczytuje z zrzutu ciąg cyfr, w razie potrzeby powiększając bufor.
+ * @param[in] r             Odczytywany zrzut
+ * @param[in, out] buffer   Bufor na cyfry
+ * @param[in, out] capacity Rozmiar bufora
+ * @param[in] length        Liczba cyfr
+ * @return True, jeżeli się udało, false w p.p.
+ */
+static bool readSnapshotDigits(SnapshotReader *r, char **buffer, size_t *capacity,
+                               size_t length) {
+    if (length > *capacity) {
+        char *new_buffer = realloc(*buffer, length);
+        if (new_buffer == NULL)
+            return false;
+
+        *buffer = new_buffer;
+        *capacity = length;
+    }
+
+    return snapshotReadDigits(r, *buffer, length);
+}
+
+/**
+ * Wczytuje z zrzutu węzeł drzewa przekierowań, bez jego dzieci.
+ * @param[in] pf                Baza, do której należy węzeł
+ * @param[in] r                 Odczytywany zrzut
+ * @param[in, out] buffer       Bufor na cyfry
+ * @param[in, out] capacity     Rozmiar bufora
+ * @param[out] children_count   Liczba dzieci węzła zapisanych w zrzucie
+ * @return Wskaźnik na utworzony węzeł lub NULL przy błędzie.
+ */
+static Node *readSnapshotNode(PhoneForward *pf, SnapshotReader *r, char **buffer,
+                              size_t *capacity, size_t *children_count) {
+    size_t header = 0;
+    if (!snapshotReadVarint(r, &header) ||
+        !readSnapshotDigits(r, buffer, capacity, header >> 1))
+        return NULL;
+
+    Node *node = nodeNew(pf, *buffer, header >> 1, NULL);
+    if (node == NULL)
+        return NULL;
+
+    bool success = true;
+    if (header & 1) {
+        size_t phfwd_length = 0;
+        success = snapshotReadVarint(r, &phfwd_length) && phfwd_length > 0 &&
+                  readSnapshotDigits(r, buffer, capacity, phfwd_length) &&
+                  stringAssign(pf, &node->phfwd, *buffer, phfwd_length);
+        node->terminal = true;
+    }
+
+    if (!success || !snapshotReadVarint(r, children_count) ||
+        *children_count > NUMBER_OF_DIGITS) {
+        nodeDelete(pf, node);
+        return NULL;
+    }
+
+    return node;
+}
+
+/**
+ * Odtwarza indeks odwrotny na podstawie drzewa przekierowań.
+ * @param[in] pf Baza z pustym indeksem odwrotnym
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool rebuildReverseIndex(PhoneForward *pf) {
+    NodeStack stack;
+    stackIni(&stack);
+    size_t capacity = 0;
+    char *path = NULL;
+    size_t target_capacity = 0;
+    char *target = NULL;
+    bool success = stackPushChildren(&stack, pf->root, 0);
+
+    while (success && stack.size > 0) {
+        NodeFrame frame = stackPop(&stack);
+        Node *node = frame.node;
+        size_t length = frame.depth + node->key.length;
+
+        if (!reservePath(&path, &capacity, length)) {
+            success = false;
+            break;
+        }
+
+        stringUnpack(&node->key, path + frame.depth);
+
+        if (node->terminal) {
+            success = reservePath(&target, &target_capacity, node->phfwd.length);
+            if (success) {
+                stringUnpack(&node->phfwd, target);
+                success = reverseIndexAdd(pf, target, node->phfwd.length, path,
+                                          length);
+            }
+        }
+
+        success = success && stackPushChildren(&stack, node, length);
+    }
+
+    free((void *) target);
+    free((void *) path);
+    stackFree(&stack);
+    return success;
+}
+
+struct PhoneForward *phfwdLoad(int fd) {
+    SnapshotReader *r = malloc(sizeof(SnapshotReader));
+    PhoneForward *pf = phfwdNew();
+    if (r == NULL || pf == NULL) {
+        free((void *) r);
+        phfwdDelete(pf);
+        return NULL;
+    }
+
+    snapshotReaderIni(r, fd);
+
+    char magic[sizeof(SNAPSHOT_MAGIC) - 1];
+    size_t version = 0;
+    bool success = snapshotReadBytes(r, magic, sizeof(magic)) &&
+                   memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0 &&
+                   snapshotReadVarint(r, &version) && version == SNAPSHOT_VERSION;
+
+    char *buffer = NULL;
+    size_t capacity = 0;
+    size_t children_count = 0;
+    Node *root = NULL;
+    if (success)
+        root = readSnapshotNode(pf, r, &buffer, &capacity, &children_count);
+
+    success = root != NULL && root->key.length == 0 && !root->terminal;
+    if (root != NULL) {
+        nodeDelete(pf, pf->root);
+        pf->root = root;
+    }
+
+    // Jako głębokość na stosie zapisuję liczbę dzieci węzła, które pozostały do wczytania
+    NodeStack stack;
+    stackIni(&stack);
+    success = success && stackPush(&stack, root, children_count);
+
+    while (success && stack.size > 0) {
+        NodeFrame *top = &stack.frames[stack.size - 1];
+        if (top->depth == 0) {
+            stack.size--;
+            continue;
+        }
+
+        top->depth--;
+        Node *parent = top->node;
+        Node *node = readSnapshotNode(pf, r, &buffer, &capacity, &children_count);
+        if (node == NULL) {
+            success = false;
+            break;
+        }
+
+        // Zrzut musi opisywać poprawne, skompresowane drzewo
+        if (node->key.length == 0 || findChild(parent, nodeFirstChar(node)) != NULL ||
+            (!node->terminal && children_count < 2) ||
+            !insertChild(pf, parent, node)) {
+            nodeDelete(pf, node);
+            success = false;
+            break;
         }
+
+        success = stackPush(&stack, node, children_count);
     }
 
-    *len = temp_len;
+    success = success && snapshotReaderAtEnd(r) && rebuildReverseIndex(pf);
+
+    stackFree(&stack);
+    free((void *) buffer);
+    free((void *) r);
+
+    if (!success) {
+        phfwdDelete(pf);
+        return NULL;
+    }
 
+    return pf;
 }
 
 /**
- * Funkcja pomocnicza do phfwdNonTrivialCount.
- * Przeszukuje drzewo zapisanych przekierowań, i zlicza możliwe kombinacje
- * ustawienie dostępnych numerów na wolnych miejscach.
- * @param pf przeszukiwane drzewo
- * @param len maksymalna dlugosc napisu
- * @param num_of_available_chars liczba dozwolonych znaków.
- * @return suma możliwych kombinacji dla drzewa pf.
+ * Zlicza węzły poddrzewa oraz znaki ich kluczy i przekierowań.
+ * @param[in] node          Korzeń poddrzewa
+ * @param[in, out] stack    Pusty stos, którego można użyć do przeglądania
+ * @param[in] values        Czy liczyć także znaki przekierowań
+ * @param[in, out] nodes    Licznik węzłów
+ * @param[in, out] chars    Licznik znaków
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
  */
-size_t nonTrivialCountResults(struct PhoneForward *pf, size_t len,
-                              unsigned int num_of_available_chars) {
-    if (!pf)
-        return 0;
+static bool countSubtree(Node *node, NodeStack *stack, bool values, size_t *nodes,
+                         size_t *chars) {
+    if (!stackPush(stack, node, 0))
+        return false;
 
-    size_t result = 0;
-    result += nonTrivialCountResults(pf->next, len, num_of_available_chars);
+    while (stack->size > 0) {
+        node = stackPop(stack).node;
+        (*nodes)++;
+        *chars += node->key.length;
+        if (values && node->terminal)
+            *chars += node->phfwd.length;
 
-    DEBUG_PRINT("jestem w kluczu %s--->%s\n", pf->key, pf->phfwd);
+        if (!stackPushChildren(stack, node, 0))
+            return false;
+    }
 
-    if (len < pf->key_length)
-        return 0;
+    return true;
+}
+
+/**
+ * Przepisuje węzły z kolejki do zamrożonego drzewa, dopisując do kolejki
+ * ich dzieci, aż kolejka się opróżni. Kolejka to tablica @p order, więc
+ * węzeł trafia do zamrożonego drzewa pod indeksem, pod którym w niej leży.
+ * @param[in, out] ff       Wypełniane zamrożone drzewo
+ * @param[in, out] order    Kolejka węzłów
+ * @param[in] head          Indeks pierwszego nieprzetworzonego węzła kolejki
+ * @param[in, out] tail     Indeks za ostatnim węzłem kolejki
+ * @param[in, out] pool     Liczba zajętych znaków puli
+ * @param[in] values        Czy przepisywać przekierowania
+ */
+static void freezeBreadthFirst(FrozenForward *ff, Node **order, size_t head,
+                               size_t *tail, size_t *pool, bool values) {
+    for (; head < *tail; head++) {
+        Node *node = order[head];
+        FrozenNode *frozen = &ff->nodes[head];
+
+        frozen->key_offset = (uint32_t) *pool;
+        frozen->key_length = (uint32_t) node->key.length;
+        stringUnpack(&node->key, ff->pool + *pool);
+        *pool += node->key.length;
+        ff->first_chars[head] = nodeFirstChar(node);
+
+        frozen->terminal = node->terminal;
+        frozen->value_offset = 0;
+        frozen->value_length = 0;
+        if (values && node->terminal) {
+            frozen->value_offset = (uint32_t) *pool;
+            frozen->value_length = (uint32_t) node->phfwd.length;
+            stringUnpack(&node->phfwd, ff->pool + *pool);
+            *pool += node->phfwd.length;
+        }
+
+        frozen->first_child = (uint32_t) *tail;
+        frozen->children_count = node->children_count;
+        for (size_t i = 0; i < childSlots(node); i++) {
+            if (node->children[i] != NULL)
+                order[(*tail)++] = node->children[i];
+        }
+    }
+}
+
+struct FrozenForward *phfwdFreeze(struct PhoneForward const *pf) {
+    if (pf == NULL)
+        return NULL;
 
-    len -= pf->key_length;
-    if (pf->phfwd[0] == '\0')
-        result += nonTrivialCountResults(pf->child, len, num_of_available_chars);
+    NodeStack stack, subtree;
+    stackIni(&stack);
+    stackIni(&subtree);
+    size_t nodes = 0;
+    size_t chars = 0;
+    size_t main_nodes = 0;
+    bool success = countSubtree(pf->root, &stack, true, &nodes, &chars);
+    main_nodes = nodes;
+    success = success && countSubtree(pf->targets, &stack, false, &nodes, &chars);
+
+    // Drzewa numerów źródłowych wiszą w węzłach indeksu z wartością
+    size_t targets_nodes = nodes - main_nodes;
+    success = success && stackPush(&stack, pf->targets, 0);
+    while (success && stack.size > 0) {
+        Node *node = stackPop(&stack).node;
+        if (node->terminal)
+            success = countSubtree(node->sources, &subtree, false, &nodes, &chars);
+        success = success && stackPushChildren(&stack, node, 0);
+    }
+    stackFree(&stack);
+    stackFree(&subtree);
 
+    // Indeksy węzłów i znaków muszą mieścić się w 32 bitach
+    if (!success || nodes >= FROZEN_NONE || chars > UINT32_MAX)
+        return NULL;
 
-    else if (pf->key_length != 0) {
-        result += (size_t) power((size_t) num_of_available_chars,
-                                 (size_t) len);
-        DEBUG_PRINT("dodaje %ld do potegi %ld ", num_of_available_chars,
-                    (size_t) len);
-        DEBUG_PRINT("czyli %ld \n", (size_t) power((size_t) num_of_available_chars,
-                                                   (size_t) len));
-        DEBUG_PRINT("SUMA TO %ld \n", result);
+    FrozenForward *ff = malloc(sizeof(FrozenForward));
+    Node **order = malloc(nodes * sizeof(Node *));
+    if (ff != NULL) {
+        ff->nodes = malloc(nodes * sizeof(FrozenNode));
+        ff->first_chars = malloc(nodes);
+        ff->pool = malloc(chars > 0 ? chars : 1);
+        ff->nodes_count = nodes;
+        ff->targets = (uint32_t) main_nodes;
+    }
 
+    if (ff == NULL || order == NULL || ff->nodes == NULL ||
+        ff->first_chars == NULL || ff->pool == NULL) {
+        free((void *) order);
+        phfwdFrozenDelete(ff);
+        return NULL;
     }
 
-    return result;
+    size_t tail = 0;
+    size_t pool = 0;
+    order[tail++] = pf->root;
+    freezeBreadthFirst(ff, order, 0, &tail, &pool, true);
+    order[tail++] = pf->targets;
+    freezeBreadthFirst(ff, order, main_nodes, &tail, &pool, false);
+
+    // Każde drzewo numerów źródłowych zajmuje spójny przedział za indeksem
+    for (size_t i = main_nodes; i < main_nodes + targets_nodes; i++) {
+        if (ff->nodes[i].terminal) {
+            size_t head = tail;
+            ff->nodes[i].value_offset = (uint32_t) head;
+            order[tail++] = order[i]->sources;
+            freezeBreadthFirst(ff, order, head, &tail, &pool, false);
+        }
+    }
+
+    free((void *) order);
+    return ff;
 }
 
-size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len) {
+void phfwdFrozenDelete(struct FrozenForward *ff) {
+    if (ff == NULL)
+        return;
 
-    if (!pf || !set || !len)
-        return 0;
+    free((void *) ff->nodes);
+    free((void *) ff->first_chars);
+    free((void *) ff->pool);
+    free((void *) ff);
+}
 
-    struct PhoneForward *result = phfwdNew();
-    bool available_chars[NUMBER_OF_DIGITS] = {false};
+/**
+ * Szuka w zamrożonym drzewie dziecka, którego klucz zaczyna się od znaku @p c.
+ * @param[in] ff    Zamrożone drzewo
+ * @param[in] node  Węzeł-rodzic
+ * @param[in] c     Pierwszy znak klucza dziecka
+ * @return Indeks dziecka lub FROZEN_NONE, jeżeli takie nie istnieje.
+ */
+static inline uint32_t frozenFindChild(FrozenForward const *ff,
+                                       FrozenNode const *node, char c) {
+    char const *keys = ff->first_chars + node->first_child;
+
+    // Dzieci są uporządkowane, więc można przerwać po minięciu szukanego znaku
+    for (uint32_t i = 0; i < node->children_count && keys[i] <= c; i++) {
+        if (keys[i] == c)
+            return node->first_child + i;
+    }
 
-    unsigned int num_of_available_chars = countAvailableChars(set, available_chars);
-    DEBUG_PRINT("Ilosc dostepnych znakow: %d\n", num_of_available_chars);
+    return FROZEN_NONE;
+}
 
-    if (!num_of_available_chars)
-        return 0;
+/**
+ * Schodzi w zamrożonym drzewie wzdłuż numeru, dopóki cały klucz kolejnego
+ * węzła jest prefiksem pozostałej części numeru.
+ * @param[in] ff            Zamrożone drzewo
+ * @param[in] node          Indeks węzła, od którego zaczyna się zejście
+ * @param[in] num           Numer
+ * @param[in] num_length    Długość numeru
+ * @param[in, out] depth    Długość dopasowanej już części numeru
+ * @return Indeks następnego pasującego węzła lub FROZEN_NONE.
+ */
+static inline uint32_t frozenDescend(FrozenForward const *ff, uint32_t node,
+                                     char const *num, size_t num_length,
+                                     size_t *depth) {
+    if (*depth >= num_length)
+        return FROZEN_NONE;
+
+    uint32_t child = frozenFindChild(ff, &ff->nodes[node], num[*depth]);
+    if (child == FROZEN_NONE)
+        return FROZEN_NONE;
+
+    FrozenNode const *frozen = &ff->nodes[child];
+    if (lengthOfLongestCommonPrefix(num + *depth, num_length - *depth,
+                                    ff->pool + frozen->key_offset,
+                                    frozen->key_length) < frozen->key_length)
+        return FROZEN_NONE;
+
+    *depth += frozen->key_length;
+    return child;
+}
 
+struct PhoneNumbers const *phfwdFrozenGet(struct FrozenForward const *ff,
+                                          char const *num) {
+    if (ff == NULL || !isNumber(num))
+        return phnumNew(0, 0);
+
+    /* szukam najdluzszego pasujacego prefixu przekierowania */
+    size_t num_length = strlen(num);
+    size_t depth = 0;
+    size_t matched = 0;
+    FrozenNode const *best = NULL;
+    for (uint32_t t = frozenDescend(ff, 0, num, num_length, &depth);
+         t != FROZEN_NONE; t = frozenDescend(ff, t, num, num_length, &depth)) {
+        if (ff->nodes[t].terminal) {
+            best = &ff->nodes[t];
+            matched = depth;
+        }
+    }
 
-    searchForNonTrivialNumbers(pf, result, available_chars, num_of_available_chars,
-                               &len);
+    char const *prefix = best != NULL ? ff->pool + best->value_offset : "";
+    size_t prefix_length = best != NULL ? best->value_length : 0;
 
-    size_t temp = nonTrivialCountResults(result, len, num_of_available_chars);
-    phfwdDelete(result);
+    PhoneNumbers *result = phnumNew(1, prefix_length + num_length - matched + 1);
+    if (result != NULL)
+        phnumAppend(result, prefix, prefix_length, num + matched,
+                    num_length - matched);
 
-    return temp;
+    return result;
+}
+
+/**
+ * Dopisuje do bufora wszystkie numery zamrożonego drzewa numerów źródłowych
+ * z dołączonym sufiksem.
+ * @param[in] ff                Zamrożone drzewo
+ * @param[in] root              Indeks korzenia drzewa numerów źródłowych
+ * @param[in, out] stack        Pusty stos
+ * @param[in, out] stack_size   Rozmiar stosu
+ * @param[in, out] path         Bufor na numery z drzewa
+ * @param[in, out] capacity     Rozmiar bufora
+ * @param[in] suffix            Dołączany sufiks
+ * @param[in] suffix_length     Długość sufiksu
+ * @param[in, out] result       Bufor, do którego dodawane są numery
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool frozenReverseUtil(FrozenForward const *ff, uint32_t root,
+                              FrozenFrame **stack, size_t *stack_size,
+                              char **path, size_t *capacity, char const *suffix,
+                              size_t suffix_length, NumberBuffer *result) {
+    size_t size = 0;
+    FrozenFrame frame = {root, 0};
+
+    for (;;) {
+        FrozenNode const *node = &ff->nodes[frame.node];
+        size_t length = frame.depth + node->key_length;
+
+        if (length > *capacity) {
+            size_t new_capacity = 2 * (*capacity) > length ? 2 * (*capacity) : length;
+            char *new_path = realloc(*path, new_capacity);
+            if (new_path == NULL)
+                return false;
+
+            *path = new_path;
+            *capacity = new_capacity;
+        }
+
+        memcpy(*path + frame.depth, ff->pool + node->key_offset, node->key_length);
+
+        if (node->terminal &&
+            !numberBufferAppend(result, *path, length, suffix, suffix_length))
+            return false;
+
+        if (size + node->children_count > *stack_size) {
+            size_t new_size = 2 * (*stack_size) > size + node->children_count
+                              ? 2 * (*stack_size) : size + node->children_count;
+            FrozenFrame *new_stack = realloc(*stack, new_size * sizeof(FrozenFrame));
+            if (new_stack == NULL)
+                return false;
+
+            *stack = new_stack;
+            *stack_size = new_size;
+        }
+
+        for (uint32_t i = 0; i < node->children_count; i++) {
+            (*stack)[size].node = node->first_child + i;
+            (*stack)[size].depth = length;
+            size++;
+        }
+
+        if (size == 0)
+            return true;
+
+        frame = (*stack)[--size];
+    }
 }
 
+struct PhoneNumbers const *phfwdFrozenReverse(struct FrozenForward const *ff,
+                                              char const *num) {
+    if (ff == NULL || !isNumber(num))
+        return phnumNew(0, 0);
+
+    NumberBuffer temp;
+    numberBufferIni(&temp);
+    size_t num_len = strlen(num);
+
+    FrozenFrame *stack = NULL;
+    size_t stack_size = 0;
+    size_t capacity = num_len + 1;
+    char *path = malloc(capacity);
+    bool success = path != NULL && numberBufferAppend(&temp, num, num_len, "", 0);
+
+    // Każdy węzeł indeksu na ścieżce num odpowiada przekierowaniom na prefiks num
+    size_t depth = 0;
+    for (uint32_t t = frozenDescend(ff, ff->targets, num, num_len, &depth);
+         success && t != FROZEN_NONE;
+         t = frozenDescend(ff, t, num, num_len, &depth)) {
+        if (ff->nodes[t].terminal)
+            success = frozenReverseUtil(ff, ff->nodes[t].value_offset, &stack,
+                                        &stack_size, &path, &capacity, num + depth,
+                                        num_len - depth, &temp);
+    }
+
+    free((void *) path);
+    free((void *) stack);
 
+    PhoneNumbers *result = NULL;
+    if (success && numberBufferSortUnique(&temp))
+        result = phnumFromArray(temp.sorted, temp.count);
+
+    numberBufferFree(&temp);
+
+    return result;
+}
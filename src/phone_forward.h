@@ -29,6 +29,18 @@ struct PhoneForward;
  */
 struct PhoneNumbers;
 
+/**
+ * @struct ReverseCursor
+ * @brief Kursor przeglądający kolejno przekierowania na dany numer.
+ */
+struct ReverseCursor;
+
+/**
+ * @struct FrozenForward
+ * @brief Niezmienna, spłaszczona kopia struktury przechowującej przekierowania.
+ */
+struct FrozenForward;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -60,6 +72,26 @@ void phfwdDelete(struct PhoneForward *pf);
  */
 bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje wiele przekierowań naraz.
+ * Działa tak, jak wywołanie phfwdAdd kolejno dla par (@p nums1[i],
+ * @p nums2[i]), w szczególności z par o takim samym prefiksie przekierowywanym
+ * obowiązuje ostatnia. Pary są sortowane i scalane z dotychczasowymi
+ * przekierowaniami bazy, a drzewo i indeks odwrotny budowane są od nowa
+ * w jednym przebiegu, w czasie liniowym względem sumy długości wszystkich
+ * numerów.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums1 – tablica prefiksów numerów przekierowywanych;
+ * @param[in] nums2 – tablica prefiksów numerów, na które wykonywane są
+ *                    przekierowania;
+ * @param[in] count – liczba par.
+ * @return Wartość @p true, jeśli przekierowania zostały dodane.
+ *         Wartość @p false, jeśli któraś z par jest niepoprawna, tak jak dla
+ *         phfwdAdd, lub gdy nie udało się zaalokować pamięci; w obu
+ *         przypadkach baza nie jest zmieniana.
+ */
+bool phfwdAddBulk(struct PhoneForward *pf, char const *const *nums1,
+                  char const *const *nums2, size_t count);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
@@ -83,6 +115,111 @@ void phfwdRemove(struct PhoneForward *pf, char const *num);
  */
 struct PhoneNumbers const *phfwdGet(struct PhoneForward *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru, zapisując je w podanym buforze.
+ * Działa jak @ref phfwdGet, ale nie alokuje pamięci. Jeśli wynik razem
+ * z kończącym go znakiem '\0' mieści się w @p cap bajtach, zapisuje go
+ * do @p buf, w przeciwnym przypadku nie zmienia bufora. Jeśli podany napis
+ * nie reprezentuje numeru, wynikiem jest pusty napis.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer;
+ * @param[out] buf – bufor na wynik, może być NULL, jeśli @p cap jest zerem;
+ * @param[in] cap  – rozmiar bufora w bajtach.
+ * @return Długość wyniku bez znaku '\0'. Wynik został zapisany wtedy i tylko
+ *         wtedy, gdy zwrócona wartość jest mniejsza niż @p cap.
+ */
+size_t phfwdGetInto(struct PhoneForward const *pf, char const *num, char *buf,
+                    size_t cap);
+
+/** @brief Wyznacza przekierowania wielu numerów naraz.
+ * Wyznacza przekierowanie każdego z @p count numerów tablicy @p nums, tak jak
+ * @ref phfwdGet. Zapytania są przetwarzane w porządku leksykograficznym, a kolejne
+ * numery o wspólnym prefiksie współdzielą zejście w głąb drzewa. Wynikowy ciąg
+ * ma @p count numerów, w kolejności zgodnej z @p nums, zapisanych w jednym
+ * obszarze pamięci; numerowi, który nie reprezentuje numeru, odpowiada pusty
+ * napis. Alokuje strukturę @p PhoneNumbers, która musi być zwolniona za pomocą
+ * funkcji @ref phnumDelete.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums   – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count  – liczba numerów;
+ * @param[in] sorted – czy numery są już posortowane leksykograficznie; wynik
+ *                     jest poprawny także dla nieposortowanych, ale wtedy
+ *                     zapytania współdzielą mniej pracy.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdGetBatch(struct PhoneForward const *pf,
+                                         char const *const *nums, size_t count,
+                                         bool sorted);
+
+/**
+ * @brief Statystyki pamięci podręcznej wyników @ref phfwdGet.
+ * Odsetek trafień to @p hits / (@p hits + @p misses).
+ */
+struct PhoneForwardCacheStats {
+    size_t capacity;        ///< Największa liczba zapamiętanych wyników
+    size_t size;            ///< Liczba zapamiętanych wyników
+    size_t hits;            ///< Liczba zapytań, na które odpowiedziała pamięć podręczna
+    size_t misses;          ///< Liczba zapytań, których wyniku nie było
+    size_t evictions;       ///< Liczba wyników usuniętych, by zrobić miejsce na nowe
+    size_t invalidations;   ///< Liczba wyników unieważnionych przez zmiany bazy
+};
+
+/** @brief Włącza pamięć podręczną wyników phfwdGet.
+ * Od tej chwili @ref phfwdGet i @ref phfwdGetInto zapamiętują wyniki
+ * ostatnio sprawdzanych numerów i odpowiadają na powtórzone zapytania bez
+ * przeglądania drzewa. Gdy wyników jest więcej niż @p capacity, usuwany jest
+ * najdawniej używany. Dodanie lub usunięcie przekierowań prefiksu unieważnia
+ * tylko wyniki numerów o tym prefiksie. Poprzednia zawartość pamięci
+ * podręcznej i jej statystyki są usuwane.
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] capacity – największa liczba zapamiętanych wyników, 0 wyłącza
+ *                       pamięć podręczną.
+ * @return Wartość @p true, jeśli się udało. Wartość @p false, jeśli @p pf ma
+ *         wartość NULL lub nie udało się zaalokować pamięci; wtedy pamięć
+ *         podręczna jest wyłączona.
+ */
+bool phfwdCacheEnable(struct PhoneForward *pf, size_t capacity);
+
+/** @brief Odczytuje statystyki pamięci podręcznej wyników phfwdGet.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[out] stats – miejsce na statystyki.
+ * @return Wartość @p true, jeśli pamięć podręczna jest włączona, wartość
+ *         @p false w p.p., w tym gdy @p pf ma wartość NULL.
+ */
+bool phfwdCacheStats(struct PhoneForward const *pf,
+                     struct PhoneForwardCacheStats *stats);
+
+/**
+ * @brief Statystyki rozmiaru i kształtu bazy przekierowań.
+ * Głębokość węzła to liczba węzłów na ścieżce od korzenia do niego, bez
+ * korzenia. Średnia głębokość przekierowania to @p depth_sum / @p rules.
+ * Rozmiary kluczy i przekierowań obejmują tylko napisy zbyt długie, by
+ * zmieściły się w węźle; krótsze wliczane są do @p node_bytes.
+ */
+struct PhoneForwardStats {
+    size_t nodes;           ///< Liczba węzłów drzewa przekierowań, z korzeniem
+    size_t rules;           ///< Liczba przekierowań
+    size_t max_depth;       ///< Największa głębokość węzła
+    size_t depth_sum;       ///< Suma głębokości węzłów przechowujących przekierowania
+    size_t node_bytes;      ///< Pamięć węzłów i ich tablic dzieci
+    size_t key_bytes;       ///< Pamięć długich kluczy
+    size_t target_bytes;    ///< Pamięć długich przekierowań
+    size_t reverse_nodes;   ///< Liczba węzłów indeksu odwrotnego
+    size_t reverse_bytes;   ///< Pamięć węzłów i napisów indeksu odwrotnego
+    size_t reserved_bytes;  ///< Pamięć zajęta przez alokatory bazy, łącznie z wolnymi blokami
+    size_t children[NUMBER_OF_DIGITS + 1]; ///< @p children[k] to liczba węzłów drzewa przekierowań mających k dzieci
+};
+
+/** @brief Wyznacza statystyki bazy przekierowań.
+ * Przegląda całe drzewo przekierowań i indeks odwrotny, więc działa w czasie
+ * liniowym względem rozmiaru bazy.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[out] stats – miejsce na statystyki.
+ * @return Wartość @p true, jeśli się udało. Wartość @p false, jeśli @p pf ma
+ *         wartość NULL lub nie udało się zaalokować pamięci.
+ */
+bool phfwdStats(struct PhoneForward const *pf, struct PhoneForwardStats *stats);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza wszystkie przekierowania na podany numer. Wynikowy ciąg zawiera też
  * dany numer. Wynikowe numery są posortowane leksykograficznie i nie mogą się
@@ -96,6 +233,121 @@ struct PhoneNumbers const *phfwdGet(struct PhoneForward *pf, char const *num);
  */
 struct PhoneNumbers const *phfwdReverse(struct PhoneForward *pf, char const *num);
 
+/** @brief Wyznacza przekierowania na dany numer, korzystając z wielu wątków.
+ * Daje ten sam wynik co @ref phfwdReverse. Drzewa numerów przekierowanych na
+ * prefiksy @p num dzielone są na poddrzewa przeglądane przez osobne wątki;
+ * każdy wątek zbiera i sortuje własne wyniki, które są na końcu scalane
+ * z pominięciem powtórzeń. Niewielkie wyniki wyznaczane są bez tworzenia wątków.
+ * Wątki należą do jednej puli wspólnej dla całego procesu, tworzonej przy
+ * pierwszym potrzebującym jej wywołaniu; gdy pula jest zajęta przez inne
+ * wywołanie, wynik wyznacza wątek wywołujący. Funkcja nie zmienia bazy.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num     – wskaźnik na napis reprezentujący numer;
+ * @param[in] workers – największa liczba wątków; 0 lub liczba większa od
+ *                      liczby procesorów oznacza liczbę procesorów.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdReverseParallel(struct PhoneForward *pf,
+                                                char const *num, size_t workers);
+
+/** @brief Rozpoczyna przeglądanie przekierowań na dany numer.
+ * Tworzy kursor, który wydaje kolejno, w porządku leksykograficznym i bez
+ * powtórzeń, te same numery co @ref phfwdReverse, nie zbierając ich naraz.
+ * Kursor wyznacza tylko wydawane numery, więc pierwsza strona wyniku jest
+ * tania także dla popularnych numerów. Baza nie może być zmieniana, dopóki
+ * kursor nie zostanie zamknięty funkcją @ref phfwdReverseEnd.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num         – wskaźnik na napis reprezentujący numer;
+ * @param[in] start_after – wskaźnik na napis; kursor wydaje tylko numery
+ *                          leksykograficznie większe od niego. Wartość NULL
+ *                          oznacza wszystkie numery;
+ * @param[in] limit       – największa liczba wydanych numerów, 0 oznacza brak
+ *                          ograniczenia.
+ * @return Wskaźnik na kursor lub NULL, gdy nie udało się zaalokować pamięci.
+ *         Jeśli @p pf ma wartość NULL lub @p num nie reprezentuje numeru,
+ *         kursor nie wyda żadnego numeru.
+ */
+struct ReverseCursor *phfwdReverseBegin(struct PhoneForward const *pf,
+                                        char const *num, char const *start_after,
+                                        size_t limit);
+
+/** @brief Wyznacza kolejne przekierowanie na numer kursora.
+ * Po osiągnięciu ograniczenia liczby numerów kursor nie przegląda już bazy.
+ * @param[in, out] cursor – wskaźnik na kursor;
+ * @param[out] number     – wskaźnik na kolejny numer, ważny do następnego
+ *                          wywołania funkcji, lub NULL, gdy numerów już nie ma.
+ * @return Wartość @p true, jeśli się udało. Wartość @p false, jeśli nie udało
+ *         się zaalokować pamięci; kursor można wtedy już tylko zamknąć.
+ */
+bool phfwdReverseNext(struct ReverseCursor *cursor, char const **number);
+
+/** @brief Zamyka kursor.
+ * Usuwa strukturę wskazywaną przez @p cursor. Nic nie robi, jeśli wskaźnik ten
+ * ma wartość NULL.
+ * @param[in] cursor – wskaźnik na usuwany kursor.
+ */
+void phfwdReverseEnd(struct ReverseCursor *cursor);
+
+/** @brief Zapisuje zrzut bazy przekierowań.
+ * Zapisuje do pliku binarny zrzut bazy, z którego @ref phfwdLoad odtwarza
+ * ją bez ponownego dodawania przekierowań. Węzły drzewa zapisywane są
+ * w porządku preorder, długości jako liczby o zmiennej długości, a cyfry
+ * po dwie na bajt.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] fd – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli zrzut został zapisany.
+ *         Wartość @p false, jeśli @p pf ma wartość NULL, wystąpił błąd zapisu
+ *         lub nie udało się zaalokować pamięci.
+ */
+bool phfwdSave(struct PhoneForward const *pf, int fd);
+
+/** @brief Odtwarza bazę przekierowań z zrzutu.
+ * Wczytuje zrzut zapisany przez @ref phfwdSave, aż do końca pliku.
+ * @param[in] fd – deskryptor pliku otwartego do odczytu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wystąpił błąd odczytu,
+ *         dane są niepoprawne lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForward *phfwdLoad(int fd);
+
+/** @brief Zamraża bazę przekierowań.
+ * Tworzy niezmienną kopię bazy, przeznaczoną wyłącznie do odpowiadania na
+ * zapytania. Węzły drzewa ułożone są wszerz w ciągłej tablicy, dzieci węzła
+ * wskazywane są przedziałem indeksów, a wszystkie klucze i przekierowania
+ * leżą w jednej puli znaków. Późniejsze zmiany @p pf nie wpływają na kopię.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy @p pf ma wartość NULL,
+ *         nie udało się zaalokować pamięci lub baza jest zbyt duża.
+ */
+struct FrozenForward *phfwdFreeze(struct PhoneForward const *pf);
+
+/** @brief Usuwa zamrożoną bazę.
+ * Usuwa strukturę wskazywaną przez @p ff. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] ff – wskaźnik na usuwaną strukturę.
+ */
+void phfwdFrozenDelete(struct FrozenForward *ff);
+
+/** @brief Wyznacza przekierowanie numeru w zamrożonej bazie.
+ * Działa jak @ref phfwdGet dla bazy, z której powstało @p ff.
+ * @param[in] ff  – wskaźnik na zamrożoną bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdFrozenGet(struct FrozenForward const *ff,
+                                          char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w zamrożonej bazie.
+ * Działa jak @ref phfwdReverse dla bazy, z której powstało @p ff.
+ * @param[in] ff  – wskaźnik na zamrożoną bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdFrozenReverse(struct FrozenForward const *ff,
+                                              char const *num);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -116,6 +368,7 @@ char const *phnumGet(struct PhoneNumbers const *pnum, size_t idx);
 
 /** @brief Wyznacza liczbę nietrywialnych numerów długości len, zawierających tylko cyfry,
  * które znajdują się w napisie set;
+ * Dużą bazę przeglądają wątki wspólnej puli, tak jak w @ref phfwdReverseParallel.
  * @param[in] pf        Struktura przekierowań dla której sprawdzamy trywialność numerów.
  * @param set           Zbiór znaków, z którego odczytujemy możliwe do użycia cyfry.
  * @param len           Długść numerów.
@@ -1,11 +1,20 @@
 //
 // Created by patryklin on 5/30/18.
 //
+#define _POSIX_C_SOURCE 200809L
+
 #include "phone_forward.h"
 #include "phone_forward_interface.h"
+#include "output.h"
+#include "query_window.h"
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 
 /**
@@ -27,27 +36,25 @@ size_t number_of_bytes = 1;
 
 /**
  * Straznik używany do sprawdzenia powodzenia alokacji pamięci.
- * Przy niepowodzeniu zwalnia zaalokowaną pamięc, oraz wypisuje komunikat o błędzie.
+ * Przy niepowodzeniu wypisuje komunikat o błędzie, który zwalnia zaalokowaną pamięć.
  */
 #define NOT_NULL(f)                                     \
     do {                                                \
         if ((f) == 0){                                  \
-            clearMemory();                              \
             printMemoryError();                         \
             }                                           \
         }                                               \
     while (0)
 
 /**
- * @brief Rozmiar tablicy baz przekierowań.
- * Zgodnie z założeniami zadania, wystarczy możliwość obsługi 100 baz danych.
+ * Początkowy rozmiar tablicy char* używanej do zapisania numeru lub identyfikatora.
  */
-#define INITIAL_DATABASE_ARRAY_SIZE 128
+#define INITIAL_NUMBER_SIZE 16
 
 /**
- * Początkowy rozmiar tablicy char* używanej do zapisania numeru lub identyfikatora.
+ * Liczba bajtów wczytywanych ze standardowego wejścia jednym wywołaniem fread.
  */
-#define INITIAL_NUMBER_SIZE 16
+#define INPUT_BLOCK_SIZE (1 << 16)
 
 
 char const AT_SIGN = '@';
@@ -62,17 +69,68 @@ char const *DOLLAR_STR = "$";
 
 char const *DEL = "DEL";
 char const *NEW = "NEW";
+char const *SAVE = "SAVE";
+char const *LOAD = "LOAD";
+char const *IMPORT = "IMPORT";
+char const *STATS = "STATS";
+
+/**
+ * Rozszerzenie pliku, do którego operacja SAVE zapisuje bazę o danej nazwie.
+ */
+char const *SNAPSHOT_EXTENSION = ".phfwd";
+
+/**
+ * Rozszerzenie pliku przekierowań, który operacja IMPORT dodaje do aktualnej bazy.
+ */
+char const *RULES_EXTENSION = ".rules";
 
 /**
- * Globalna tablica baz przekierowań.
+ * Globalna tablica baz przekierowań, indeksowana nazwami baz.
  */
-Database *Db_Array[INITIAL_DATABASE_ARRAY_SIZE];
+Registry databases;
 
 /**
  * Obecnie uzywana struktura baz danych.
  */
 Database *current_db;
 
+/**
+ * Okno kolejnych zapytań GET i REVERSE do aktualnej bazy, które nie zostały
+ * jeszcze wykonane. Wykonywane jest przed każdą inną komendą i przed
+ * wypisaniem błędu, więc wyniki pojawiają się w kolejności komend.
+ */
+QueryWindow queries;
+
+/**
+ * Bufor wejścia. Pierwszy bajt przechowuje ostatni bajt poprzedniego bloku,
+ * aby można go było oddać do strumienia także zaraz po wczytaniu nowego bloku.
+ */
+unsigned char input_buffer[1 + INPUT_BLOCK_SIZE];
+
+/**
+ * Wczytywane dane: bufor wejścia albo zmapowany w pamięci plik.
+ */
+unsigned char *input_data = input_buffer;
+
+/**
+ * Pozycja następnego bajtu do odczytania w danych wejściowych.
+ */
+size_t input_position = 0;
+
+/**
+ * Liczba bajtów w danych wejściowych.
+ */
+size_t input_end = 0;
+
+/**
+ * Czy standardowe wejście jest zwykłym plikiem, zmapowanym w całości w pamięci.
+ */
+bool input_mapped = false;
+
+/**
+ * Bufory, do których wczytywane są argumenty komend.
+ */
+ArgumentBuffer arguments[2];
 
 /**
  * Przechowuje argumenty oraz typ aktualnie wykonywanej operacji.
@@ -84,19 +142,42 @@ Command command;
  * Zwalnia pamięc zaalokowaną w trakcie działania programu.
  */
 void clearMemory() {
-    for (size_t i = 0; i < INITIAL_DATABASE_ARRAY_SIZE; i++) {
-        if ((Db_Array[i]) != NULL) {
-            phfwdDelete((Db_Array[i])->db);
-            free((void *) (Db_Array[i])->name);
-            free((void *) (Db_Array[i]));
-            Db_Array[i] = NULL;
+    for (size_t i = 0; i < databases.capacity; i++) {
+        if (databases.slots[i] != NULL) {
+            phfwdDelete(databases.slots[i]->db);
+            free((void *) databases.slots[i]->name);
+            free((void *) databases.slots[i]);
         }
     }
-    if (command.arg1 != NULL)
-        free((void *) (command.arg1));
+    registryFree(&databases);
+    current_db = NULL;
+    for (size_t i = 0; i < sizeof(arguments) / sizeof(arguments[0]); i++) {
+        free((void *) arguments[i].data);
+        arguments[i].data = NULL;
+        arguments[i].size = 0;
+    }
+    command.arg1 = NULL;
+    command.arg2 = NULL;
+
+    if (input_mapped) {
+        munmap((void *) input_data, input_end);
+        input_data = input_buffer;
+        input_position = 0;
+        input_end = 0;
+        input_mapped = false;
+    }
+
+    queryWindowFree(&queries);
+}
 
-    if (command.arg2 != NULL)
-        free((void *) (command.arg2));
+static inline void printMemoryError();
+
+/**
+ * Wykonuje zapytania czekające w oknie i wypisuje ich wyniki.
+ */
+static void runQueries() {
+    if (queries.count > 0 && !queryWindowRun(&queries))
+        printMemoryError();
 }
 
 /**
@@ -104,6 +185,8 @@ void clearMemory() {
  * @param n numer znaku powodującego błąd interpretaji.
  */
 static inline void printSyntaxError(size_t n) {
+    runQueries();
+    outputFlush();
     fprintf(stderr, "ERROR %ld\n", n);
     clearMemory();
     exit(1);
@@ -113,6 +196,8 @@ static inline void printSyntaxError(size_t n) {
  * Wypisuje informację o problemie z alokacją pamięci, oraz kończąca pracę programu.
  */
 static inline void printMemoryError() {
+    runQueries();
+    outputFlush();
     fprintf(stderr, "MEMORY ERROR\n");
     clearMemory();
     exit(1);
@@ -124,6 +209,8 @@ static inline void printMemoryError() {
  * @param operator Nazwa operatora
  */
 static inline void printOperatorError(size_t n, const char *operator) {
+    runQueries();
+    outputFlush();
     fprintf(stderr, "ERROR %s %ld\n", operator, n);
     clearMemory();
     exit(1);
@@ -133,6 +220,8 @@ static inline void printOperatorError(size_t n, const char *operator) {
  * Wypisuje informację o niespodziewanym końcu danych, oraz kończąca pracę programu.
  */
 static inline void printEofError() {
+    runQueries();
+    outputFlush();
     fprintf(stderr, "ERROR EOF\n");
     clearMemory();
     exit(1);
@@ -152,12 +241,10 @@ void debugPrintCommand() {
 
 /**
  * Inicjalizuje strukturę Command.
- * Zwalnia pamięc obu jej argumentów, oraz inicjalizuje pola danych.
+ * Bufory argumentów są używane ponownie przez kolejną komendę.
  * @param command
  */
 void resetCommand() {
-    free((void *) ((command).arg1));
-    free((void *) ((command).arg2));
     (command).arg1 = NULL;
     (command).arg2 = NULL;
 
@@ -179,20 +266,117 @@ static inline void checkCorrectError(char c) {
 }
 
 /**
- * Wrapper dla funkcji ungetc, jednoczesnie obnizający liczbę wczytanych znaków.
+ * Mapuje w pamięci standardowe wejście, jeżeli jest ono zwykłym plikiem.
+ * Dla potoków i terminali nic nie robi, dane będą wtedy czytane blokami.
+ */
+static void mapInput() {
+    int fd = fileno(stdin);
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (uintmax_t) st.st_size > SIZE_MAX)
+        return;
+
+    // Wejście mogło być już częściowo przeczytane przez proces nadrzędny
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size)
+        return;
+
+    void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return;
+
+    posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+    input_data = map;
+    input_position = (size_t) offset;
+    input_end = (size_t) st.st_size;
+    input_mapped = true;
+}
+
+/**
+ * Wczytuje do bufora kolejny blok standardowego wejścia.
+ * @return True, jeżeli wczytano co najmniej jeden bajt, false na końcu danych.
+ */
+static bool fillInput() {
+    // Zmapowany plik jest dostępny w całości
+    if (input_mapped)
+        return false;
+
+    unsigned char last = input_end > 0 ? input_buffer[input_end - 1] : 0;
+
+    size_t n = fread(input_buffer + 1, sizeof(char), INPUT_BLOCK_SIZE, stdin);
+    if (n == 0)
+        return false;
+
+    input_buffer[0] = last;
+    input_position = 1;
+    input_end = n + 1;
+    return true;
+}
+
+/**
+ * Oddaje znak do bufora wejścia, jednoczesnie obnizając liczbę wczytanych znaków.
+ * Tak jak ungetc, nie oddaje znaku równego EOF, również gdy był to bajt 0xFF.
  * @param c oddawany znak
  */
 static inline void ungetChar(char c) {
-    ungetc(c, stdin);
+    if (c != EOF)
+        input_position--;
     number_of_bytes--;
 }
 
 /**
- * Wrapper dla funkcji getchar, jednoczesnie zwiększający liczbę wczytanych znaków.
+ * Czyta bajt z bufora wejścia, jednoczesnie zwiększając liczbę wczytanych znaków.
  */
 static inline char readByte() {
     number_of_bytes++;
-    return getchar();
+    if (input_position == input_end && !fillInput())
+        return EOF;
+
+    return (char) input_data[input_position++];
+}
+
+/**
+ * Zapewnia, że bufor argumentu ma co najmniej @p size bajtów.
+ * @param arg Bufor argumentu
+ * @param size Wymagany rozmiar
+ */
+static void argumentReserve(ArgumentBuffer *arg, size_t size) {
+    if (size <= arg->size)
+        return;
+
+    size_t new_size = arg->size > 0 ? arg->size : INITIAL_NUMBER_SIZE;
+    while (new_size < size)
+        new_size *= 2;
+
+    char *data = realloc(arg->data, sizeof(char) * new_size);
+    NOT_NULL(data);
+    arg->data = data;
+    arg->size = new_size;
+}
+
+/**
+ * Zapisuje znak w buforze argumentu.
+ * @param arg Bufor argumentu
+ * @param at Pozycja znaku
+ * @param c Zapisywany znak
+ */
+static inline void argumentPush(ArgumentBuffer *arg, size_t at, char c) {
+    argumentReserve(arg, at + 1);
+    arg->data[at] = c;
+}
+
+/**
+ * Zapisuje ciąg znaków w buforze argumentu.
+ * @param arg Bufor argumentu
+ * @param at Pozycja pierwszego znaku
+ * @param chars Zapisywane znaki
+ * @param n Liczba znaków
+ */
+static inline void argumentAppend(ArgumentBuffer *arg, size_t at, char const *chars,
+                                  size_t n) {
+    argumentReserve(arg, at + n + 1);
+    memcpy(arg->data + at, chars, n);
 }
 
 /**
@@ -251,20 +435,28 @@ void ignoreWhiteSpaces() {
 }
 
 /**
- * Zapisuje identyfikator ze standardowego wejścia do tablicy char.
+ * Zapisuje numer ze standardowego wejścia do bufora argumentu.
+ * @param arg Bufor, do którego trafia numer.
  * @return Wskaźnik na tablicę char przechowującą wczytany numer, lub NULL jeżeli był on błędny.
  */
-char *readNumber() {
+char *readNumber(ArgumentBuffer *arg) {
     int c;
-    char *str;
     size_t len = 0;
-    size_t size = INITIAL_NUMBER_SIZE;
-    NOT_NULL(str = realloc(NULL, sizeof(char) * size));
 
-    while (EOF != (c = readByte()) && isDigitWrapper(c)) {
-        str[len++] = c;
-        if (len == size)
-            NOT_NULL(str = realloc(str, sizeof(char) * (size *= 2)));
+    if (input_mapped) {
+        // Cały plik jest w pamięci, więc numer wystarczy znaleźć i skopiować naraz
+        size_t start = input_position;
+        while (input_position < input_end &&
+               isDigitWrapper((char) input_data[input_position]))
+            input_position++;
+
+        len = input_position - start;
+        number_of_bytes += len;
+        argumentAppend(arg, 0, (char const *) input_data + start, len);
+        c = readByte();
+    } else {
+        while (EOF != (c = readByte()) && isDigitWrapper(c))
+            argumentPush(arg, len++, c);
     }
     ungetChar(c);
 
@@ -275,21 +467,19 @@ char *readNumber() {
         printSyntaxError(number_of_bytes);
     }
 
-    str[len++] = '\0';
-    NOT_NULL(str = realloc(str, sizeof(char) * len));
-    return str;
+    argumentPush(arg, len, '\0');
+    return arg->data;
 }
 
 /**
- * Zapisuje identyfikator ze standardowego wejścia do tablicy char.
+ * Zapisuje identyfikator ze standardowego wejścia do bufora argumentu.
+ * @param arg Bufor, do którego trafia identyfikator.
+ * @param len Długość identyfikatora, wliczając kończący go znak '\0'.
  * @return Wskaźnik na tablicę char przechowującą wczytany identyfikator, lub NULL jeżeli był on błędny.
  */
-char *readIdentifier(size_t (*len)) {
+char *readIdentifier(ArgumentBuffer *arg, size_t (*len)) {
     int c;
-    char *str;
     (*len) = 0;
-    size_t size = INITIAL_NUMBER_SIZE;
-    NOT_NULL(str = realloc(NULL, sizeof(char) * size));
 
     c = readByte();
 
@@ -300,65 +490,66 @@ char *readIdentifier(size_t (*len)) {
         printSyntaxError(number_of_bytes - 1);
     }
 
+    if (input_mapped) {
+        size_t start = input_position - 1;
+        while (input_position < input_end &&
+               isalnum((char) input_data[input_position]))
+            input_position++;
 
-    str[(*len)++] = c;
-    while (EOF != (c = readByte()) && isalnum(c)) {
-        str[(*len)++] = c;
-        if ((*len) == size)
-            NOT_NULL(str = realloc(str, sizeof(char) * (size *= 2)));
+        (*len) = input_position - start;
+        number_of_bytes += (*len) - 1;
+        argumentAppend(arg, 0, (char const *) input_data + start, (*len));
+        c = readByte();
+    } else {
+        argumentPush(arg, (*len)++, c);
+        while (EOF != (c = readByte()) && isalnum(c))
+            argumentPush(arg, (*len)++, c);
     }
     ungetChar(c);
 
-    if ((*len) == 0) {
-        if (c == EOF)
-            printEofError();
-
-        printSyntaxError(number_of_bytes);
-    }
-    str[(*len)++] = '\0';
+    argumentPush(arg, (*len)++, '\0');
 
-    if (strcmp(str, DEL) == 0 || strcmp(str, NEW) == 0)
+    if (strcmp(arg->data, DEL) == 0 || strcmp(arg->data, NEW) == 0)
         printSyntaxError(number_of_bytes - 3);
 
-    NOT_NULL(str = realloc(str, sizeof(char) * (*len)));
-
-    return str;
+    return arg->data;
 }
 
 
 /**
- * Zapisuje ciag znakow ze standardowego wejścia do tablicy char.
+ * Zapisuje ciag znakow ze standardowego wejścia do bufora argumentu.
+ * @param arg Bufor, do którego trafia zbiór.
+ * @param len Długość zbioru, wliczając kończący go znak '\0'.
  * @return Wskaźnik na tablicę char przechowującą wczytany zbior, lub NULL jeżeli był on błędny.
  */
-char *readSet(size_t (*len)) {
+char *readSet(ArgumentBuffer *arg, size_t (*len)) {
     int c;
-    char *str;
     (*len) = 0;
-    size_t size = INITIAL_NUMBER_SIZE;
-    NOT_NULL(str = realloc(NULL, sizeof(char) * size));
 
     c = readByte();
-
-    str[(*len)++] = c;
-    while (EOF != (c = readByte()) && c != '\n') {
-        str[(*len)++] = c;
-        if ((*len) == size)
-            NOT_NULL(str = realloc(str, sizeof(char) * (size *= 2)));
+    argumentPush(arg, (*len)++, c);
+
+    if (input_mapped) {
+        // Bajt 0xFF jest czytany jako EOF, więc również kończy zbiór
+        size_t start = input_position;
+        while (input_position < input_end && input_data[input_position] != '\n' &&
+               (char) input_data[input_position] != EOF)
+            input_position++;
+
+        argumentAppend(arg, (*len), (char const *) input_data + start,
+                       input_position - start);
+        number_of_bytes += input_position - start;
+        (*len) += input_position - start;
+        c = readByte();
+    } else {
+        while (EOF != (c = readByte()) && c != '\n')
+            argumentPush(arg, (*len)++, c);
     }
     ungetChar(c);
 
-    if ((*len) == 0) {
-        if (c == EOF)
-            printEofError();
-
-        printSyntaxError(number_of_bytes);
-    }
-
-    str[(*len)++] = '\0';
-
-    NOT_NULL(str = realloc(str, sizeof(char) * (*len)));
+    argumentPush(arg, (*len)++, '\0');
 
-    return str;
+    return arg->data;
 }
 
 /**
@@ -367,7 +558,7 @@ char *readSet(size_t (*len)) {
 void handleADigit() {
     char c;
 
-    command.arg1 = readNumber();
+    command.arg1 = readNumber(&arguments[0]);
     DEBUG_PRINT("Odczytano numer 1: %s\n", command.arg1);
 
     ignoreWhiteSpaces();
@@ -383,7 +574,7 @@ void handleADigit() {
         command.first_read_byte = number_of_bytes - 1;
 
         ignoreWhiteSpaces();
-        command.arg2 = readNumber();
+        command.arg2 = readNumber(&arguments[1]);
         DEBUG_PRINT("Odczytano numer 2: %s\n", command.arg2);
 
     } else {
@@ -400,7 +591,7 @@ void handleADigit() {
 void handleAQMark() {
     ignoreWhiteSpaces();
 
-    command.arg1 = readNumber();
+    command.arg1 = readNumber(&arguments[0]);
     command.type = REVERSE;
 }
 
@@ -411,34 +602,50 @@ void delOrNew() {
     ignoreWhiteSpaces();
 
     char c;
-    char *str;
+    char str[7];
     int i = 0;
-    NOT_NULL(str = malloc(5 * sizeof(char)));
 
 
     while (EOF != (c = readByte()) && isalpha(c) && i < 4)
         str[i++] = c;
+
+    // Dalej czytam tylko kolejne litery IMPORT lub STATS, więc pozostałe
+    // operatory rozpoznawane są tak jak dotąd
+    while (i >= 4 && i < 6 &&
+           ((strncmp(str, IMPORT, i) == 0 && c == IMPORT[i]) ||
+            (i < 5 && strncmp(str, STATS, i) == 0 && c == STATS[i]))) {
+        str[i++] = c;
+        c = readByte();
+    }
     str[i] = '\0';
 
     if (strcmp(str, NEW) == 0) {
         command.type = NEW_DB;
     } else if (strcmp(str, DEL) == 0) {
         command.type = DEL_TEMP;
+    } else if (strcmp(str, SAVE) == 0 && !isalpha(c)) {
+        command.type = SAVE_DB;
+    } else if (strcmp(str, LOAD) == 0 && !isalpha(c)) {
+        command.type = LOAD_DB;
+    } else if (strcmp(str, IMPORT) == 0 && !isalpha(c)) {
+        command.type = IMPORT_DB;
+    } else if (strcmp(str, STATS) == 0 && !isalpha(c)) {
+        command.type = STATS_DB;
     } else if (c == EOF) {
         printEofError();
     } else {
         printSyntaxError(command.first_read_byte);
     }
 
-    free((void *) str);
     ungetChar(c);
 }
 
 /**
- * Parsuje komendę, jeżeli pierwszym argumentem był operator NEW.
+ * Parsuje komendę, jeżeli pierwszym argumentem był operator NEW, SAVE, LOAD
+ * lub IMPORT.
  */
 void handleNew() {
-    command.arg1 = readIdentifier(&command.arg1_length);
+    command.arg1 = readIdentifier(&arguments[0], &command.arg1_length);
 }
 
 /**
@@ -449,11 +656,11 @@ void handleDel() {
 
     if (isDigitWrapper(c)) {
         ungetChar(c);
-        command.arg1 = readNumber();
+        command.arg1 = readNumber(&arguments[0]);
         command.type = DEL_NUM;
     } else if (isalpha(c)) {
         ungetChar(c);
-        command.arg1 = readIdentifier(&command.arg1_length);
+        command.arg1 = readIdentifier(&arguments[0], &command.arg1_length);
         command.type = DEL_ID;
     } else
         checkCorrectError(c);
@@ -465,7 +672,7 @@ void handleDel() {
 void handleAtSign() {
     ignoreWhiteSpaces();
     DEBUG_PRINT("HANDLE AT SIGN\n");
-    command.arg1 = readSet(&command.arg1_length);
+    command.arg1 = readSet(&arguments[0], &command.arg1_length);
     command.type = NON_TRIVIAL;
 }
 
@@ -477,41 +684,36 @@ void handleAtSign() {
  * @return Wskaźnik na znalezioną bazę, lub NULL jeżeli taka nie istnieje.
  */
 Database *searchForDatabase(char *name, size_t name_length) {
-    for (size_t i = 0; i < INITIAL_DATABASE_ARRAY_SIZE; i++) {
-        if ((Db_Array[i]) != NULL)
-            if (name_length == (*Db_Array[i]).name_length)
-                if (strcmp((*Db_Array[i]).name, name) == 0)
-                    return Db_Array[i];
-
-    }
-    return NULL;
+    return registryFind(&databases, name, name_length);
 }
 
 /**
- * Dodaje bazę przekierowań o zadanej nazwie, lub ustawia jako aktualnie używaną, w przypadku gdy ta już istnieje.
+ * Dodaje bazę przekierowań o zadanej nazwie i ustawia ją jako aktualnie używaną.
+ * Baza o tej nazwie nie może jeszcze istnieć.
  * @param name Nazwa poszukiwanej bazy
  * @param name_length Długość nazwy poszukiwanej bazy.
  */
 void addDatabase(char *name, size_t name_length) {
-    for (size_t i = 0; i < INITIAL_DATABASE_ARRAY_SIZE; i++) {
-        if ((Db_Array[i]) == NULL) {
-
-            NOT_NULL((Db_Array[i]) = malloc(sizeof(Database)));
-
-            char *new_name = malloc((name_length + 1) * sizeof(char));
-            strcpy(new_name, name);
-            new_name[name_length] = '\0';
-
-            Db_Array[i]->name = new_name;
-            Db_Array[i]->name_length = name_length;
-            Db_Array[i]->db = phfwdNew();
-            current_db = Db_Array[i];
-            return;
-        }
+    Database *db;
+    NOT_NULL(db = malloc(sizeof(Database)));
+
+    db->name = malloc((name_length + 1) * sizeof(char));
+    db->db = phfwdNew();
+    if (db->name != NULL) {
+        memcpy(db->name, name, name_length);
+        db->name[name_length] = '\0';
+    }
+    db->name_length = name_length;
+    db->hash = registryHash(name, name_length);
+
+    if (db->name == NULL || db->db == NULL || !registryInsert(&databases, db)) {
+        phfwdDelete(db->db);
+        free((void *) db->name);
+        free((void *) db);
+        printMemoryError();
     }
-    // Jezeli do tej pory nie dodalismy bazy danych
-    // to znaczy ze zabraklo miejsca w tablicy
-    printMemoryError();
+
+    current_db = db;
 }
 
 /**
@@ -530,21 +732,17 @@ void operationNew() {
  * Wykonuje operację DEL dla bazy przekierowań.
  */
 void operationDelDb() {
-    for (size_t i = 0; i < INITIAL_DATABASE_ARRAY_SIZE; i++)
-        if ((Db_Array[i]) != NULL &&
-            command.arg1_length == (*Db_Array[i]).name_length &&
-            strcmp((*Db_Array[i]).name, command.arg1) == 0) {
+    Database *db = registryRemove(&databases, command.arg1, command.arg1_length);
+    if (db == NULL)
+        return;
 
-            phfwdDelete((Db_Array[i])->db);
-            free((void *) (Db_Array[i])->name);
+    phfwdDelete(db->db);
+    free((void *) db->name);
 
-            if (current_db == Db_Array[i])
-                current_db = NULL;
+    if (current_db == db)
+        current_db = NULL;
 
-            free((void *) (Db_Array[i]));
-            Db_Array[i] = NULL;
-            return;
-        }
+    free((void *) db);
 }
 
 /**
@@ -573,51 +771,33 @@ void operationForward() {
 }
 
 /**
- * Wykonuje operację GET dla aktualnie zadanej bazy przekierowań.
+ * Dodaje zapytanie GET lub REVERSE dla aktualnie zadanej bazy przekierowań
+ * do okna zapytań. Pełne okno jest od razu wykonywane.
+ * @param reverse Czy jest to zapytanie REVERSE
  */
-void operationGet() {
-    bool ret = false;
-    if (current_db != NULL) {
-        struct PhoneNumbers const *pnum;
-        NOT_NULL(pnum = phfwdGet(current_db->db, command.arg1));
+static void queueQuery(bool reverse) {
+    if (current_db == NULL)
+        printOperatorError(command.first_read_byte, QMARK_STR);
 
-        printf("%s\n", phnumGet(pnum, 0));
+    NOT_NULL(queryWindowAdd(&queries, current_db->db, reverse, command.arg1,
+                            strlen(command.arg1)));
 
-        phnumDelete(pnum);
-        ret = true;
-    }
+    if (queryWindowFull(&queries))
+        runQueries();
+}
 
-    if (!ret)
-        printOperatorError(command.first_read_byte, QMARK_STR);
+/**
+ * Wykonuje operację GET dla aktualnie zadanej bazy przekierowań.
+ */
+void operationGet() {
+    queueQuery(false);
 }
 
 /**
  * Wykonuje operację REVERSE dla aktualnie zadanej bazy przekierowań.
  */
 void operationReverse() {
-    bool ret = false;
-
-    if (current_db != NULL) {
-
-        size_t idx = 0;
-        char const *num;
-        struct PhoneNumbers const *pnum;
-        NOT_NULL(pnum = phfwdReverse(current_db->db, command.arg1));
-
-        while ((num = phnumGet(pnum, idx)) != NULL) {
-            printf("%s\n", num);
-            idx++;
-        }
-
-        phnumDelete(pnum);
-
-        if (idx > 0)
-            ret = true;
-
-    }
-    if (!ret) {
-        printOperatorError(command.first_read_byte, QMARK_STR);
-    }
+    queueQuery(true);
 }
 
 /**
@@ -633,7 +813,7 @@ void operationNonTrivial() {
             len = command.arg1_length - NUMBER_OF_DIGITS - 1;
             DEBUG_PRINT("LEN = %ld\n", len);
         }
-        printf("%ld\n", phfwdNonTrivialCount(current_db->db, command.arg1, len));
+        outputNumberLine(phfwdNonTrivialCount(current_db->db, command.arg1, len));
         ret = true;
     }
     if (!ret) {
@@ -642,10 +822,280 @@ void operationNonTrivial() {
 }
 
 
+/**
+ * Tworzy nazwę pliku o nazwie z pierwszego argumentu komendy.
+ * @param extension Rozszerzenie nazwy pliku
+ * @param suffix    Dodatkowy sufiks nazwy pliku
+ * @return Nazwa pliku, którą należy zwolnić.
+ */
+static char *argumentPath(char const *extension, char const *suffix) {
+    size_t name_length = strlen(command.arg1);
+    size_t extension_length = strlen(extension);
+    size_t suffix_length = strlen(suffix);
+    char *path;
+    NOT_NULL(path = malloc(name_length + extension_length + suffix_length + 1));
+
+    memcpy(path, command.arg1, name_length);
+    memcpy(path + name_length, extension, extension_length);
+    memcpy(path + name_length + extension_length, suffix, suffix_length + 1);
+    return path;
+}
+
+/**
+ * Wykonuje operację SAVE: zapisuje zrzut bazy do pliku o nazwie bazy
+ * z rozszerzeniem SNAPSHOT_EXTENSION. Zrzut trafia najpierw do pliku
+ * tymczasowego, aby przerwany zapis nie zniszczył poprzedniego zrzutu.
+ */
+void operationSave() {
+    Database *db = searchForDatabase(command.arg1, command.arg1_length);
+    bool ret = false;
+
+    if (db != NULL) {
+        char *path = argumentPath(SNAPSHOT_EXTENSION, "");
+        char *temporary = argumentPath(SNAPSHOT_EXTENSION, ".tmp");
+
+        int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            ret = phfwdSave(db->db, fd);
+            ret = close(fd) == 0 && ret;
+            ret = ret && rename(temporary, path) == 0;
+
+            if (!ret)
+                unlink(temporary);
+        }
+
+        free((void *) temporary);
+        free((void *) path);
+    }
+
+    if (!ret)
+        printOperatorError(command.first_read_byte, SAVE);
+}
+
+/**
+ * Wykonuje operację LOAD: odtwarza bazę z pliku zapisanego przez SAVE,
+ * zastępując bazę o tej samej nazwie, i ustawia ją jako aktualnie używaną.
+ */
+void operationLoad() {
+    struct PhoneForward *pf = NULL;
+    char *path = argumentPath(SNAPSHOT_EXTENSION, "");
+
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        pf = phfwdLoad(fd);
+        close(fd);
+    }
+    free((void *) path);
+
+    if (pf == NULL)
+        printOperatorError(command.first_read_byte, LOAD);
+
+    Database *db = searchForDatabase(command.arg1, command.arg1_length);
+    if (db == NULL) {
+        addDatabase(command.arg1, command.arg1_length);
+        db = current_db;
+    }
+
+    phfwdDelete(db->db);
+    db->db = pf;
+    current_db = db;
+}
+
+/**
+ * Wczytuje cały plik przekierowań.
+ * @param[in] fd    Deskryptor pliku
+ * @param[out] size Liczba wczytanych bajtów
+ * @return Zawartość pliku zakończona znakiem '\0', którą należy zwolnić,
+ * lub NULL, gdy nie udało się odczytać pliku.
+ */
+static char *readRulesFile(int fd, size_t *size) {
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+        return NULL;
+
+    char *text;
+    NOT_NULL(text = malloc((size_t) info.st_size + 1));
+
+    *size = 0;
+    ssize_t r;
+    while (*size < (size_t) info.st_size &&
+           (r = read(fd, text + *size, (size_t) info.st_size - *size)) > 0)
+        *size += (size_t) r;
+
+    if (*size < (size_t) info.st_size) {
+        free((void *) text);
+        return NULL;
+    }
+
+    text[*size] = '\0';
+    return text;
+}
+
+/**
+ * Pomija białe znaki w zawartości pliku przekierowań.
+ * @param text  Zawartość pliku
+ * @param size  Rozmiar zawartości
+ * @param i     Pozycja, od której pomijam
+ * @return Pozycja pierwszego znaku, który nie jest biały.
+ */
+static size_t skipRulesSpaces(char const *text, size_t size, size_t i) {
+    while (i < size && isspace((unsigned char) text[i]))
+        i++;
+
+    return i;
+}
+
+/**
+ * Dzieli zawartość pliku przekierowań na pary numerów. Każda reguła ma postać
+ * num1 > num2, tak jak komenda przekierowania, a reguły i ich części mogą być
+ * rozdzielone białymi znakami. Numery są kończone znakiem '\0' w miejscu.
+ * @param[in] text      Zawartość pliku, zakończona znakiem '\0'
+ * @param[in] size      Rozmiar zawartości
+ * @param[out] nums1    Tablica prefiksów przekierowywanych, którą należy zwolnić
+ * @param[out] nums2    Tablica prefiksów, na które przekierowuję, którą należy zwolnić
+ * @return Liczba reguł lub SIZE_MAX, gdy plik nie jest poprawny.
+ */
+static size_t parseRules(char *text, size_t size, char ***nums1,
+                         char ***nums2) {
+    // Najkrótsza reguła ma trzy znaki
+    NOT_NULL(*nums1 = malloc((size / 3 + 1) * sizeof(char *)));
+    NOT_NULL(*nums2 = malloc((size / 3 + 1) * sizeof(char *)));
+
+    size_t count = 0;
+    size_t i = skipRulesSpaces(text, size, 0);
+    while (i < size) {
+        size_t start1 = i;
+        while (i < size && isDigitWrapper(text[i]))
+            i++;
+        size_t end1 = i;
+
+        i = skipRulesSpaces(text, size, i);
+        if (end1 == start1 || i == size || text[i] != R_ARROW)
+            return SIZE_MAX;
+
+        size_t start2 = skipRulesSpaces(text, size, i + 1);
+        i = start2;
+        while (i < size && isDigitWrapper(text[i]))
+            i++;
+        if (i == start2 || (i < size && !isspace((unsigned char) text[i])))
+            return SIZE_MAX;
+
+        text[end1] = '\0';
+        text[i] = '\0';
+        if (strcmp(text + start1, text + start2) == 0)
+            return SIZE_MAX;
+
+        (*nums1)[count] = text + start1;
+        (*nums2)[count] = text + start2;
+        count++;
+
+        i = skipRulesSpaces(text, size, i + 1 < size ? i + 1 : size);
+    }
+
+    return count;
+}
+
+/**
+ * Wykonuje operację IMPORT: dodaje do aktualnej bazy naraz wszystkie
+ * przekierowania z pliku o nazwie z argumentu i rozszerzeniu RULES_EXTENSION.
+ * Przy błędzie baza nie jest zmieniana.
+ */
+void operationImport() {
+    char *text = NULL;
+    size_t size = 0;
+
+    if (current_db != NULL) {
+        char *path = argumentPath(RULES_EXTENSION, "");
+        int fd = open(path, O_RDONLY);
+        free((void *) path);
+
+        if (fd >= 0) {
+            text = readRulesFile(fd, &size);
+            close(fd);
+        }
+    }
+
+    char **nums1 = NULL;
+    char **nums2 = NULL;
+    size_t count = text != NULL ? parseRules(text, size, &nums1, &nums2)
+                                : SIZE_MAX;
+
+    bool ret = count != SIZE_MAX &&
+               phfwdAddBulk(current_db->db, (char const *const *) nums1,
+                            (char const *const *) nums2, count);
+
+    free((void *) nums1);
+    free((void *) nums2);
+    free((void *) text);
+
+    if (count == SIZE_MAX)
+        printOperatorError(command.first_read_byte, IMPORT);
+
+    // Reguły są poprawne, więc zabrakło pamięci
+    NOT_NULL(ret);
+}
+
+/**
+ * Wypisuje wiersz statystyki: jej nazwę i wartość.
+ * @param name  Nazwa statystyki
+ * @param value Wartość statystyki
+ */
+static void printStat(char const *name, size_t value) {
+    char line[64];
+    snprintf(line, sizeof(line), "%s %zu", name, value);
+    outputLine(line);
+}
+
+/**
+ * Wykonuje operację STATS: wypisuje rozmiar i kształt aktualnej bazy,
+ * po jednej statystyce w wierszu. Średnia głębokość wypisywana jest
+ * z dwoma miejscami po przecinku, a ostatni wiersz to liczby węzłów
+ * mających kolejno od 0 do NUMBER_OF_DIGITS dzieci.
+ */
+void operationStats() {
+    if (current_db == NULL) {
+        printOperatorError(command.first_read_byte, STATS);
+        return;
+    }
+
+    struct PhoneForwardStats stats;
+    NOT_NULL(phfwdStats(current_db->db, &stats));
+
+    // Średnią liczę w setnych częściach, bez arytmetyki zmiennoprzecinkowej
+    size_t average = stats.rules > 0 ?
+                     (100 * stats.depth_sum + stats.rules / 2) / stats.rules : 0;
+    char line[64];
+
+    printStat("nodes", stats.nodes);
+    printStat("rules", stats.rules);
+    printStat("max_depth", stats.max_depth);
+    snprintf(line, sizeof(line), "avg_depth %zu.%02zu", average / 100,
+             average % 100);
+    outputLine(line);
+    printStat("node_bytes", stats.node_bytes);
+    printStat("key_bytes", stats.key_bytes);
+    printStat("target_bytes", stats.target_bytes);
+    printStat("reverse_nodes", stats.reverse_nodes);
+    printStat("reverse_bytes", stats.reverse_bytes);
+    printStat("reserved_bytes", stats.reserved_bytes);
+
+    outputWrite("children", strlen("children"));
+    for (size_t k = 0; k <= NUMBER_OF_DIGITS; k++) {
+        snprintf(line, sizeof(line), " %zu", stats.children[k]);
+        outputWrite(line, strlen(line));
+    }
+    outputWrite("\n", 1);
+}
+
 /**
  * Wywołuje funkcję wykonującą operację zadaną przez typ komendy.
+ * Zapytania GET i REVERSE trafiają do okna zapytań, a przed każdą inną
+ * komendą okno jest wykonywane.
  */
 void runCommand() {
+    if (command.type != GET && command.type != REVERSE)
+        runQueries();
+
     switch (command.type) {
         case NEW_DB:
             operationNew();
@@ -668,6 +1118,18 @@ void runCommand() {
         case NON_TRIVIAL:
             operationNonTrivial();
             break;
+        case SAVE_DB:
+            operationSave();
+            break;
+        case LOAD_DB:
+            operationLoad();
+            break;
+        case IMPORT_DB:
+            operationImport();
+            break;
+        case STATS_DB:
+            operationStats();
+            break;
         default:
             break;
     }
@@ -675,48 +1137,51 @@ void runCommand() {
 
 void parseInput() {
     char c;
-    resetCommand();
-    ignoreWhiteSpaces();
 
-    c = readByte();
-    if (isDigitWrapper(c)) {
-        ungetChar(c);
-        handleADigit();
-        debugPrintCommand();
-
-    } else if (c == QMARK) {
-        command.first_read_byte = number_of_bytes - 1;
-        handleAQMark();
-        debugPrintCommand();
-        DEBUG_PRINT("ustawiam first read byte jako %ld\n", command.first_read_byte);
+    mapInput();
 
-    } else if (c == AT_SIGN) {
-        command.first_read_byte = number_of_bytes - 1;
-        handleAtSign();
-        debugPrintCommand();
-        DEBUG_PRINT("ustawiam first read byte jako %ld\n", command.first_read_byte);
-
-    } else if (isalpha(c)) {
-        command.first_read_byte = number_of_bytes - 1;
-
-        ungetChar(c);
-        delOrNew();
+    do {
+        resetCommand();
         ignoreWhiteSpaces();
 
-        if (command.type == NEW_DB)
-            handleNew();
-
-        if (command.type == DEL_TEMP)
-            handleDel();
-
-        debugPrintCommand();
-    } else if (c != EOF)
-        printSyntaxError(number_of_bytes - 1);
-
-    runCommand();
-
-    if (c != EOF)
-        parseInput();
+        c = readByte();
+        if (isDigitWrapper(c)) {
+            ungetChar(c);
+            handleADigit();
+            debugPrintCommand();
+
+        } else if (c == QMARK) {
+            command.first_read_byte = number_of_bytes - 1;
+            handleAQMark();
+            debugPrintCommand();
+            DEBUG_PRINT("ustawiam first read byte jako %ld\n", command.first_read_byte);
+
+        } else if (c == AT_SIGN) {
+            command.first_read_byte = number_of_bytes - 1;
+            handleAtSign();
+            debugPrintCommand();
+            DEBUG_PRINT("ustawiam first read byte jako %ld\n", command.first_read_byte);
+
+        } else if (isalpha(c)) {
+            command.first_read_byte = number_of_bytes - 1;
+
+            ungetChar(c);
+            delOrNew();
+            ignoreWhiteSpaces();
+
+            if (command.type == NEW_DB || command.type == SAVE_DB ||
+                command.type == LOAD_DB || command.type == IMPORT_DB)
+                handleNew();
+
+            if (command.type == DEL_TEMP)
+                handleDel();
+
+            debugPrintCommand();
+        } else if (c != EOF)
+            printSyntaxError(number_of_bytes - 1);
+
+        runCommand();
+    } while (c != EOF);
 }
 
 
@@ -5,6 +5,8 @@
 #ifndef TELEFONY_PHONE_FORWARD_INTERFACE_H
 #define TELEFONY_PHONE_FORWARD_INTERFACE_H
 
+#include "database_registry.h"
+
 /**
  * Używany do identyfikacji operatorów
  */
@@ -17,7 +19,11 @@ typedef enum operator_enum {
     GET = 5,
     REVERSE = 6,
     IGNORE = 7,
-    NON_TRIVIAL = 8
+    NON_TRIVIAL = 8,
+    SAVE_DB = 9,
+    LOAD_DB = 10,
+    IMPORT_DB = 11,
+    STATS_DB = 12
 } Operator_enum;
 
 /**
@@ -25,22 +31,21 @@ typedef enum operator_enum {
  */
 typedef struct command {
     Operator_enum type;     ///< Typ operacji do wykonania.
-    char *arg1;             ///< Pierwszy argument.
-    char *arg2;             ///< Drugi argument.
+    char *arg1;             ///< Pierwszy argument, wskazuje na bufor argumentu lub NULL.
+    char *arg2;             ///< Drugi argument, wskazuje na bufor argumentu lub NULL.
 
     size_t arg1_length;     ///< Długość pierwszego argumentu.
     size_t first_read_byte; ///< Numer pierwszego znaku operatora.
 } Command;
 
 /**
- * Przechowuje dane bazy przekierowań
+ * Bufor wielokrotnego użytku, do którego wczytywany jest argument komendy.
+ * Rośnie w miarę potrzeby i nie jest zwalniany między komendami.
  */
-typedef struct database {
-    struct PhoneForward *db;    ///< Wskaźnik na strukture PhoneForward.
-    char *name;                 ///< Nazwa bazy przekierowań.
-    size_t name_length;         ///< Długość nazwy bazy pzekierowań.
-
-} Database;
+typedef struct argument_buffer {
+    char *data;     ///< Wczytany argument zakończony '\0'.
+    size_t size;    ///< Rozmiar bufora.
+} ArgumentBuffer;
 
 /**
  * Funkcja parsująca dane wejściowe, oraz na bieżąco wykonująca zadane komendy.
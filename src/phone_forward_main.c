@@ -4,9 +4,11 @@
 
 #include "phone_forward.h"
 #include "phone_forward_interface.h"
+#include "output.h"
 
 int main() {
     parseInput();
+    outputFlush();
     clearMemory();
 
     return 0;
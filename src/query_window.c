@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "phone_forward.h"
+#include "output.h"
+#include "query_window.h"
+
+/**
+ * Zapewnia, że w buforze wyników jest miejsce na co najmniej @p n kolejnych bajtów.
+ * @param out   Bufor wyników
+ * @param n     Liczba bajtów
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool outputReserve(WorkerOutput *out, size_t n) {
+    if (out->capacity - out->size >= n)
+        return true;
+
+    size_t capacity = out->capacity > 0 ? out->capacity : 256;
+    while (capacity - out->size < n)
+        capacity *= 2;
+
+    char *data = realloc(out->data, capacity);
+    if (data == NULL)
+        return false;
+
+    out->data = data;
+    out->capacity = capacity;
+    return true;
+}
+
+/**
+ * Dopisuje do bufora wyników przekierowanie numeru i znak nowej linii.
+ * @param pf    Baza przekierowań
+ * @param num   Numer
+ * @param out   Bufor wyników
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool appendGet(struct PhoneForward *pf, char const *num, WorkerOutput *out) {
+    if (!outputReserve(out, 1))
+        return false;
+
+    size_t length = phfwdGetInto(pf, num, out->data + out->size,
+                                 out->capacity - out->size);
+
+    if (length >= out->capacity - out->size) {
+        if (!outputReserve(out, length + 1))
+            return false;
+        phfwdGetInto(pf, num, out->data + out->size, out->capacity - out->size);
+    }
+
+    // Na miejscu kończącego '\0' stawiam znak nowej linii
+    out->data[out->size + length] = '\n';
+    out->size += length + 1;
+    return true;
+}
+
+/**
+ * Dopisuje do bufora wyników przekierowania na numer, każde w osobnej linii.
+ * Zapisuje co najwyżej QUERY_WINDOW_REVERSE_PAGE numerów, a kursor
+ * pozostałych przekazuje do wypisania w kolejności zapytań.
+ * @param pf    Baza przekierowań
+ * @param num   Numer
+ * @param out   Bufor wyników
+ * @param rest  Kursor pozostałych numerów lub NULL, gdy wynik jest kompletny
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+static bool appendReverse(struct PhoneForward *pf, char const *num,
+                          WorkerOutput *out, struct ReverseCursor **rest) {
+    struct ReverseCursor *cursor = phfwdReverseBegin(pf, num, NULL, 0);
+    if (cursor == NULL)
+        return false;
+
+    bool success = true;
+    char const *number;
+    size_t count = 0;
+    while (count < QUERY_WINDOW_REVERSE_PAGE &&
+           (success = phfwdReverseNext(cursor, &number)) && number != NULL) {
+        size_t length = strlen(number);
+        success = outputReserve(out, length + 1);
+        if (!success)
+            break;
+
+        memcpy(out->data + out->size, number, length);
+        out->data[out->size + length] = '\n';
+        out->size += length + 1;
+        count++;
+    }
+
+    if (success && count == QUERY_WINDOW_REVERSE_PAGE) {
+        *rest = cursor;
+        return true;
+    }
+
+    phfwdReverseEnd(cursor);
+    return success;
+}
+
+/**
+ * Wykonuje zapytanie okna, zapisując wynik w buforze wykonawcy.
+ * @param context   Okno
+ * @param worker    Numer wykonawcy
+ * @param index     Numer zapytania
+ */
+static void runQuery(void *context, size_t worker, size_t index) {
+    QueryWindow *w = context;
+    PendingQuery *q = &w->queries[index];
+    WorkerOutput *out = &w->outputs[worker];
+    char const *num = w->arguments + q->argument;
+
+    q->worker = worker;
+    q->output = out->size;
+    q->rest = NULL;
+
+    bool success = q->reverse ? appendReverse(w->pf, num, out, &q->rest)
+                              : appendGet(w->pf, num, out);
+
+    q->output_length = success ? out->size - q->output : SIZE_MAX;
+    if (!success)
+        out->size = q->output;
+}
+
+void queryWindowIni(QueryWindow *w) {
+    w->pf = NULL;
+    w->queries = NULL;
+    w->count = 0;
+    w->arguments = NULL;
+    w->arguments_size = 0;
+    w->arguments_capacity = 0;
+
+    for (size_t i = 0; i < WORKER_POOL_MAX_WORKERS; i++) {
+        w->outputs[i].data = NULL;
+        w->outputs[i].size = 0;
+        w->outputs[i].capacity = 0;
+    }
+}
+
+bool queryWindowAdd(QueryWindow *w, struct PhoneForward *pf, bool reverse,
+                    char const *num, size_t length) {
+    if (w->queries == NULL) {
+        w->queries = malloc(QUERY_WINDOW_CAPACITY * sizeof(PendingQuery));
+        if (w->queries == NULL)
+            return false;
+    }
+
+    if (w->arguments_capacity - w->arguments_size < length + 1) {
+        size_t capacity = w->arguments_capacity > 0 ? w->arguments_capacity : 1024;
+        while (capacity - w->arguments_size < length + 1)
+            capacity *= 2;
+
+        char *arguments = realloc(w->arguments, capacity);
+        if (arguments == NULL)
+            return false;
+
+        w->arguments = arguments;
+        w->arguments_capacity = capacity;
+    }
+
+    PendingQuery *q = &w->queries[w->count++];
+    q->reverse = reverse;
+    q->argument = w->arguments_size;
+    memcpy(w->arguments + w->arguments_size, num, length);
+    w->arguments[w->arguments_size + length] = '\0';
+    w->arguments_size += length + 1;
+    w->pf = pf;
+
+    return true;
+}
+
+bool queryWindowFull(QueryWindow const *w) {
+    return w->count == QUERY_WINDOW_CAPACITY;
+}
+
+bool queryWindowRun(QueryWindow *w) {
+    // Bez puli, także gdy jest zajęta, zapytania wykonuje wątek wywołujący
+    WorkerPool *pool = NULL;
+    if (w->count >= QUERY_WINDOW_PARALLEL_THRESHOLD)
+        pool = workerPoolAcquire();
+
+    workerPoolRun(pool, w->count, runQuery, w);
+    workerPoolRelease(pool);
+
+    bool success = true;
+    char const *number;
+    for (size_t i = 0; success && i < w->count; i++) {
+        PendingQuery const *q = &w->queries[i];
+        success = q->output_length != SIZE_MAX;
+        if (success)
+            outputWrite(w->outputs[q->worker].data + q->output, q->output_length);
+
+        // Resztę długiego wyniku wypisuję od razu, bez zapisywania w buforze
+        while (success && q->rest != NULL &&
+               (success = phfwdReverseNext(q->rest, &number)) && number != NULL)
+            outputLine(number);
+    }
+
+    for (size_t i = 0; i < w->count; i++)
+        phfwdReverseEnd(w->queries[i].rest);
+
+    w->count = 0;
+    w->arguments_size = 0;
+    for (size_t i = 0; i < WORKER_POOL_MAX_WORKERS; i++)
+        w->outputs[i].size = 0;
+
+    return success;
+}
+
+void queryWindowFree(QueryWindow *w) {
+    for (size_t i = 0; i < WORKER_POOL_MAX_WORKERS; i++)
+        free((void *) w->outputs[i].data);
+
+    free((void *) w->queries);
+    free((void *) w->arguments);
+    queryWindowIni(w);
+}
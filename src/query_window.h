@@ -0,0 +1,115 @@
+/** @file
+ * Interfejs okna zapytań: ciągu kolejnych komend tylko do odczytu,
+ * wykonywanych równolegle, których wyniki wypisywane są w kolejności komend
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_QUERY_WINDOW_H
+#define TELEFONY_QUERY_WINDOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "worker_pool.h"
+
+/**
+ * Największa liczba zapytań w oknie. Pełne okno jest wykonywane od razu,
+ * co ogranicza pamięć zajmowaną przez argumenty i wyniki.
+ */
+#define QUERY_WINDOW_CAPACITY 4096
+
+/**
+ * Najmniejsza liczba zapytań, dla której okno wykonywane jest przez pulę wątków;
+ * krótsze okna taniej jest wykonać w bieżącym wątku.
+ */
+#define QUERY_WINDOW_PARALLEL_THRESHOLD 64
+
+/**
+ * Liczba numerów wyniku zapytania "? num" zapisywanych w buforze wykonawcy.
+ * Pozostałe numery wypisywane są wprost z kursora, więc bufory nie rosną
+ * razem z wynikiem.
+ */
+#define QUERY_WINDOW_REVERSE_PAGE 1024
+
+/**
+ * Zapytanie czekające w oknie.
+ */
+typedef struct pending_query {
+    bool reverse;           ///< Czy jest to zapytanie "? num", a nie "num ?"
+    size_t argument;        ///< Początek numeru w tablicy argumentów okna
+    size_t worker;          ///< Wykonawca, który wyznaczył wynik
+    size_t output;          ///< Początek wyniku w buforze wykonawcy
+    size_t output_length;   ///< Długość wyniku lub SIZE_MAX, gdy się nie udało
+    struct ReverseCursor *rest; ///< Kursor pozostałych numerów wyniku lub NULL
+} PendingQuery;
+
+/**
+ * Bufor, do którego wykonawca dopisuje wyniki kolejnych zapytań.
+ */
+typedef struct worker_output {
+    char *data;         ///< Wyniki
+    size_t size;        ///< Liczba zajętych bajtów
+    size_t capacity;    ///< Rozmiar bufora
+} WorkerOutput;
+
+/**
+ * Okno zapytań do jednej bazy przekierowań. Bufory okna są używane ponownie
+ * przez kolejne okna.
+ */
+typedef struct query_window {
+    struct PhoneForward *pf;    ///< Baza, do której odnoszą się zapytania
+
+    PendingQuery *queries;      ///< Zapytania w kolejności komend
+    size_t count;               ///< Liczba zapytań
+
+    char *arguments;            ///< Numery zapytań, każdy zakończony '\0'
+    size_t arguments_size;      ///< Liczba zajętych bajtów tablicy @p arguments
+    size_t arguments_capacity;  ///< Rozmiar tablicy @p arguments
+
+    WorkerOutput outputs[WORKER_POOL_MAX_WORKERS];  ///< Bufory wyników wykonawców
+} QueryWindow;
+
+/**
+ * Inicjalizuje puste okno. Duże okna wykonuje wspólna pula wątków.
+ * @param w Okno
+ */
+void queryWindowIni(QueryWindow *w);
+
+/**
+ * Dodaje zapytanie do okna. Wszystkie zapytania okna muszą dotyczyć tej samej bazy.
+ * @param w         Okno
+ * @param pf        Baza przekierowań
+ * @param reverse   Czy jest to zapytanie "? num"
+ * @param num       Numer
+ * @param length    Długość numeru
+ * @return True, jeżeli się udało, false gdy nie udało się zaalokować pamięci.
+ */
+bool queryWindowAdd(QueryWindow *w, struct PhoneForward *pf, bool reverse,
+                    char const *num, size_t length);
+
+/**
+ * Sprawdza, czy okno jest pełne i należy je wykonać.
+ * @param w Okno
+ * @return True, jeżeli okno zawiera QUERY_WINDOW_CAPACITY zapytań.
+ */
+bool queryWindowFull(QueryWindow const *w);
+
+/**
+ * Wykonuje zapytania okna i wypisuje ich wyniki w kolejności dodania,
+ * po czym opróżnia okno.
+ * @param w Okno
+ * @return True, jeżeli się udało. False, gdy dla któregoś zapytania nie udało
+ *         się zaalokować pamięci; wypisane są wtedy tylko wyniki zapytań
+ *         poprzedzających je.
+ */
+bool queryWindowRun(QueryWindow *w);
+
+/**
+ * Kończy wątki okna i zwalnia jego pamięć.
+ * @param w Okno
+ */
+void queryWindowFree(QueryWindow *w);
+
+#endif //TELEFONY_QUERY_WINDOW_H
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "epoch.h"
+#include "forward_version.h"
+#include "shared_forward.h"
+
+/**
+ * @struct SharedForward shared_forward.h
+ * @details Piszący tworzy z najnowszej wersji bazy kolejną, kopiując tylko
+ * węzły na zmienianych ścieżkach, i publikuje ją, podmieniając atomowo
+ * wskaźnik @p current. Czytelnicy odpytują opublikowaną wersję, która nigdy
+ * się nie zmienia; zastąpiona wersja, razem z węzłami nieużywanymi przez
+ * następną, jest zwalniana dopiero, gdy opuszczą ją wszyscy czytelnicy.
+ */
+struct SharedForward {
+    struct PhoneForward *pf;                        ///< Baza, z której pochodzą węzły wersji
+    _Atomic(struct PhoneForwardVersion *) current;  ///< Ostatnio opublikowana wersja bazy
+    pthread_mutex_t writer;                         ///< Blokada szeregująca zmiany
+    EpochDomain epochs;                             ///< Domena epok czytelników
+};
+typedef struct SharedForward SharedForward; ///< domyślny typedef
+
+/**
+ * Zwalnia wersję bazy wycofaną przez domenę epok.
+ * @param version Wersja bazy
+ */
+static void releaseVersion(void *version) {
+    phfwdVersionDelete((struct PhoneForwardVersion *) version);
+}
+
+/**
+ * Publikuje nową wersję bazy. Wywoływana pod blokadą piszącego.
+ * @param sf    Współdzielona baza
+ * @param next  Nowa wersja lub NULL, gdy baza się nie zmieniła
+ */
+static void publish(SharedForward *sf, struct PhoneForwardVersion *next) {
+    if (next == NULL)
+        return;
+
+    epochRetire(&sf->epochs, atomic_exchange(&sf->current, next), releaseVersion);
+    epochReclaim(&sf->epochs);
+}
+
+SharedForward *phfwdSharedNew(void) {
+    SharedForward *sf = malloc(sizeof(SharedForward));
+    if (sf == NULL)
+        return NULL;
+
+    sf->pf = phfwdNew();
+    struct PhoneForwardVersion *version = phfwdVersionNew(sf->pf);
+    if (version == NULL || pthread_mutex_init(&sf->writer, NULL) != 0) {
+        phfwdVersionDelete(version);
+        phfwdDelete(sf->pf);
+        free((void *) sf);
+        return NULL;
+    }
+
+    atomic_init(&sf->current, version);
+    epochIni(&sf->epochs);
+    return sf;
+}
+
+void phfwdSharedDelete(SharedForward *sf) {
+    if (sf == NULL)
+        return;
+
+    epochFree(&sf->epochs);
+    phfwdVersionDelete(atomic_load(&sf->current));
+    phfwdDelete(sf->pf);
+    pthread_mutex_destroy(&sf->writer);
+    free((void *) sf);
+}
+
+bool phfwdSharedAdd(SharedForward *sf, char const *num1, char const *num2) {
+    if (sf == NULL)
+        return false;
+
+    pthread_mutex_lock(&sf->writer);
+    struct PhoneForwardVersion *next = NULL;
+    bool ret = phfwdVersionAdd(atomic_load(&sf->current), num1, num2, &next);
+    publish(sf, next);
+    pthread_mutex_unlock(&sf->writer);
+
+    return ret;
+}
+
+bool phfwdSharedRemove(SharedForward *sf, char const *num) {
+    if (sf == NULL)
+        return false;
+
+    pthread_mutex_lock(&sf->writer);
+    struct PhoneForwardVersion *next = NULL;
+    bool ret = phfwdVersionRemove(atomic_load(&sf->current), num, &next);
+    publish(sf, next);
+    pthread_mutex_unlock(&sf->writer);
+
+    return ret;
+}
+
+struct PhoneNumbers const *phfwdSharedGet(SharedForward *sf, char const *num) {
+    if (sf == NULL)
+        return phfwdVersionGet(NULL, num);
+
+    size_t slot = epochEnter(&sf->epochs);
+    struct PhoneNumbers const *ret = phfwdVersionGet(atomic_load(&sf->current), num);
+    epochExit(&sf->epochs, slot);
+
+    return ret;
+}
+
+struct PhoneNumbers const *phfwdSharedReverse(SharedForward *sf, char const *num) {
+    if (sf == NULL)
+        return phfwdVersionReverse(NULL, num);
+
+    size_t slot = epochEnter(&sf->epochs);
+    struct PhoneNumbers const *ret = phfwdVersionReverse(atomic_load(&sf->current),
+                                                         num);
+    epochExit(&sf->epochs, slot);
+
+    return ret;
+}
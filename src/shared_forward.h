@@ -0,0 +1,85 @@
+/** @file
+ * Interfejs bazy przekierowań współdzielonej przez wielu czytelników
+ * i jednego piszącego
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_SHARED_FORWARD_H
+#define TELEFONY_SHARED_FORWARD_H
+
+#include <stdbool.h>
+#include "phone_forward.h"
+
+/**
+ * @struct SharedForward
+ * @brief Baza przekierowań, którą wiele wątków może odpytywać bez blokad,
+ * podczas gdy jeden wątek ją zmienia.
+ */
+struct SharedForward;
+
+/** @brief Tworzy nową współdzieloną bazę.
+ * Tworzy bazę niezawierającą żadnych przekierowań.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+struct SharedForward *phfwdSharedNew(void);
+
+/** @brief Usuwa współdzieloną bazę.
+ * Nic nie robi, jeśli @p sf ma wartość NULL. Żaden wątek nie może w tym czasie
+ * korzystać z bazy.
+ * @param[in] sf – wskaźnik na usuwaną strukturę.
+ */
+void phfwdSharedDelete(struct SharedForward *sf);
+
+/** @brief Dodaje przekierowanie.
+ * Działa jak @ref phfwdAdd, po czym publikuje nowy stan bazy. Czytelnicy
+ * widzą albo stan sprzed zmiany, albo po niej. Koszt zależy od długości
+ * numerów, a nie od rozmiaru bazy.
+ * @param[in] sf   – wskaźnik na współdzieloną bazę;
+ * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
+ *                   przekierowywanych;
+ * @param[in] num2 – wskaźnik na napis reprezentujący prefiks numerów, na które
+ *                   jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane i opublikowane
+ *         lub już istniało. Wartość @p false, jeśli nie zostało dodane; wtedy
+ *         baza się nie zmienia.
+ */
+bool phfwdSharedAdd(struct SharedForward *sf, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa jak @ref phfwdRemove, po czym publikuje nowy stan bazy, o ile
+ * cokolwiek usunięto.
+ * @param[in] sf  – wskaźnik na współdzieloną bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub nie było
+ *         czego usuwać, @p false, jeśli @p sf ma wartość NULL lub nie udało się
+ *         zaalokować pamięci; wtedy baza się nie zmienia.
+ */
+bool phfwdSharedRemove(struct SharedForward *sf, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa jak @ref phfwdGet dla ostatnio opublikowanego stanu bazy. Może być
+ * wywoływana współbieżnie z innymi funkcjami odczytu i zmianami bazy.
+ * @param[in] sf  – wskaźnik na współdzieloną bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdSharedGet(struct SharedForward *sf,
+                                          char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa jak @ref phfwdReverse dla ostatnio opublikowanego stanu bazy. Może być
+ * wywoływana współbieżnie z innymi funkcjami odczytu i zmianami bazy.
+ * @param[in] sf  – wskaźnik na współdzieloną bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const *phfwdSharedReverse(struct SharedForward *sf,
+                                              char const *num);
+
+#endif //TELEFONY_SHARED_FORWARD_H
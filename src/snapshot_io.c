@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "phone_forward.h"
+#include "snapshot_io.h"
+
+/**
+ * Zapisuje cały bufor do deskryptora, ponawiając częściowe zapisy.
+ * @param w Struktura zapisu
+ */
+static void flushWriter(SnapshotWriter *w) {
+    size_t written = 0;
+    while (!w->failed && written < w->size) {
+        ssize_t n = write(w->fd, w->buffer + written, w->size - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            w->failed = true;
+        else
+            written += (size_t) n;
+    }
+
+    w->size = 0;
+}
+
+/**
+ * Wczytuje do bufora kolejny fragment danych.
+ * @param r Struktura odczytu
+ * @return True, jeżeli wczytano co najmniej jeden bajt, false przy błędzie lub końcu danych.
+ */
+static bool fillReader(SnapshotReader *r) {
+    ssize_t n;
+    do {
+        n = read(r->fd, r->buffer, SNAPSHOT_BUFFER_SIZE);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return false;
+
+    r->position = 0;
+    r->end = (size_t) n;
+    return true;
+}
+
+/**
+ * Odczytuje jeden bajt.
+ * @param r Struktura odczytu
+ * @param byte Odczytany bajt
+ * @return True, jeżeli się udało, false przy błędzie lub końcu danych.
+ */
+static inline bool readByte(SnapshotReader *r, unsigned char *byte) {
+    if (r->position == r->end && !fillReader(r))
+        return false;
+
+    *byte = r->buffer[r->position++];
+    return true;
+}
+
+void snapshotWriterIni(SnapshotWriter *w, int fd) {
+    w->fd = fd;
+    w->size = 0;
+    w->failed = false;
+}
+
+void snapshotWriteBytes(SnapshotWriter *w, void const *bytes, size_t n) {
+    unsigned char const *data = bytes;
+
+    while (n > 0 && !w->failed) {
+        if (w->size == SNAPSHOT_BUFFER_SIZE)
+            flushWriter(w);
+
+        size_t chunk = SNAPSHOT_BUFFER_SIZE - w->size;
+        if (chunk > n)
+            chunk = n;
+
+        memcpy(w->buffer + w->size, data, chunk);
+        w->size += chunk;
+        data += chunk;
+        n -= chunk;
+    }
+}
+
+void snapshotWriteVarint(SnapshotWriter *w, size_t value) {
+    unsigned char bytes[(sizeof(size_t) * 8 + 6) / 7];
+    size_t n = 0;
+
+    do {
+        bytes[n] = (unsigned char) (value & 0x7F);
+        value >>= 7;
+        if (value > 0)
+            bytes[n] |= 0x80;
+        n++;
+    } while (value > 0);
+
+    snapshotWriteBytes(w, bytes, n);
+}
+
+void snapshotWriteDigits(SnapshotWriter *w, char const *digits, size_t n) {
+    unsigned char packed[256];
+
+    while (n > 0) {
+        size_t chunk = n < 2 * sizeof(packed) ? n : 2 * sizeof(packed);
+
+        for (size_t i = 0; i < chunk; i += 2) {
+            unsigned char high = (unsigned char) (digits[i] - '0');
+            unsigned char low = i + 1 < chunk ? (unsigned char) (digits[i + 1] - '0') : 0;
+            packed[i / 2] = (unsigned char) (high << 4 | low);
+        }
+
+        snapshotWriteBytes(w, packed, (chunk + 1) / 2);
+        digits += chunk;
+        n -= chunk;
+    }
+}
+
+bool snapshotWriterFinish(SnapshotWriter *w) {
+    flushWriter(w);
+    return !w->failed;
+}
+
+void snapshotReaderIni(SnapshotReader *r, int fd) {
+    r->fd = fd;
+    r->position = 0;
+    r->end = 0;
+}
+
+bool snapshotReadBytes(SnapshotReader *r, void *bytes, size_t n) {
+    unsigned char *data = bytes;
+
+    while (n > 0) {
+        if (r->position == r->end && !fillReader(r))
+            return false;
+
+        size_t chunk = r->end - r->position;
+        if (chunk > n)
+            chunk = n;
+
+        memcpy(data, r->buffer + r->position, chunk);
+        r->position += chunk;
+        data += chunk;
+        n -= chunk;
+    }
+
+    return true;
+}
+
+bool snapshotReadVarint(SnapshotReader *r, size_t *value) {
+    size_t result = 0;
+    unsigned int shift = 0;
+    unsigned char byte;
+
+    do {
+        if (shift >= sizeof(size_t) * 8 || !readByte(r, &byte))
+            return false;
+
+        // Bity, które nie mieszczą się w size_t, oznaczają uszkodzone dane
+        size_t part = (size_t) (byte & 0x7F);
+        if (shift > 0 && part >> (sizeof(size_t) * 8 - shift) != 0)
+            return false;
+
+        result |= part << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    *value = result;
+    return true;
+}
+
+bool snapshotReadDigits(SnapshotReader *r, char *digits, size_t n) {
+    unsigned char byte;
+
+    for (size_t i = 0; i < n; i += 2) {
+        if (!readByte(r, &byte))
+            return false;
+
+        unsigned char high = byte >> 4;
+        unsigned char low = byte & 0x0F;
+        if (high >= NUMBER_OF_DIGITS || (i + 1 < n && low >= NUMBER_OF_DIGITS))
+            return false;
+
+        digits[i] = (char) ('0' + high);
+        if (i + 1 < n)
+            digits[i + 1] = (char) ('0' + low);
+    }
+
+    return true;
+}
+
+bool snapshotReaderAtEnd(SnapshotReader *r) {
+    return r->position == r->end && !fillReader(r);
+}
@@ -0,0 +1,120 @@
+/** @file
+ * Interfejs buforowanego zapisu i odczytu binarnych zrzutów baz przekierowań
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_SNAPSHOT_IO_H
+#define TELEFONY_SNAPSHOT_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Rozmiar bufora zapisu i odczytu.
+ */
+#define SNAPSHOT_BUFFER_SIZE (1 << 16)
+
+/**
+ * Buforowany zapis do deskryptora pliku.
+ * Po pierwszym błędzie kolejne operacje nic nie robią.
+ */
+typedef struct snapshot_writer {
+    int fd;                                         ///< Deskryptor pliku
+    size_t size;                                    ///< Liczba zajętych bajtów bufora
+    bool failed;                                    ///< Czy wystąpił błąd zapisu
+    unsigned char buffer[SNAPSHOT_BUFFER_SIZE];     ///< Bufor
+} SnapshotWriter;
+
+/**
+ * Buforowany odczyt z deskryptora pliku.
+ */
+typedef struct snapshot_reader {
+    int fd;                                         ///< Deskryptor pliku
+    size_t position;                                ///< Pozycja następnego bajtu w buforze
+    size_t end;                                     ///< Liczba bajtów w buforze
+    unsigned char buffer[SNAPSHOT_BUFFER_SIZE];     ///< Bufor
+} SnapshotReader;
+
+/**
+ * Inicjalizuje zapis do deskryptora.
+ * @param w Inicjalizowana struktura
+ * @param fd Deskryptor otwarty do zapisu
+ */
+void snapshotWriterIni(SnapshotWriter *w, int fd);
+
+/**
+ * Zapisuje ciąg bajtów.
+ * @param w Struktura zapisu
+ * @param bytes Zapisywane bajty
+ * @param n Liczba bajtów
+ */
+void snapshotWriteBytes(SnapshotWriter *w, void const *bytes, size_t n);
+
+/**
+ * Zapisuje liczbę w kodowaniu o zmiennej długości: po 7 bitów na bajt,
+ * najstarszy bit bajtu oznacza, że liczba ma kolejne bajty.
+ * @param w Struktura zapisu
+ * @param value Zapisywana liczba
+ */
+void snapshotWriteVarint(SnapshotWriter *w, size_t value);
+
+/**
+ * Zapisuje cyfry po dwie na bajt, starsza połowa bajtu przechowuje
+ * wcześniejszą cyfrę.
+ * @param w Struktura zapisu
+ * @param digits Zapisywane cyfry, znaki od '0' do ';'
+ * @param n Liczba cyfr
+ */
+void snapshotWriteDigits(SnapshotWriter *w, char const *digits, size_t n);
+
+/**
+ * Zapisuje zawartość bufora.
+ * @param w Struktura zapisu
+ * @return True, jeżeli wszystkie dane zostały zapisane, false w p.p.
+ */
+bool snapshotWriterFinish(SnapshotWriter *w);
+
+/**
+ * Inicjalizuje odczyt z deskryptora.
+ * @param r Inicjalizowana struktura
+ * @param fd Deskryptor otwarty do odczytu
+ */
+void snapshotReaderIni(SnapshotReader *r, int fd);
+
+/**
+ * Odczytuje ciąg bajtów.
+ * @param r Struktura odczytu
+ * @param bytes Bufor na odczytane bajty
+ * @param n Liczba bajtów
+ * @return True, jeżeli się udało, false przy błędzie lub końcu danych.
+ */
+bool snapshotReadBytes(SnapshotReader *r, void *bytes, size_t n);
+
+/**
+ * Odczytuje liczbę zapisaną przez snapshotWriteVarint.
+ * @param r Struktura odczytu
+ * @param value Odczytana liczba
+ * @return True, jeżeli się udało, false przy błędzie, końcu danych lub zbyt dużej liczbie.
+ */
+bool snapshotReadVarint(SnapshotReader *r, size_t *value);
+
+/**
+ * Odczytuje cyfry zapisane przez snapshotWriteDigits.
+ * @param r Struktura odczytu
+ * @param digits Bufor na @p n cyfr
+ * @param n Liczba cyfr
+ * @return True, jeżeli się udało, false przy błędzie, końcu danych lub niepoprawnej cyfrze.
+ */
+bool snapshotReadDigits(SnapshotReader *r, char *digits, size_t n);
+
+/**
+ * Sprawdza, czy odczytano już wszystkie dane.
+ * @param r Struktura odczytu
+ * @return True, jeżeli nie ma więcej danych, false w p.p. lub przy błędzie.
+ */
+bool snapshotReaderAtEnd(SnapshotReader *r);
+
+#endif //TELEFONY_SNAPSHOT_IO_H
@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "worker_pool.h"
+
+/**
+ * Liczba porcji zadań przypadających średnio na wykonawcę. Więcej porcji
+ * lepiej wyrównuje pracę, mniej zmniejsza rywalizację o licznik zadań.
+ */
+#define CHUNKS_PER_WORKER 8
+
+/**
+ * Pula wspólna dla całego procesu.
+ */
+static WorkerPool shared_pool;
+
+/**
+ * Zapewnia jednokrotne utworzenie puli wspólnej.
+ */
+static pthread_once_t shared_pool_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Czy pula wspólna jest wypożyczona.
+ */
+static atomic_flag shared_pool_busy = ATOMIC_FLAG_INIT;
+
+/**
+ * Pobiera i wykonuje kolejne porcje zadań bieżącego zlecenia, dopóki jakieś zostały.
+ * @param pool      Pula
+ * @param worker    Numer wykonawcy
+ */
+static void runTasks(WorkerPool *pool, size_t worker) {
+    size_t first;
+    while ((first = atomic_fetch_add(&pool->next, pool->grain)) < pool->count) {
+        size_t last = first + pool->grain < pool->count ? first + pool->grain
+                                                        : pool->count;
+        for (size_t i = first; i < last; i++)
+            pool->task(pool->context, worker, i);
+    }
+}
+
+/**
+ * Pętla wątku pomocniczego: czeka na zlecenie, wykonuje je i zgłasza koniec pracy.
+ * @param arg Wskaźnik na opis wątku WorkerThread
+ * @return NULL
+ */
+static void *workerMain(void *arg) {
+    WorkerThread *self = arg;
+    WorkerPool *pool = self->pool;
+    size_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+
+        if (pool->stopping)
+            break;
+
+        seen = pool->generation;
+        bool active = self->id < pool->active;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (active)
+            runTasks(pool, self->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+size_t workerPoolProcessors(void) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return processors > 1 ? (size_t) processors : 1;
+}
+
+void workerPoolIni(WorkerPool *pool) {
+    workerPoolIniSized(pool, workerPoolProcessors());
+}
+
+void workerPoolIniSized(WorkerPool *pool, size_t workers) {
+    pool->threads = NULL;
+    pool->threads_count = 0;
+    pool->task = NULL;
+    pool->context = NULL;
+    pool->count = 0;
+    pool->active = 1;
+    pool->grain = 1;
+    atomic_init(&pool->next, 0);
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stopping = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    if (workers > WORKER_POOL_MAX_WORKERS)
+        workers = WORKER_POOL_MAX_WORKERS;
+
+    if (workers <= 1)
+        return;
+
+    pool->threads = malloc((workers - 1) * sizeof(WorkerThread));
+    if (pool->threads == NULL)
+        return;
+
+    for (size_t i = 0; i < workers - 1; i++) {
+        pool->threads[i].pool = pool;
+        pool->threads[i].id = i + 1;
+        if (pthread_create(&pool->threads[i].thread, NULL, workerMain,
+                           &pool->threads[i]) != 0)
+            break;
+
+        pool->threads_count++;
+    }
+}
+
+size_t workerPoolSize(WorkerPool const *pool) {
+    return pool->threads_count + 1;
+}
+
+void workerPoolRun(WorkerPool *pool, size_t count, WorkerTask task, void *context) {
+    workerPoolRunLimited(pool, WORKER_POOL_MAX_WORKERS, count, task, context);
+}
+
+size_t workerPoolLimit(WorkerPool const *pool, size_t workers) {
+    if (pool == NULL || workers <= 1)
+        return 1;
+
+    return workers < workerPoolSize(pool) ? workers : workerPoolSize(pool);
+}
+
+void workerPoolRunLimited(WorkerPool *pool, size_t workers, size_t count,
+                          WorkerTask task, void *context) {
+    size_t active = workerPoolLimit(pool, workers);
+    if (active == 1) {
+        for (size_t i = 0; i < count; i++)
+            task(context, 0, i);
+        return;
+    }
+
+    size_t grain = count / (active * CHUNKS_PER_WORKER);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->active = active;
+    pool->grain = grain > 0 ? grain : 1;
+    atomic_store(&pool->next, 0);
+    pool->running = pool->threads_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    runTasks(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Tworzy pulę wspólną.
+ */
+static void sharedPoolIni(void) {
+    workerPoolIni(&shared_pool);
+}
+
+WorkerPool *workerPoolAcquire(void) {
+    pthread_once(&shared_pool_once, sharedPoolIni);
+    if (atomic_flag_test_and_set(&shared_pool_busy))
+        return NULL;
+
+    return &shared_pool;
+}
+
+void workerPoolRelease(WorkerPool *pool) {
+    if (pool != NULL)
+        atomic_flag_clear(&shared_pool_busy);
+}
+
+void workerPoolFree(WorkerPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->threads_count; i++)
+        pthread_join(pool->threads[i].thread, NULL);
+
+    free((void *) pool->threads);
+    pool->threads = NULL;
+    pool->threads_count = 0;
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
@@ -0,0 +1,147 @@
+/** @file
+ * Interfejs puli wątków wykonujących równolegle ponumerowane zadania
+ *
+ * @author Patryk Banach
+ * @copyright Uniwersytet Warszawski
+ * @date 17.10.2026
+ */
+
+#ifndef TELEFONY_WORKER_POOL_H
+#define TELEFONY_WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Największa liczba wykonawców puli, łącznie z wątkiem zlecającym zadania.
+ */
+#define WORKER_POOL_MAX_WORKERS 64
+
+/**
+ * Zadanie o numerze @p index wykonywane przez wykonawcę o numerze @p worker.
+ * Wykonawcy są numerowani od 0 do workerPoolSize() - 1, a wątek zlecający
+ * zadania ma numer 0, więc wykonawca może używać własnych buforów bez blokad.
+ */
+typedef void (*WorkerTask)(void *context, size_t worker, size_t index);
+
+struct worker_pool;
+
+/**
+ * Wątek pomocniczy puli.
+ */
+typedef struct worker_thread {
+    struct worker_pool *pool;   ///< Pula, do której należy wątek
+    size_t id;                  ///< Numer wykonawcy
+    pthread_t thread;           ///< Wątek
+} WorkerThread;
+
+/**
+ * Pula wątków. Wątek zlecający zadania sam wykonuje je razem
+ * z wątkami pomocniczymi, które między zleceniami czekają na zmiennej warunkowej.
+ */
+typedef struct worker_pool {
+    WorkerThread *threads;      ///< Wątki pomocnicze
+    size_t threads_count;       ///< Liczba wątków pomocniczych
+    pthread_mutex_t lock;       ///< Blokada chroniąca stan zlecenia
+    pthread_cond_t start;       ///< Sygnalizuje nowe zlecenie lub zamykanie puli
+    pthread_cond_t done;        ///< Sygnalizuje zakończenie pracy wątku pomocniczego
+
+    WorkerTask task;            ///< Bieżące zadanie
+    void *context;              ///< Kontekst bieżącego zadania
+    size_t count;               ///< Liczba zadań bieżącego zlecenia
+    size_t active;              ///< Liczba wykonawców biorących udział w bieżącym zleceniu
+    size_t grain;               ///< Liczba zadań pobieranych naraz przez wykonawcę
+    _Atomic size_t next;        ///< Numer następnego niepobranego zadania
+    size_t generation;          ///< Numer bieżącego zlecenia
+    size_t running;             ///< Liczba wątków pomocniczych pracujących nad zleceniem
+    bool stopping;              ///< Czy pula jest zamykana
+} WorkerPool;
+
+/**
+ * Inicjalizuje pulę z liczbą wykonawców równą liczbie dostępnych procesorów,
+ * nie większą niż WORKER_POOL_MAX_WORKERS. Jeżeli nie uda się utworzyć wątków,
+ * pula ma mniej wykonawców, w szczególności tylko wątek zlecający.
+ * @param pool Pula
+ */
+void workerPoolIni(WorkerPool *pool);
+
+/**
+ * Inicjalizuje pulę z podaną liczbą wykonawców, nie większą niż
+ * WORKER_POOL_MAX_WORKERS. Jeżeli nie uda się utworzyć wątków, pula ma mniej
+ * wykonawców.
+ * @param pool      Pula
+ * @param workers   Liczba wykonawców, łącznie z wątkiem zlecającym
+ */
+void workerPoolIniSized(WorkerPool *pool, size_t workers);
+
+/**
+ * Liczba dostępnych procesorów.
+ * @return Liczba procesorów, co najmniej 1.
+ */
+size_t workerPoolProcessors(void);
+
+/**
+ * Liczba wykonawców puli, łącznie z wątkiem zlecającym.
+ * @param pool Pula
+ * @return Liczba wykonawców.
+ */
+size_t workerPoolSize(WorkerPool const *pool);
+
+/**
+ * Wykonuje zadania o numerach od 0 do @p count - 1 i czeka na ich zakończenie.
+ * Dla puli NULL wszystkie zadania wykonuje wątek zlecający jako wykonawca 0.
+ * @param pool      Pula lub NULL
+ * @param count     Liczba zadań
+ * @param task      Zadanie
+ * @param context   Kontekst przekazywany zadaniu
+ */
+void workerPoolRun(WorkerPool *pool, size_t count, WorkerTask task, void *context);
+
+/**
+ * Wykonuje zadania tak jak workerPoolRun, ale tylko na wykonawcach o numerach
+ * mniejszych od workerPoolLimit(@p pool, @p workers). Dla puli NULL wszystkie
+ * zadania wykonuje wątek zlecający jako wykonawca 0.
+ * @param pool      Pula lub NULL
+ * @param workers   Największa liczba wykonawców, łącznie z wątkiem zlecającym
+ * @param count     Liczba zadań
+ * @param task      Zadanie
+ * @param context   Kontekst przekazywany zadaniu
+ */
+void workerPoolRunLimited(WorkerPool *pool, size_t workers, size_t count,
+                          WorkerTask task, void *context);
+
+/**
+ * Liczba wykonawców, na których workerPoolRunLimited rozdzieli zadania.
+ * @param pool      Pula lub NULL
+ * @param workers   Największa liczba wykonawców
+ * @return Mniejsza z liczb @p workers i workerPoolSize(@p pool), co najmniej 1;
+ *         1 dla puli NULL.
+ */
+size_t workerPoolLimit(WorkerPool const *pool, size_t workers);
+
+/**
+ * Wypożycza pulę wspólną dla całego procesu, tworzoną przy pierwszym użyciu
+ * z liczbą wykonawców równą liczbie procesorów. Wątki puli czekają między
+ * zleceniami aż do końca procesu, więc ich liczba nie zależy od liczby baz.
+ * Pulą posługuje się naraz jeden wątek: gdy jest zajęta, na przykład przez
+ * zlecenie, którego zadanie wywołało tę funkcję, zwracane jest NULL, a zadania
+ * należy wykonać bez puli, np. workerPoolRunLimited z pulą NULL.
+ * @return Pula lub NULL, gdy jest zajęta.
+ */
+WorkerPool *workerPoolAcquire(void);
+
+/**
+ * Oddaje pulę wypożyczoną przez workerPoolAcquire. Nic nie robi dla NULL.
+ * @param pool Pula lub NULL
+ */
+void workerPoolRelease(WorkerPool *pool);
+
+/**
+ * Kończy wątki puli i zwalnia jej pamięć. Pula nie może wykonywać zlecenia.
+ * @param pool Pula
+ */
+void workerPoolFree(WorkerPool *pool);
+
+#endif //TELEFONY_WORKER_POOL_H